@@ -63,12 +63,10 @@ namespace Rivet {
       MCgrid::fastnloConfig config(2, subproc, arch, 7000.0);
 #endif
 
-      // Book grids, and push into BinnedGrid instance
-      MCgrid::gridPtr grid;
-      for (size_t i(0); i < N_HISTOS; i++) {
-        grid = MCgrid::bookGrid(histos[i], histoDir(), config);
-        _grid_sigma.addGrid(i * 0.5, (i + 1) * 0.5, grid);
-      }
+      // Add the grids to the BinnedGrid instance, which books each of them
+      // when its rapidity bin is first filled
+      for (size_t i(0); i < N_HISTOS; i++)
+        _grid_sigma.addGrid(i * 0.5, (i + 1) * 0.5, histos[i], histoDir(), config);
 
     }
 
@@ -0,0 +1,29 @@
+# AC_SEARCH_LHAPDF(actionIfFound, actionIfNotFound)
+AC_DEFUN([AC_SEARCH_LHAPDF], [
+
+lhapdf_enabled=no
+
+AC_PATH_PROG(LHAPDFCONFIG, lhapdf-config, [], [$PATH])
+if test -f "$LHAPDFCONFIG"; then
+  lhapdf_version=`$LHAPDFCONFIG --version`
+  case "$lhapdf_version" in
+    6.*)
+      lhapdf_enabled=yes
+      AC_DEFINE([LHAPDF_ENABLED], [1], [Define if LHAPDF 6 is available.])
+      LHAPDF_CPPFLAGS=`$LHAPDFCONFIG --cppflags`
+      LHAPDF_LDFLAGS=`$LHAPDFCONFIG --ldflags`
+      ;;
+  esac
+fi
+AC_SUBST(LHAPDF_CPPFLAGS)
+AC_SUBST(LHAPDF_LDFLAGS)
+AM_CONDITIONAL([LHAPDF_ENABLED], [test $lhapdf_enabled = yes])
+
+if test $lhapdf_enabled = yes; then
+  AC_MSG_NOTICE([LHAPDF $lhapdf_version is available, building the grid convolution])
+  $1
+else
+  AC_MSG_WARN([LHAPDF 6 cannot be found, the grid convolution will not be built])
+  $2
+fi
+])
@@ -7,6 +7,8 @@
 #define MCgrid_h
 
 #include <string>
+#include <iostream>
+#include <cstdlib>
 
 #include "Rivet/Rivet.hh"
 #include "HepMC/GenEvent.h"
@@ -146,15 +148,18 @@ namespace MCgrid {
     fastnloConfig(const int _lo,
                   const subprocessConfig _subprocConfig,
                   const fastnloGridArch _arch,
-                  const double _centerOfMassEnergy):
+                  const double _centerOfMassEnergy,
+                  const bool _shouldUseScaleLogGrids = false):
       gridConfig(_lo),
       subprocConfig(_subprocConfig),
       arch(_arch),
-      centerOfMassEnergy(_centerOfMassEnergy) {}
+      centerOfMassEnergy(_centerOfMassEnergy),
+      shouldUseScaleLogGrids(_shouldUseScaleLogGrids) {}
 
     const subprocessConfig subprocConfig;
     const fastnloGridArch arch;
     const double centerOfMassEnergy;    //!< Center of mass energy in GeV
+    const bool shouldUseScaleLogGrids;  //!< Whether the scale logs are filled into a flexible-scale table
   };
 
   // **********************   Config Functions **************************
@@ -162,7 +167,19 @@ namespace MCgrid {
   // Set the number of active flavours, this affects Catani Seymour KP terms.
   // The default number of active flavours is 5, i.e. the top is excluded.
   // If you have a massive bottom quark, you might want to set this to 4.
+  // Call this before booking any grid, as the KP projections are compiled
+  // for each grid when it is booked. The run stops if it is called later.
   void setNumberOfActiveFlavors(const int n);
+
+  // Grids can be filled from several threads at once. Each thread counts
+  // its own subprocess events, which are reduced in the order of the fill
+  // thread slots (0 <= slot < 256) on export. Threads other than slot 0
+  // fill their own replicas of the grids, which are added to the grids in
+  // slot order when they are scaled or exported. Threads are assigned a
+  // slot automatically when they first fill; call this function in each
+  // worker thread before it fills to choose the slots instead. Either set
+  // the slots of all threads or of none of them.
+  void setFillThreadSlot(const int slot);
   
   // *********************** Booking Functions **************************
     
@@ -173,6 +190,26 @@ namespace MCgrid {
                    const std::string histoDir,       // Rivet Histogram directory
                    T config                          // Either a fastNLOConfig or an applGridConfig instance
                    );
+
+  // Book only the subprocess PDF of a grid, such that its events are counted
+  // from the start of the run, while the grid itself is booked later with
+  // bookGrid. BinnedGrid does this for bins that are booked on first fill
+  template<class T>
+  void bookSubprocessPDF(const Rivet::Histo1DPtr hist,     // Corresponding Rivet Histogram
+                         const std::string histoDir,       // Rivet Histogram directory
+                         T config                          // Either a fastNLOConfig or an applGridConfig instance
+                         );
+
+  // Book a MCgrid::grid object for a double-differential observable. All
+  // cells share one grid, which is filled with grid::fill(x, y, event).
+  // fastNLO writes a double-differential table. APPLgrid has no second
+  // observable, so its grid bins are the cells, ordered by their lower
+  // edges in x and then in y, each as wide as the area of its cell.
+  template<class T>
+  gridPtr bookGrid(const Rivet::Histo2DPtr hist,     // Corresponding Rivet Histogram
+                   const std::string histoDir,       // Rivet Histogram directory
+                   T config                          // Either a fastNLOConfig or an applGridConfig instance
+                   );
  
   // **********************  MCgrid::grid Class **************************
 
@@ -186,6 +223,15 @@ namespace MCgrid {
     
     // Fill the grid with an event
     virtual void fill( double coord, const Rivet::Event& event) = 0;
+
+    // Fill a grid booked for a 2D histogram with an event. Grids that are
+    // not booked for a 2D histogram do not override this
+    virtual void fill( double x, double y, const Rivet::Event& event)
+    {
+      std::cerr << "MCgrid::Error - This grid does not support filling with two observables." << std::endl;
+      std::cerr << "                Please book it for a 2D histogram to fill it with grid::fill(x, y, event)." << std::endl;
+      exit(-1);
+    }
     
     // Write the grid to file
     virtual void exportgrid() = 0;
@@ -6,7 +6,14 @@
 #ifndef mcgrid_binned_hh
 #define mcgrid_binned_hh
 
-#include <map>
+#include <array>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <algorithm>
+#include <cmath>
 
 #include "mcgrid.hh"
 
@@ -15,132 +22,409 @@ using Rivet::cout;
 using Rivet::endl;
 
 namespace MCgrid
-{  
-  // ********************** Binned grids ***********************
+{
+  // ********************** Bin edge index ***********************
+
+  /**
+   * MCgrid::binEdgeIndex locates a value within a contiguous array of sorted
+   * edges by a branchless binary search. Uniformly spaced edges are instead
+   * located directly, with one multiplication.
+   **/
+  template<typename T>
+  class binEdgeIndex {
+  public:
+    binEdgeIndex(): isUniform(false), origin(0), inverseWidth(0) {};
+
+    // The edges have to be sorted and unique
+    void build(std::vector<T> const& _edges);
+
+    // Number of intervals between the edges
+    size_t numberOfIntervals() const { return edges.empty() ? 0 : edges.size() - 1; };
+
+    // Index i of the interval with edges[i] <= x < edges[i+1], or -1
+    int find(const T& x) const
+    {
+      if (edges.size() < 2 || !(x >= edges.front() && x < edges.back()))
+        return -1;
+
+      if (isUniform) {
+        const int last = static_cast<int>(edges.size()) - 2;
+        int i = std::min(static_cast<int>((x - origin) * inverseWidth), last);
+        // Correct for rounding next to the edges
+        if (x < edges[i]) i--;
+        else if (x >= edges[i+1]) i++;
+        return i;
+      }
+
+      const T* base = &edges[0];
+      size_t n = edges.size();
+      while (n > 1) {
+        const size_t half = n / 2;
+        base = (base[half] <= x) ? base + half : base;
+        n -= half;
+      }
+      return static_cast<int>(base - &edges[0]);
+    };
+
+  private:
+    std::vector<T> edges;
+    bool isUniform;        //!< Whether all intervals have the same width
+    double origin;
+    double inverseWidth;
+  };
+
   template<typename T>
+  void binEdgeIndex<T>::build(std::vector<T> const& _edges)
+  {
+    edges = _edges;
+    isUniform = false;
+    if (edges.size() < 2)
+      return;
+
+    origin = edges.front();
+    const double width = (static_cast<double>(edges.back()) - origin) / (edges.size() - 1);
+    isUniform = true;
+    for (size_t i=1; i<edges.size() && isUniform; i++)
+      isUniform = std::fabs((static_cast<double>(edges[i]) - edges[i-1]) - width) <= 1e-9 * width;
+    inverseWidth = 1.0 / width;
+  }
+
+  // ********************** Binned grids ***********************
+
+  /**
+   * MCgrid::BinnedGrid holds one grid per bin of N outer variables, e.g. one
+   * grid per rapidity bin of a jet pT spectrum. A bin is an open box in the
+   * outer variables. Once the first fill arrives, the bins are indexed by the
+   * edges in each outer variable, and no bins can be added afterwards.
+   **/
+  template<typename T, size_t N = 1>
   class BinnedGrid {
   public:
+    typedef std::array<T, N> point;
+
     // BinnedGrid constructor
-    // BinnedGrid();
-    
+    BinnedGrid(): isIndexed(false) {};
+
     const void addGrid(const T& binMin, const T& binMax, gridPtr grid);
-    
-    /// Fill the histogram that lies in the same region as @a bin with the value
-    /// @a val of weight @a weight.
-    gridPtr fill(const T& bin, const double& val, const Rivet::Event& event);
-    
+    const void addGrid(point const& binMin, point const& binMax, gridPtr grid);
+
+    // Add a bin whose grid is only booked with bookGrid once the bin is
+    // first filled, which saves the memory of bins without events. Its
+    // subprocess PDF is booked right away. Bins that are not filled are
+    // booked empty on export, exported and released again
+    template<class C>
+    const void addGrid(const T& binMin, const T& binMax,
+                       const Rivet::Histo1DPtr hist,
+                       const std::string histoDir,
+                       C config);
+    template<class C>
+    const void addGrid(point const& binMin, point const& binMax,
+                       const Rivet::Histo1DPtr hist,
+                       const std::string histoDir,
+                       C config);
+
+    /// Fill the grid of the bin that contains @a bin with the value @a val.
+    /// Returns the filled grid, which remains owned by the BinnedGrid, or
+    /// NULL if no bin contains @a bin
+    grid* fill(const T& bin, const double& val, const Rivet::Event& event);
+    grid* fill(point const& bin, const double& val, const Rivet::Event& event);
+
     /// Scale/normalise histograms
     void scale(const double& scale);
-    
+
     // Export contained grids
     void exportgrids();
-    
+
   private:
-    std::map<T, gridPtr> gridsByUpperBound;
-    std::map<T, gridPtr> gridsByLowerBound;
-    std::vector<gridPtr> grids;
-    std::map<gridPtr, T> binWidths;
+    BinnedGrid(BinnedGrid const&);
+    BinnedGrid& operator=(BinnedGrid const&);
+
+    // Booking state of a bin. A bin that is exported before it is filled
+    // is released again, and is booked anew if it is filled afterwards
+    typedef enum { binUnbooked, binBooked, binReleased } binState;
+
+    struct binEntry
+    {
+      binEntry(): state(binUnbooked) {};
+
+      gridPtr grid;                      //!< NULL unless the bin is booked
+      std::function<gridPtr()> book;     //!< Books the grid of a lazily added bin
+      std::mutex mutex;                  //!< Guards the grid and its state
+      std::atomic<binState> state;       //!< Also read without the mutex by fills
+      point low;
+      point high;
+      double width;                      //!< Product of the bin widths
+      std::vector<double> pendingScales; //!< Scale factors applied before booking
+    };
+    typedef std::shared_ptr<binEntry> binEntryPtr;
+
+    std::vector<binEntryPtr> grids;
+
+    // Bin index, built on the first fill
+    binEdgeIndex<T> edges[N];          //!< Edges of all bins per outer variable
+    std::vector<binEntry*> cells;      //!< Bin of each cell between the edges, or NULL
+    std::once_flag indexed;
+    bool isIndexed;
+
+    void addEntry(point const& binMin, point const& binMax, binEntryPtr entry);
+    void buildIndex();
+
+    // The bin containing a point, or NULL
+    binEntry* findEntry(point const& bin) const;
+
+    // The grid of a bin, booked on first use. Several fill threads may book
+    // different bins at the same time
+    grid* bookedGrid(binEntry& entry);
 
     void outputMemoryWarningOnce();
   };
-  
-  template<class T>
-  const void BinnedGrid<T>::addGrid(const T& binMin, const T& binMax, gridPtr grid)
+
+  template<class T, size_t N>
+  const void BinnedGrid<T, N>::addGrid(const T& binMin, const T& binMax, gridPtr grid)
+  {
+    static_assert(N == 1, "Bins of several outer variables are added with their corners");
+    addGrid(point{{binMin}}, point{{binMax}}, grid);
+  }
+
+  template<class T, size_t N>
+  const void BinnedGrid<T, N>::addGrid(point const& binMin, point const& binMax, gridPtr grid)
   {
     // It's better to do this here instead of in the constructor
     // to avoid accidental output when Rivet is loading the analysis
     // without actually using it
     outputMemoryWarningOnce();
 
-    if ( binMax <= binMin )
+    binEntryPtr entry(new binEntry());
+    entry->grid = grid;
+    entry->state = binBooked;
+    addEntry(binMin, binMax, entry);
+  }
+
+  template<class T, size_t N>
+  template<class C>
+  const void BinnedGrid<T, N>::addGrid(const T& binMin, const T& binMax,
+                                       const Rivet::Histo1DPtr hist,
+                                       const std::string histoDir,
+                                       C config)
+  {
+    static_assert(N == 1, "Bins of several outer variables are added with their corners");
+    addGrid(point{{binMin}}, point{{binMax}}, hist, histoDir, config);
+  }
+
+  template<class T, size_t N>
+  template<class C>
+  const void BinnedGrid<T, N>::addGrid(point const& binMin, point const& binMax,
+                                       const Rivet::Histo1DPtr hist,
+                                       const std::string histoDir,
+                                       C config)
+  {
+    // The subprocess PDF is booked right away, such that its event counts
+    // include the events before the first fill of the bin
+    bookSubprocessPDF(hist, histoDir, config);
+
+    binEntryPtr entry(new binEntry());
+    entry->book = [hist, histoDir, config]() { return bookGrid(hist, histoDir, config); };
+    addEntry(binMin, binMax, entry);
+  }
+
+  template<class T, size_t N>
+  void BinnedGrid<T, N>::addEntry(point const& binMin, point const& binMax, binEntryPtr entry)
+  {
+    if (isIndexed)
     {
-      cerr << "MCgrid::binnnedGrid Error - invalid bin minimum ("<<binMin<<") and maximum ("<<binMax<<")."<<endl;
+      cerr << "MCgrid::binnnedGrid Error - Bins can not be added after the first fill."<<endl;
       exit(-1);
     }
-    
+
+    entry->width = 1.0;
+    for (size_t d=0; d<N; d++)
+    {
+      if ( binMax[d] <= binMin[d] )
+      {
+        cerr << "MCgrid::binnnedGrid Error - invalid bin minimum ("<<binMin[d]<<") and maximum ("<<binMax[d]<<")."<<endl;
+        exit(-1);
+      }
+      entry->width *= binMax[d]-binMin[d];
+    }
+
     // Enter new grid
-    grids.push_back(grid);
-    
-    const bool checkLower   = gridsByLowerBound.insert(std::make_pair(binMin,grid)).second;
-    const bool checkHigher  = gridsByUpperBound.insert(std::make_pair(binMax,grid)).second;
-    
-    // Verify bounds
-    if (!checkHigher || !checkLower)
+    entry->low = binMin;
+    entry->high = binMax;
+    grids.push_back(entry);
+  }
+
+  /*
+   * The edges of all bins divide each outer variable into intervals, and
+   * their product into cells. Each cell is covered by at most one bin.
+   */
+  template<class T, size_t N>
+  void BinnedGrid<T, N>::buildIndex()
+  {
+    size_t nCells(1);
+    for (size_t d=0; d<N; d++)
     {
-      cerr << "MCgrid::binnnedGrid Error - Duplicate bin ranges detected."<<endl;
-      exit(-1);
+      std::vector<T> dimensionEdges;
+      for (size_t i=0; i<grids.size(); i++) {
+        dimensionEdges.push_back(grids[i]->low[d]);
+        dimensionEdges.push_back(grids[i]->high[d]);
+      }
+      std::sort(dimensionEdges.begin(), dimensionEdges.end());
+      dimensionEdges.erase(std::unique(dimensionEdges.begin(), dimensionEdges.end()), dimensionEdges.end());
+      edges[d].build(dimensionEdges);
+      nCells *= edges[d].numberOfIntervals();
+    }
+
+    cells.assign(nCells, NULL);
+    for (size_t i=0; i<grids.size(); i++)
+    {
+      // Range of intervals covered by the bin in each outer variable
+      size_t first[N], last[N];
+      for (size_t d=0; d<N; d++) {
+        first[d] = edges[d].find(grids[i]->low[d]);
+        const int highEdge = edges[d].find(grids[i]->high[d]);
+        last[d] = (highEdge == -1) ? edges[d].numberOfIntervals() - 1 : highEdge - 1;
+      }
+
+      size_t cell[N];
+      std::copy(first, first+N, cell);
+      while (true) {
+        size_t flat(0);
+        for (size_t d=0; d<N; d++)
+          flat = flat*edges[d].numberOfIntervals() + cell[d];
+        if (cells[flat] != NULL) {
+          cerr << "MCgrid::binnnedGrid Error - Overlapping bin ranges detected."<<endl;
+          exit(-1);
+        }
+        cells[flat] = grids[i].get();
+
+        size_t d(N);
+        while (d > 0 && cell[d-1] == last[d-1]) {
+          cell[d-1] = first[d-1];
+          d--;
+        }
+        if (d == 0)
+          break;
+        cell[d-1]++;
+      }
+    }
+    isIndexed = true;
+  }
+
+  template<class T, size_t N>
+  typename BinnedGrid<T, N>::binEntry* BinnedGrid<T, N>::findEntry(point const& bin) const
+  {
+    size_t flat(0);
+    for (size_t d=0; d<N; d++) {
+      const int i = edges[d].find(bin[d]);
+      if (i < 0)
+        return NULL;
+      flat = flat*edges[d].numberOfIntervals() + i;
+    }
+
+    // The bins are open, such that a value on an edge is in no bin
+    binEntry* entry = cells[flat];
+    if (entry == NULL)
+      return NULL;
+    for (size_t d=0; d<N; d++)
+      if (!(entry->low[d] < bin[d] && bin[d] < entry->high[d]))
+        return NULL;
+    return entry;
+  }
+
+  template<class T, size_t N>
+  grid* BinnedGrid<T, N>::bookedGrid(binEntry& entry)
+  {
+    if (entry.state.load(std::memory_order_acquire) == binBooked)
+      return entry.grid.get();
+
+    std::lock_guard<std::mutex> lock(entry.mutex);
+    if (entry.state.load() != binBooked) {
+      entry.grid = entry.book();
+      entry.state.store(binBooked, std::memory_order_release);
     }
-    
-    // Width entry
-    binWidths.insert(std::make_pair(grid, binMax-binMin));
-    
-    return;
+    return entry.grid.get();
   }
 
-  template<class T>
-  void BinnedGrid<T>::outputMemoryWarningOnce() {
+  template<class T, size_t N>
+  void BinnedGrid<T, N>::outputMemoryWarningOnce() {
     static bool once_token = false;
     if (!once_token) {
       cout << "MCgrid::BinnedGrid is used"<<endl;
       cout << " ** Warning, BinnedGrids can be extremely memory intensive **"<<endl;
       cout << " ** It's a good idea to enable subprocess identification ** "<<endl;
+      cout << " ** or to add the bins lazily with their booking recipe  ** "<<endl;
       once_token = true;
     }
   }
-  
-  /*
-   * BinnedGrid::fill -> largely duplicated from Rivet::BinnedHistogram::fill
-   */
-  template<class T>
-  gridPtr BinnedGrid<T>::fill(const T& bin, const double& val, const Rivet::Event& event)
+
+  template<class T, size_t N>
+  grid* BinnedGrid<T, N>::fill(const T& bin, const double& val, const Rivet::Event& event)
   {
-    typename std::map<T, gridPtr>::iterator iGrid = gridsByUpperBound.upper_bound(bin);
-    if (iGrid == gridsByUpperBound.end()) {
-      return gridPtr(); // should exit instead?
-    }
-    
-    gridPtr grid = iGrid->second;
-    iGrid = gridsByLowerBound.lower_bound(bin);
-    
-    if (iGrid == gridsByLowerBound.begin()) {
-      return gridPtr();
-    }
-    --iGrid;
-    
-    if (grid != iGrid->second) {
-      return gridPtr();
-    }
-    
-    grid->fill(val, event);
-    
-    return grid;
+    static_assert(N == 1, "Bins of several outer variables are filled with a point");
+    return fill(point{{bin}}, val, event);
+  }
+
+  template<class T, size_t N>
+  grid* BinnedGrid<T, N>::fill(point const& bin, const double& val, const Rivet::Event& event)
+  {
+    std::call_once(indexed, [this]() { buildIndex(); });
+
+    binEntry* entry = findEntry(bin);
+    if (entry == NULL)
+      return NULL;
+
+    grid* target = bookedGrid(*entry);
+    target->fill(val, event);
+
+    return target;
   }
-  
+
   /*
    * BinnedGrid::scale -> scales grids, taking into account relative bin widths
    */
-  template<class T>
-  void BinnedGrid<T>::scale(const double& scale)
+  template<class T, size_t N>
+  void BinnedGrid<T, N>::scale(const double& scale)
   {
-    typename std::map<gridPtr, T>::iterator iGrid = binWidths.begin();
-    for (; iGrid != binWidths.end(); iGrid++)
+    for (size_t i=0; i<grids.size(); i++)
     {
-      (*iGrid).first->scale(scale/(*iGrid).second);
-      cout << "binWidth: "<<(*iGrid).second<<endl;
+      std::lock_guard<std::mutex> lock(grids[i]->mutex);
+      if (grids[i]->state.load() == binBooked)
+        grids[i]->grid->scale(scale/grids[i]->width);
+      else
+        grids[i]->pendingScales.push_back(scale/grids[i]->width);
+      cout << "binWidth: "<<grids[i]->width<<endl;
     }
-  
+
   }
-  
+
   /*
    * BinnedGrid::exportgrids -> writes out constituent grids
    */
-  template<class T>
-  void BinnedGrid<T>::exportgrids()
+  template<class T, size_t N>
+  void BinnedGrid<T, N>::exportgrids()
   {
-    for (size_t i=0; i<grids.size(); i++)
-      grids[i]->exportgrid();
+    for (size_t i=0; i<grids.size(); i++) {
+      binEntry& entry = *grids[i];
+      std::lock_guard<std::mutex> lock(entry.mutex);
+      if (entry.state.load() == binBooked) {
+        entry.grid->exportgrid();
+        continue;
+      }
+
+      // A bin without fills is written as an empty grid, such that every
+      // bin has a grid (or phase space grid) for the following runs. The
+      // grid is released right away, which waits for its queued export, so
+      // at most one of them is held at a time. Its scale factors are kept
+      // for the case that the bin is exported again
+      gridPtr empty = entry.book();
+      for (size_t j=0; j<entry.pendingScales.size(); j++)
+        empty->scale(entry.pendingScales[j]);
+      empty->exportgrid();
+      empty.reset();
+      entry.state.store(binReleased);
+    }
   }
-  
+
 }
 
 #endif
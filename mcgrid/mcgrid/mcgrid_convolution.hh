@@ -0,0 +1,105 @@
+//
+//  mcgrid_convolution.hh
+//  MCgrid 17/10/2026.
+//
+
+#ifndef mcgrid_convolution_hh
+#define mcgrid_convolution_hh
+
+#include <string>
+#include <vector>
+
+namespace MCgrid
+{
+  // ********************** Convolution of exported grids **********************
+
+  // Renormalisation and factorisation scale factors of a convolution
+  struct scaleFactors
+  {
+    scaleFactors(const double _muR = 1.0, const double _muF = 1.0):
+      muR(_muR), muF(_muF) {};
+    double muR;
+    double muF;
+  };
+
+  // The scale choices of an n-point scale variation (n = 3, 7 or 9), with
+  // the central choice first. The renormalisation and factorisation scales
+  // are multiplied and divided by `factor`: for n = 3 together, for n = 9
+  // independently and for n = 7 independently without opposite variations.
+  std::vector<scaleFactors> scaleVariations(const int nPoints, const double factor = 2.0);
+
+  // Lower and upper envelope over the predictions of several scale choices
+  void scaleEnvelope(std::vector< std::vector<double> > const& predictions,
+                     std::vector<double>& lower,
+                     std::vector<double>& upper);
+
+  class convolutionBackend;
+  class pdfNodeTable;
+
+  /**
+   * MCgrid::gridConvolution convolutes an exported APPLgrid (.root) or
+   * fastNLO table (.tab) with the PDFs and alpha_s of an LHAPDF6 set.
+   *
+   * The PDFs and alpha_s of a member are tabulated on the (x, Q) nodes the
+   * grid requests during the first convolution, and all further convolutions
+   * with the same factorisation scale factor are computed from this table.
+   * The table of each factorisation scale factor is filled by the first of
+   * its scale choices, after which all other scale choices are convoluted
+   * from the filled tables in parallel, each thread working on its own copy
+   * of the grid. An n-point scale variation therefore evaluates the PDFs
+   * once per factorisation scale factor.
+   **/
+  class gridConvolution
+  {
+  public:
+    gridConvolution(std::string const& gridFile, const int nThreads = 1);
+    ~gridConvolution();
+
+    // Observable binning of the grid
+    size_t nBins() const;
+    double binLow(const size_t bin) const;
+    double binHigh(const size_t bin) const;
+
+    // Convolute with member `member` of the LHAPDF6 set `pdfSet` for each of
+    // the scale choices. The result holds one prediction per scale choice.
+    // nLoops limits the perturbative order (0 is LO, 1 is NLO), the default
+    // of -1 uses all orders of the grid.
+    std::vector< std::vector<double> > convolute(std::string const& pdfSet,
+                                                 const int member,
+                                                 std::vector<scaleFactors> const& scales,
+                                                 const int nLoops = -1);
+
+    // Convolute with all members of the LHAPDF6 set `pdfSet` for each of the
+    // scale choices. The result is indexed by scale choice, member and bin.
+    // The members are tabulated on the nodes of the grid in blocks, each in
+    // one pass over the nodes. The coefficients of an APPLgrid are then
+    // contracted with all members of a block at once, in parallel over the
+    // bins and scale choices, if this reproduces APPLgrid's convolution of
+    // the central member. Otherwise, and for fastNLO tables, each member is
+    // convoluted by the grid library in its own pass over the coefficients,
+    // in parallel.
+    std::vector< std::vector< std::vector<double> > > convoluteMembers(std::string const& pdfSet,
+                                                                       std::vector<scaleFactors> const& scales,
+                                                                       const int nLoops = -1);
+
+    // Number of (x, Q) nodes the PDFs have been evaluated on in the last call
+    // of convolute, or per member in the last call of convoluteMembers
+    size_t nTabulatedNodes() const { return nNodes; };
+
+  private:
+    gridConvolution(gridConvolution const&);
+    gridConvolution& operator=(gridConvolution const&);
+
+    // The grid of a worker thread, loaded on first use
+    convolutionBackend& backend(const int worker);
+
+    pdfNodeTable* loadTable(std::string const& pdfSet, const int member) const;
+
+    const std::string gridFile;
+    const int nThreads;
+    std::vector<convolutionBackend*> backends;   //!< One grid per thread, loaded on demand
+    size_t nNodes;
+  };
+}
+
+#endif
@@ -0,0 +1,51 @@
+//
+//  mcgrid_merge.hh
+//  MCgrid 17/10/2026.
+//
+
+#ifndef mcgrid_merge_hh
+#define mcgrid_merge_hh
+
+#include <string>
+#include <vector>
+
+namespace MCgrid
+{
+  // ******************* Combination of independent runs *********************
+
+  // Combine the grids of one histogram from independent (e.g. seeded) runs
+  // into a single grid. The grid interface is chosen by the file extension.
+  //
+  // APPLgrids (.root) are summed with the weight N_k/N/run_k for run k, where
+  // N_k is the event count written next to each grid (`.runinfo`), N the sum
+  // of all N_k and run_k the normalisation of the grid. The result is an
+  // unnormalised grid with run() = 1 and a `.runinfo` for N, so merged grids
+  // can be merged again. If no input comes with a `.runinfo`, the merge
+  // stops, unless assumeEqualEventCounts is set, in which case all N_k are
+  // taken to be equal. fastNLO tables (.tab) are combined with
+  // fastNLOTable::AddTable, which weights them by the event counts stored in
+  // the tables.
+  //
+  // The inputs are split into nThreads contiguous ranges, each of which is
+  // read one grid at a time and summed up by its own thread. The partial sums
+  // are then combined pairwise, so at most 2*nThreads grids are held in
+  // memory at once and the result does not depend on the thread scheduling.
+  void mergeGrids(std::vector<std::string> const& inputFiles,
+                  std::string const& outputFile,
+                  const int nThreads = 1,
+                  const bool assumeEqualEventCounts = false);
+
+  // Sum the subprocess and partonic channel event counters (.evtcount) of
+  // independent phase space runs of the same subprocess configuration
+  void mergeEventCounts(std::vector<std::string> const& inputFiles,
+                        std::string const& outputFile);
+
+  // Take the union of the per-bin x1, x2 and Q^2 ranges (.extent) recorded by
+  // independent warmup runs. If the merged extent is placed next to where the
+  // phase space grid is expected, together with the merged event counters,
+  // the next run creates the phase space grid from it when the grid is booked
+  void mergePhasespaceExtents(std::vector<std::string> const& inputFiles,
+                              std::string const& outputFile);
+}
+
+#endif
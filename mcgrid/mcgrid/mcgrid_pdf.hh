@@ -9,6 +9,9 @@
 #include <iostream>
 #include <stdint.h>
 #include <set>
+#include <vector>
+#include <atomic>
+#include <mutex>
 
 #include "Rivet/Rivet.hh"
 
@@ -25,6 +28,12 @@ std::ostream& operator<<(std::ostream& out, const std::pair<T1, T2>& value)
 
 namespace MCgrid
 {
+  class fillInfoCache;
+  class eventRecorder;
+  class checkpointer;
+  class kpProjectionTable;
+  template<class T> class perThread;
+
   // Beam types (just proton/antiproton for the moment)
   typedef enum beamType {BEAM_PROTON = 1, BEAM_ANTIPROTON = -1} beamType;
   static inline int beamTypeToPDG( beamType type ) {
@@ -74,14 +83,29 @@ namespace MCgrid
    * MCgrid::mcgrid_fnlo_pdf_params is used to construct new subprocess
    * definitions for fastNLO, which loads the subprocesses from a grid steering
    * file, such that we need a pointer to the fastNLO class that reads that.
+   * If isOwningTable is set, the subprocess PDF deletes the table.
    **/
   struct mcgrid_fnlo_pdf_params : mcgrid_base_pdf_params
   {
-    mcgrid_fnlo_pdf_params(std::string const& _name, fastNLOCreate * const _ftable):
+    mcgrid_fnlo_pdf_params(std::string const& _name, fastNLOCreate * const _ftable,
+                           const bool _isOwningTable = false):
       mcgrid_base_pdf_params(_name),
-      ftable                (_ftable) {};
+      ftable                (_ftable),
+      isOwningTable         (_isOwningTable) {};
 
     fastNLOCreate * const ftable;
+    const bool isOwningTable;
+  };
+
+  /**
+   * MCgrid::subprocessLookup is an entry of the flavour-pair lookup table of
+   * mcgrid_base_pdf, holding everything a fill needs to know about a pair
+   **/
+  struct subprocessLookup
+  {
+    int subproc;        //!< Subprocess index, -1 if the pair can not be classified
+    int subpair;        //!< Index of the pair within its subprocess
+    double eventRatio;  //!< nSubPairEvents/nSubEvents, or 1 before the phase space run
   };
 
   /**
@@ -95,7 +119,11 @@ namespace MCgrid
 
     // Subprocess statistics
     void CountEvent(const int fl1, const int fl2);
-    double EventRatio(const int fl1, const int fl2);
+    double EventRatio(const int fl1, const int fl2) const { return LookupSubProcess(fl1, fl2).eventRatio; };
+
+    // Subprocess classification and event ratio of a flavour pair
+    subprocessLookup LookupSubProcess(const int fl1, const int fl2) const;
+    bool IsClassifiable(const int fl1, const int fl2) const;
 
     // Subprocess information
     virtual int NumberOfSubprocesses() const { return nSubprocesses; };
@@ -106,11 +134,24 @@ namespace MCgrid
     bool isInitialised() const { return initialised; };
     virtual const std::string name() const { return pdfname; };
 
+    // Checkpointing of the event counts, see checkpointer. The snapshot
+    // holds the counts of all fill threads per partonic channel
+    std::vector<uint64_t> EventCountSnapshot() const;
+    void ExportEventCounts(std::string const& path, std::vector<uint64_t> const& counts) const;
+    void ResumeEventCounts(std::string const& path);
+
+    // KP projections of the subprocesses, compiled by the first grid booked
+    // with this PDF and shared by all others. Only called while booking
+    kpProjectionTable const* KPProjections(const int nActiveFlavors);
+
   protected:
     mcgrid_base_pdf(mcgrid_base_pdf_params const& params,
                     const int _nSubprocesses):
       nSubprocesses(_nSubprocesses),
       initialised(false),
+      threadEventCounts(0),
+      nTotalPairs(0),
+      kpProjections(0),
       pdfname(params.name)
     {};
 
@@ -118,6 +159,14 @@ namespace MCgrid
     template<typename T>
     void InitialiseEventCounting(T *subprocesses);
 
+    // Fill the flavour-pair lookup table, must be called once the subprocess
+    // classification and the event counts are available
+    void InitialiseLookupTable();
+
+    // Subprocess classification without validation, returns -1 if the pair
+    // can not be classified
+    virtual int classifySubProcess(const int iflav1, const int iflav2) const = 0;
+
     // Subprocess information
     int validateSubProcessResult(const int sub, const int iflav1, const int iflav2) const;
     template<typename T>
@@ -132,13 +181,50 @@ namespace MCgrid
     // Subprocess statistics
     void Export() const;         //!< Write event data to file
     bool Read();                 //!< Read event data from exported file
+    bool ReadEventCounts(std::string const& path);
+    void ReduceEventCounts();    //!< Add the per-thread counts to the totals
     uint64_t *nSubEvents;        //!< Number of events per subprocess
     uint64_t **nSubPairEvents;   //!< Number of events per partonic channel
 
+    // Per-thread event counts, indexed by pairOffsets[subproc] + subpair
+    perThread<std::vector<uint64_t> > *threadEventCounts;
+    std::vector<int> pairOffsets;
+    int nTotalPairs;
+
+    // Flavour-pair lookup table, indexed by (fl1+6)*13 + fl2+6
+    static const int lookupFlavourOffset = 6;
+    static const int nLookupFlavours = 13;
+    subprocessLookup ComputeLookup(const int fl1, const int fl2) const;
+    subprocessLookup lookupTable[nLookupFlavours*nLookupFlavours];
+
+    kpProjectionTable* kpProjections;  //!< Shared KP projections (or NULL)
+
     // State
     const std::string pdfname;   //!< Name of Subproc PDF
   };
 
+  inline subprocessLookup mcgrid_base_pdf::LookupSubProcess(const int fl1, const int fl2) const
+  {
+    const int i1 = fl1 + lookupFlavourOffset;
+    const int i2 = fl2 + lookupFlavourOffset;
+    if (i1 >= 0 && i1 < nLookupFlavours && i2 >= 0 && i2 < nLookupFlavours) {
+      const subprocessLookup& entry = lookupTable[i1*nLookupFlavours + i2];
+      if (entry.subproc != -1)
+        return entry;
+    }
+    // Let the slow path report the unclassified pair
+    return ComputeLookup(fl1, fl2);
+  }
+
+  inline bool mcgrid_base_pdf::IsClassifiable(const int fl1, const int fl2) const
+  {
+    const int i1 = fl1 + lookupFlavourOffset;
+    const int i2 = fl2 + lookupFlavourOffset;
+    if (i1 < 0 || i1 >= nLookupFlavours || i2 < 0 || i2 >= nLookupFlavours)
+      return false;
+    return (lookupTable[i1*nLookupFlavours + i2].subproc != -1);
+  }
+
   // *********************** PDFHandler *******************************
 
   /**
@@ -154,54 +240,91 @@ namespace MCgrid
     static mcgrid_base_pdf* BookPDF(mcgrid_base_pdf_params const& params,
                                     std::string const& analysis);
 
+    // Whether a subprocess PDF of this name has been booked
+    static bool IsBooked(std::string const& name);
+
     // Passes an event to mapped subprocess PDFs for counting.
     static void HandleEvent(Rivet::Event const&, std::string const& analysis);
 
     // Removes analysis from analyses and calls ClearHandler if no analysis is
     // left. This has to be used instead of ClearHandler in the finalize()
-    // method of an analysis if more than one analysis is being used
+    // method of an analysis if more than one analysis is being used. Queued
+    // grid exports are finished first
     static void CheckOutAnalysis(std::string const& analysis)
     {
+      WaitForExports();
       GetHandler(analysis)->analyses.erase(analysis);
       if (GetHandler(analysis)->analyses.empty())
         ClearHandler();
     }
 
-    static uint64_t NEvents() { return (handlerInstance == 0) ? 0 : handlerInstance->nEvents; };
+    static uint64_t NEvents() { return (handlerInstance == 0) ? 0 : handlerInstance.load()->nEvents.load(); };
+
+    // Sum of the weights of the counted events, including those of a
+    // resumed checkpoint
+    static double SumOfWeights() { return (handlerInstance == 0) ? 0.0 : handlerInstance.load()->sumOfWeights.load(); };
+
+    // Per-event cache of decoded fill information shared by all grids,
+    // there is one cache per fill thread
+    static fillInfoCache& FillInfoCache();
+
+    // Event recorder of this run, or NULL if MCGRID_RECORD is not set
+    static eventRecorder* Recorder() { return GetHandler()->recorder; };
+
+    // Checkpoints of this run, or NULL if checkpointing is not enabled or
+    // the run has finished
+    static checkpointer* Checkpointer() { return (handlerInstance == 0) ? NULL : handlerInstance.load()->checkpoints; };
+
+    // Count an event replayed from an event record, given its flavours and
+    // its weight
+    static void HandleRecordedEvent(const int fl1, const int fl2, const double weight);
     
   private:
 
-    PDFHandler(std::string const& eventCounterAnalysis):
-      nEvents(0),
-      eventCounterAnalysis(eventCounterAnalysis)
-    {};
+    PDFHandler(std::string const& eventCounterAnalysis);
 
     ~PDFHandler();
 
     static void HandleEvent(Rivet::Event const& event);
     
+    // The singleton is created by the first caller, also if several threads
+    // fill their first event at the same time
     static PDFHandler* GetHandler(std::string const& eventCounterAnalysis)
     {
-      if (handlerInstance == 0)
-        handlerInstance = new PDFHandler(eventCounterAnalysis);
-      
-      return handlerInstance;
+      PDFHandler* instance = handlerInstance.load(std::memory_order_acquire);
+      if (instance == 0) {
+        std::lock_guard<std::mutex> lock(instanceMutex);
+        instance = handlerInstance.load();
+        if (instance == 0) {
+          instance = new PDFHandler(eventCounterAnalysis);
+          handlerInstance.store(instance, std::memory_order_release);
+        }
+      }
+      return instance;
     }
     static PDFHandler* GetHandler()
     {
       return GetHandler("");
     }
 
+    // Wait for the grid exports queued if MCGRID_EXPORT_THREADS is set
+    static void WaitForExports();
+
     static void ClearHandler()
     {
-      delete handlerInstance;
-      handlerInstance = 0;
+      std::lock_guard<std::mutex> lock(instanceMutex);
+      delete handlerInstance.exchange(0);
     }
     
-    static PDFHandler* handlerInstance;      //!< Singleton
+    static std::atomic<PDFHandler*> handlerInstance;  //!< Singleton
+    static std::mutex instanceMutex;                  //!< Guards the creation of the singleton
 
     std::map<int, mcgrid_base_pdf*> pdfMap;  //!< Map of subprocess PDFs
-    uint64_t nEvents;                        //!< Total event counter of current run
+    std::atomic<uint64_t> nEvents;           //!< Total event counter of current run
+    std::atomic<double> sumOfWeights;        //!< Sum of the weights of the counted events
+    perThread<fillInfoCache>* infoCaches;    //!< Decoded fill info of the current event per thread
+    eventRecorder* recorder;                 //!< Writes the events to MCGRID_RECORD (or NULL)
+    checkpointer* checkpoints;               //!< Periodic checkpoints of the run (or NULL)
     std::set<std::string> analyses;          //!< Set of analyses used to keep track
                                              //!< of the active analyses
 
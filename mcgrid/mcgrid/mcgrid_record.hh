@@ -0,0 +1,38 @@
+//
+//  mcgrid_record.hh
+//  MCgrid 17/10/2026.
+//
+
+#ifndef mcgrid_record_hh
+#define mcgrid_record_hh
+
+#include <map>
+#include <string>
+
+#include "mcgrid.hh"
+
+namespace MCgrid
+{
+  // ********************** Event record replay ***********************
+
+  // If the environment variable MCGRID_RECORD is set to a file path, MCgrid
+  // writes the decoded fill information of each event, together with the
+  // coordinates it has been filled with into each grid, to that file.
+
+  // Fill grids again from such an event record, e.g. after changing their
+  // architecture or subprocess configuration. The grids are booked as
+  // usual and passed by their name in the record, which is
+  // "<histoDir>/<histogram name>", e.g. "/MCgrid_CDF_2009_S8383952/d02-x01-y01".
+  // Fills of recorded grids without a matching entry are skipped, and booked
+  // grids must use the fill mode the record has been written with. Events
+  // are counted as by PDFHandler::HandleEvent, so the grids are scaled,
+  // exported and checked out afterwards as in an analysis.
+  //
+  // The record is read by nThreads threads, which use the fill thread slots
+  // 0 to nThreads-1 (see setFillThreadSlot).
+  void replayRecord(std::string const& recordFile,
+                    std::map<std::string, gridPtr> const& grids,
+                    const int nThreads = 1);
+}
+
+#endif
@@ -0,0 +1,266 @@
+//
+//  applContraction.cpp
+//  MCgrid 17/10/2026.
+//
+
+#include "config.h"
+
+#if APPLGRID_ENABLED
+
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+#include <unordered_set>
+
+#include "appl_grid/appl_grid.h"
+#include "appl_grid/appl_igrid.h"
+
+#include "applContraction.hh"
+#include "exportQueue.hh"
+
+using std::cerr;
+using std::endl;
+
+namespace MCgrid {
+
+  /*
+   *  The generic PDF of an order is bilinear in the PDFs of both beams, so
+   *  evaluating it for single partons a and b gives the factor of the pair
+   *  in each subprocess.
+   */
+  applContraction::applContraction(appl::grid& grid):
+    isScaleLogGrid(grid.calculation() == 1),
+    leadingOrder(grid.leadingOrder()),
+    alphasPrefactor(isScaleLogGrid ? 4*M_PI : 1/(2*M_PI))
+  {
+    const int nOrders = grid.nloops() + 1;
+    const int nBins = grid.Nobs();
+    grids.resize(nOrders, std::vector<coefficientGrid>(nBins));
+    pairs.resize(nOrders);
+
+    for (int order(0); order<nOrders; order++) {
+      appl::appl_pdf* genpdf = grid.genpdf(order);
+      std::vector<double> fA(pdfNodes::nPartons, 0.0), fB(pdfNodes::nPartons, 0.0);
+      std::vector<double> H(genpdf->Nproc());
+      pairs[order].resize(genpdf->Nproc());
+      for (int a(0); a<pdfNodes::nPartons; a++) {
+        for (int b(0); b<pdfNodes::nPartons; b++) {
+          fA[a] = 1.0;
+          fB[b] = 1.0;
+          genpdf->evaluate(&fA[0], &fB[0], &H[0]);
+          fA[a] = 0.0;
+          fB[b] = 0.0;
+          for (size_t ip(0); ip<H.size(); ip++) {
+            if (H[ip] != 0.0) {
+              const partonPair pair = {a, b, H[ip]};
+              pairs[order][ip].push_back(pair);
+            }
+          }
+        }
+      }
+
+      for (int bin(0); bin<nBins; bin++) {
+        appl::igrid* weights = grid.weightgrid(order, bin);
+        coefficientGrid& coefficients = grids[order][bin];
+        if (weights == NULL)
+          continue;
+        std::vector<const SparseMatrix3d*> subprocesses;
+        for (int ip(0); ip<std::min(weights->SubProcesses(), genpdf->Nproc()); ip++)
+          subprocesses.push_back(weights->weightgrid(ip));
+        for (int iy(0); iy<weights->Ny1(); iy++)
+          coefficients.x1.push_back(weights->fx(weights->gety1(iy)));
+        for (int iy(0); iy<weights->Ny2(); iy++)
+          coefficients.x2.push_back(weights->fx(weights->gety2(iy)));
+        for (int tau(0); tau<weights->Ntau(); tau++)
+          coefficients.Q.push_back(std::sqrt(weights->fQ2(weights->gettau(tau))));
+
+        for (int tau(0); tau<weights->Ntau(); tau++) {
+          for (int iy1(0); iy1<weights->Ny1(); iy1++) {
+            for (int iy2(0); iy2<weights->Ny2(); iy2++) {
+              const coefficientNode node = {tau, iy1, iy2, coefficients.coefficients.size(), 0};
+              const double invx1x2 = 1.0/(coefficients.x1[iy1]*coefficients.x2[iy2]);
+              for (size_t ip(0); ip<subprocesses.size(); ip++) {
+                const double weight = (subprocesses[ip] != NULL) ? (*subprocesses[ip])(tau, iy1, iy2) : 0.0;
+                if (weight != 0.0) {
+                  const coefficient c = {(int)ip, weight*invx1x2};
+                  coefficients.coefficients.push_back(c);
+                }
+              }
+              if (coefficients.coefficients.size() > node.first) {
+                coefficients.nodes.push_back(node);
+                coefficients.nodes.back().end = coefficients.coefficients.size();
+              }
+            }
+          }
+        }
+      }
+    }
+
+    // vconvolute divides by the number of runs and the bin width
+    const double run = grid.run();
+    for (int bin(0); bin<nBins; bin++)
+      binNormalisation.push_back(((run != 0.0) ? 1.0/run : 1.0) / grid.deltaobs(bin));
+  }
+
+  bool applContraction::supports(scaleFactors const& scales, const int nLoops) const
+  {
+    if (isScaleLogGrid)
+      return grids.size() >= 4;
+    return nLoops == 0 || (scales.muR == 1.0 && scales.muF == 1.0);
+  }
+
+  /*
+   *  In the aMC@NLO convention, the NLO prediction is the LO grid plus the
+   *  NLO grid and the grids of the renormalisation and factorisation scale
+   *  logarithms, multiplied by the logarithms of the scale factors.
+   */
+  std::vector<applContraction::contribution> applContraction::contributions(scaleFactors const& scales,
+                                                                            const int nLoops) const
+  {
+    std::vector<contribution> terms;
+    if (isScaleLogGrid) {
+      const contribution lo = {3, leadingOrder, 1.0};
+      terms.push_back(lo);
+      if (nLoops != 0) {
+        const contribution nlo = {0, leadingOrder + 1, 1.0};
+        const contribution renormalisation = {1, leadingOrder + 1, std::log(scales.muR*scales.muR)};
+        const contribution factorisation = {2, leadingOrder + 1, std::log(scales.muF*scales.muF)};
+        terms.push_back(nlo);
+        terms.push_back(renormalisation);
+        terms.push_back(factorisation);
+      }
+      return terms;
+    }
+
+    const int nOrders = (nLoops < 0) ? grids.size() : std::min((size_t)nLoops + 1, grids.size());
+    for (int order(0); order<nOrders; order++) {
+      const contribution term = {order, leadingOrder + order, 1.0};
+      terms.push_back(term);
+    }
+    return terms;
+  }
+
+  void applContraction::nodes(std::vector<scaleFactors> const& scales,
+                              std::vector<pdfNode>& xfxNodeList,
+                              std::vector<double>& alphasNodeList) const
+  {
+    std::unordered_set<pdfNode, pdfNodeHash> xfxNodes;
+    std::unordered_set<double> alphasNodes;
+    const double muF = scales.front().muF;
+    for (size_t order(0); order<grids.size(); order++) {
+      for (size_t bin(0); bin<grids[order].size(); bin++) {
+        coefficientGrid const& grid = grids[order][bin];
+        for (size_t n(0); n<grid.nodes.size(); n++) {
+          const double Q = grid.Q[grid.nodes[n].tau];
+          xfxNodes.insert(pdfNode(grid.x1[grid.nodes[n].iy1], Q*muF));
+          xfxNodes.insert(pdfNode(grid.x2[grid.nodes[n].iy2], Q*muF));
+          for (size_t s(0); s<scales.size(); s++)
+            alphasNodes.insert(Q*scales[s].muR);
+        }
+      }
+    }
+    xfxNodeList.assign(xfxNodes.begin(), xfxNodes.end());
+    alphasNodeList.assign(alphasNodes.begin(), alphasNodes.end());
+  }
+
+  // The nodes of a contraction are tabulated in the block, see nodes
+  static const double* tabulatedXfx(pdfMemberBlockTable const& block, const double x, const double Q)
+  {
+    const double* values = block.xfxBlock(x, Q);
+    if (values == NULL) {
+      cerr << "MCgrid::Error - The PDFs at x = " << x << ", Q = " << Q << " have not been tabulated." << endl;
+      stopOnError("PDF node not tabulated");
+    }
+    return values;
+  }
+
+  static const double* tabulatedAlphas(pdfMemberBlockTable const& block, const double Q)
+  {
+    const double* values = block.alphasBlock(Q);
+    if (values == NULL) {
+      cerr << "MCgrid::Error - alpha_s at Q = " << Q << " has not been tabulated." << endl;
+      stopOnError("alpha_s node not tabulated");
+    }
+    return values;
+  }
+
+  /*
+   *  The grids of the orders the scale choices need are contracted once. A
+   *  scale choice then adds the sum of each tau node of a grid, multiplied
+   *  by its factor and the power of alpha_s at its renormalisation scale.
+   */
+  std::vector< std::vector<double> > applContraction::contract(pdfMemberBlockTable const& block,
+                                                               std::vector<scaleFactors> const& scales,
+                                                               const int nLoops,
+                                                               const size_t bin) const
+  {
+    std::vector< std::vector<contribution> > terms;
+    std::vector<bool> isNeeded(grids.size(), false);
+    for (size_t s(0); s<scales.size(); s++) {
+      terms.push_back(contributions(scales[s], nLoops));
+      for (size_t t(0); t<terms.back().size(); t++)
+        if (terms.back()[t].factor != 0.0)
+          isNeeded[terms.back()[t].order] = true;
+    }
+
+    std::vector< std::vector<double> > sigma(scales.size(), std::vector<double>(block.size(), 0.0));
+    for (size_t order(0); order<grids.size(); order++) {
+      if (!isNeeded[order])
+        continue;
+      coefficientGrid const& grid = grids[order][bin];
+      const std::vector< std::vector<double> > tauSums = contractGrid(grid, pairs[order], block, scales.front().muF);
+
+      for (size_t s(0); s<scales.size(); s++) {
+        for (size_t t(0); t<terms[s].size(); t++) {
+          contribution const& term = terms[s][t];
+          if (term.order != (int)order || term.factor == 0.0)
+            continue;
+          for (size_t tau(0); tau<tauSums.size(); tau++) {
+            if (tauSums[tau].empty())
+              continue;
+            const double* alphas = tabulatedAlphas(block, grid.Q[tau]*scales[s].muR);
+            for (int m(0); m<block.size(); m++)
+              sigma[s][m] += term.factor*std::pow(alphasPrefactor*alphas[m], term.power)*tauSums[tau][m];
+          }
+        }
+      }
+    }
+
+    for (size_t s(0); s<scales.size(); s++)
+      for (int m(0); m<block.size(); m++)
+        sigma[s][m] *= binNormalisation[bin];
+    return sigma;
+  }
+
+  std::vector< std::vector<double> > applContraction::contractGrid(coefficientGrid const& grid,
+                                                                   std::vector< std::vector<partonPair> > const& subprocesses,
+                                                                   pdfMemberBlockTable const& block,
+                                                                   const double muF) const
+  {
+    const int nMembers = block.size();
+    std::vector< std::vector<double> > tauSums(grid.Q.size());
+    for (size_t n(0); n<grid.nodes.size(); n++) {
+      coefficientNode const& node = grid.nodes[n];
+      std::vector<double>& tauSum = tauSums[node.tau];
+      if (tauSum.empty())
+        tauSum.resize(nMembers, 0.0);
+      const double Q = grid.Q[node.tau]*muF;
+      const double* f1 = tabulatedXfx(block, grid.x1[node.iy1], Q);
+      const double* f2 = tabulatedXfx(block, grid.x2[node.iy2], Q);
+      for (size_t c(node.first); c<node.end; c++) {
+        std::vector<partonPair> const& subprocess = subprocesses[grid.coefficients[c].subprocess];
+        for (size_t p(0); p<subprocess.size(); p++) {
+          const double weight = grid.coefficients[c].weight*subprocess[p].factor;
+          const double* fa = f1 + subprocess[p].a*nMembers;
+          const double* fb = f2 + subprocess[p].b*nMembers;
+          for (int m(0); m<nMembers; m++)
+            tauSum[m] += weight*fa[m]*fb[m];
+        }
+      }
+    }
+    return tauSums;
+  }
+
+}
+
+#endif
@@ -0,0 +1,109 @@
+//
+//  applContraction.hh
+//  MCgrid 17/10/2026.
+//
+
+#ifndef mcgrid_appl_contraction_hh
+#define mcgrid_appl_contraction_hh
+
+#include <vector>
+
+#include "memberContraction.hh"
+
+namespace appl { class grid; }
+
+namespace MCgrid {
+
+  /**
+   * MCgrid::applContraction contracts the coefficients of an APPLgrid with
+   * blocks of PDF members. The coefficients of all bins and orders are read
+   * once, with 1/(x1 x2) folded in, and the subprocesses of each order are
+   * decomposed into weighted parton pairs by evaluating its generic PDF on
+   * single partons. At every node the members of the block are innermost,
+   * so each coefficient is applied to all members in one small product.
+   *
+   * Grids in the aMC@NLO convention, which MCgrid books for the scale
+   * logarithms, are contracted for any scale choice. Each grid is contracted
+   * once per factorisation scale factor, keeping a sum per tau node, and the
+   * renormalisation scale choices are then formed from these sums with the
+   * logarithms of the scale factors and the powers of alpha_s at the varied
+   * scales. Other grids are only contracted at the central scale or at LO,
+   * as APPLgrid computes their scale terms from splitting functions.
+   **/
+  class applContraction: public memberContraction
+  {
+  public:
+    applContraction(appl::grid& grid);
+
+    bool supports(scaleFactors const& scales, const int nLoops) const;
+
+    void nodes(std::vector<scaleFactors> const& scales,
+               std::vector<pdfNode>& xfxNodeList,
+               std::vector<double>& alphasNodeList) const;
+
+    size_t nBins() const { return binNormalisation.size(); };
+
+    std::vector< std::vector<double> > contract(pdfMemberBlockTable const& block,
+                                                std::vector<scaleFactors> const& scales,
+                                                const int nLoops,
+                                                const size_t bin) const;
+
+  private:
+    // x1 f_a(x1) * x2 f_b(x2) contributes to a subprocess with this factor
+    struct partonPair
+    {
+      int a, b;
+      double factor;
+    };
+
+    // The coefficient of a subprocess at a node, divided by x1 x2
+    struct coefficient
+    {
+      int subprocess;
+      double weight;
+    };
+
+    // A (tau, y1, y2) node with non-zero coefficients
+    struct coefficientNode
+    {
+      int tau, iy1, iy2;
+      size_t first, end;   //!< Range of its coefficients
+    };
+
+    // The coefficients of one order of one bin, with the nodes ordered by tau
+    struct coefficientGrid
+    {
+      std::vector<double> x1, x2, Q;   //!< Node values of y1, y2 and tau
+      std::vector<coefficientNode> nodes;
+      std::vector<coefficient> coefficients;
+    };
+
+    // A grid of each bin contributes alpha_s^power with this factor
+    struct contribution
+    {
+      int order;
+      int power;
+      double factor;
+    };
+
+    std::vector<contribution> contributions(scaleFactors const& scales, const int nLoops) const;
+
+    // The sums over the nodes of a grid at each tau node with the PDFs of the
+    // members, indexed by tau node and member. Tau nodes without coefficients
+    // are empty
+    std::vector< std::vector<double> > contractGrid(coefficientGrid const& grid,
+                                                    std::vector< std::vector<partonPair> > const& subprocesses,
+                                                    pdfMemberBlockTable const& block,
+                                                    const double muF) const;
+
+    bool isScaleLogGrid;           //!< aMC@NLO convention: LO in grid 3, NLO and its logs in 0, 1 and 2
+    int leadingOrder;
+    double alphasPrefactor;
+    std::vector< std::vector<coefficientGrid> > grids;                //!< [order][bin]
+    std::vector< std::vector< std::vector<partonPair> > > pairs;      //!< [order][subprocess]
+    std::vector<double> binNormalisation;                             //!< 1/(run * bin width)
+  };
+
+}
+
+#endif
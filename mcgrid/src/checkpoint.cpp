@@ -0,0 +1,362 @@
+//
+//  checkpoint.cpp
+//  MCgrid 17/10/2026.
+//
+
+#include "checkpoint.hh"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+
+#include "mcgrid/mcgrid_pdf.hh"
+#include "mcgrid.hh"
+#include "grid.hh"
+#include "system.hh"
+#include "threading.hh"
+#include "trace.hh"
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+namespace MCgrid {
+
+  namespace {
+
+    class eventCountSnapshot: public checkpointSnapshot
+    {
+    public:
+      eventCountSnapshot(mcgrid_base_pdf const& _pdf):
+        pdf(_pdf), counts(_pdf.EventCountSnapshot()) {};
+
+      void write(std::string const& path) const { pdf.ExportEventCounts(path, counts); };
+
+    private:
+      mcgrid_base_pdf const& pdf;
+      const std::vector<uint64_t> counts;
+    };
+
+    // A grid of the resumed checkpoint that has not been booked again yet
+    class carriedFile: public checkpointSnapshot
+    {
+    public:
+      carriedFile(std::string const& _source): source(_source) {};
+
+      void write(std::string const& path) const
+      {
+        std::ifstream in(source.c_str(), std::ios::binary);
+        std::ofstream out(path.c_str(), std::ios::binary);
+        out << in.rdbuf();
+      }
+
+    private:
+      const std::string source;
+    };
+
+    struct pendingFile
+    {
+      std::string path;
+      checkpointSnapshot* snapshot;
+    };
+
+    // Write to a temporary file first, such that a preempted job never
+    // leaves an incomplete file behind under the final name
+    void writeFile(pendingFile const& file)
+    {
+      const std::string temporaryPath = file.path + ".tmp";
+      file.snapshot->write(temporaryPath);
+      std::rename(temporaryPath.c_str(), file.path.c_str());
+    }
+
+  }
+
+  // ************************* checkpointer *******************************
+
+  checkpointer* checkpointer::fromEnvironment()
+  {
+    const uint64_t eventInterval = strtoull(environmentVariableForKey("MCGRID_CHECKPOINT_EVENTS").c_str(), NULL, 10);
+    const double secondInterval = atof(environmentVariableForKey("MCGRID_CHECKPOINT_SECONDS").c_str());
+    if (eventInterval == 0 && secondInterval <= 0.0)
+      return NULL;
+    return new checkpointer(eventInterval, secondInterval);
+  }
+
+  checkpointer::checkpointer(const uint64_t _eventInterval, const double _secondInterval):
+    eventInterval(_eventInterval),
+    secondInterval(_secondInterval),
+    directory(MCgridOutputPath() + "/checkpoint"),
+    generation(0),
+    nResumedEvents(0),
+    resumedWeightSum(0.0),
+    lastCheckpointEvents(0),
+    lastCheckpointTime(std::chrono::steady_clock::now().time_since_epoch().count()),
+    isWriting(false),
+    isBarrierPending(false),
+    nArrivedThreads(0),
+    nReleasedBarriers(0)
+  {
+    createPath(MCgridOutputPath());
+    createPath(directory);
+    readManifest();
+    lastCheckpointEvents = nResumedEvents;
+  }
+
+  checkpointer::~checkpointer()
+  {
+    if (writer.joinable())
+      writer.join();
+    if (generation == 0)
+      return;
+
+    cout << "MCgrid: Removing the checkpoint of the finished run" << endl;
+    std::remove(manifestPath().c_str());
+    for (uint64_t parity=0; parity<2; parity++) {
+      for (std::set<std::string>::const_iterator name = gridNames.begin(); name != gridNames.end(); ++name)
+        std::remove(filePath(*name, parity).c_str());
+      for (size_t i(0); i<eventCounters.size(); i++)
+        std::remove(filePath(eventCounters[i]->name() + ".evtcount", parity).c_str());
+    }
+  }
+
+  std::string checkpointer::manifestPath() const
+  {
+    return directory + "/manifest";
+  }
+
+  // The files of consecutive checkpoints alternate between two sets
+  std::string checkpointer::filePath(std::string const& name, const uint64_t generation) const
+  {
+    std::stringstream path;
+    path << directory << "/" << name << "." << (generation % 2);
+    return path.str();
+  }
+
+  /*
+   *  The manifest is plain text, one entry per line:
+   *    Generation: <n>
+   *    NEvents: <n>
+   *    SumOfWeights: <w>
+   *    Grid: <analysis>/<histogram> <kind>
+   *    EventCounter: <subprocess PDF name>
+   */
+  void checkpointer::readManifest()
+  {
+    std::ifstream file(manifestPath().c_str());
+    if (!file.good())
+      return;
+
+    std::string key;
+    while (file >> key) {
+      if (key == "Generation:") {
+        file >> generation;
+      } else if (key == "NEvents:") {
+        file >> nResumedEvents;
+      } else if (key == "SumOfWeights:") {
+        file >> resumedWeightSum;
+      } else if (key == "Grid:") {
+        std::string name, kind;
+        file >> name >> kind;
+        resumedGrids[name] = kind;
+        gridNames.insert(name);
+      } else if (key == "EventCounter:") {
+        std::string name;
+        file >> name;
+        resumedEventCounters.push_back(name);
+      } else {
+        cerr << "MCgrid::Error - The checkpoint manifest " << manifestPath() << " is incorrectly formatted." << endl;
+        exit(-1);
+      }
+    }
+    cout << "MCgrid: Resuming from checkpoint " << generation << " after ";
+    cout << nResumedEvents << " events" << endl;
+  }
+
+  void checkpointer::addGrid(_grid* grid)
+  {
+    if (!grid->isCheckpointable()) {
+      cerr << "MCgrid::Error - The grid " << grid->recordName() << " can not be checkpointed, ";
+      cerr << "only warmup runs, APPLgrid grids and fastNLO tables support checkpoints." << endl;
+      exit(-1);
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    grids.push_back(grid);
+    gridNames.insert(grid->recordName());
+
+    if (generation == 0)
+      return;
+    std::map<std::string, std::string>::const_iterator entry = resumedGrids.find(grid->recordName());
+    if (entry == resumedGrids.end()) {
+      cout << "MCgrid: " << grid->recordName() << " is not part of the checkpoint, it starts empty" << endl;
+      return;
+    }
+    if (entry->second != grid->checkpointKind()) {
+      cerr << "MCgrid::Error - The checkpoint in " << directory << " does not contain the ";
+      cerr << grid->checkpointKind() << " of " << grid->recordName() << "." << endl;
+      cerr << "                Remove the checkpoint to start the run from scratch." << endl;
+      exit(-1);
+    }
+    traceSpan span("checkpoint", "resume grid", grid->recordName());
+    grid->resume(filePath(grid->recordName(), generation));
+    resumedGrids.erase(grid->recordName());
+  }
+
+  void checkpointer::removeGrid(_grid* grid)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    grids.erase(std::remove(grids.begin(), grids.end(), grid), grids.end());
+  }
+
+  void checkpointer::addEventCounter(mcgrid_base_pdf* pdf)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    eventCounters.push_back(pdf);
+
+    if (generation == 0)
+      return;
+    for (size_t i(0); i<resumedEventCounters.size(); i++) {
+      if (resumedEventCounters[i] == pdf->name()) {
+        pdf->ResumeEventCounts(filePath(pdf->name() + ".evtcount", generation));
+        return;
+      }
+    }
+    cerr << "MCgrid::Error - The checkpoint in " << directory << " does not contain the ";
+    cerr << "event counts of " << pdf->name() << "." << endl;
+    cerr << "                Remove the checkpoint to start the run from scratch." << endl;
+    exit(-1);
+  }
+
+  // Another thread may have taken a checkpoint since the calling thread
+  // read the number of events
+  bool checkpointer::isDue(const uint64_t nEvents) const
+  {
+    if (nEvents <= lastCheckpointEvents.load() || isWriting.load())
+      return false;
+    if (eventInterval > 0 && nEvents - lastCheckpointEvents.load() >= eventInterval)
+      return true;
+    if (secondInterval <= 0.0)
+      return false;
+    const std::chrono::steady_clock::duration elapsed(std::chrono::steady_clock::now().time_since_epoch().count()
+                                                      - lastCheckpointTime.load());
+    return std::chrono::duration<double>(elapsed).count() >= secondInterval;
+  }
+
+  void checkpointer::postpone(const uint64_t nEvents)
+  {
+    lastCheckpointEvents.store(nEvents);
+    lastCheckpointTime.store(std::chrono::steady_clock::now().time_since_epoch().count());
+  }
+
+  void checkpointer::releaseBarrier()
+  {
+    isBarrierPending.store(false);
+    nReleasedBarriers++;
+    barrierReleased.notify_all();
+  }
+
+  // The fill threads gather in the barrier between two of their events, so
+  // the last one to arrive copies the grids while none of them fills. The
+  // number of events is read again then, as the other threads have counted
+  // events since the calling thread read it
+  void checkpointer::handleEvent(const uint64_t nEvents)
+  {
+    fillThreadSlot();
+    if (!isBarrierPending.load() && !isDue(nEvents))
+      return;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    if (!isBarrierPending.load()) {
+      if (!isDue(nEvents))
+        return;
+      isBarrierPending.store(true);
+      nArrivedThreads = 0;
+    }
+
+    const uint64_t barrier = nReleasedBarriers;
+    nArrivedThreads++;
+    if (nArrivedThreads >= numberOfFillThreadSlots()) {
+      takeCheckpoint(PDFHandler::NEvents(), PDFHandler::SumOfWeights());
+      releaseBarrier();
+      return;
+    }
+
+    const bool isReleased = barrierReleased.wait_for(lock, std::chrono::seconds(barrierTimeout),
+                                                     [this, barrier]() { return nReleasedBarriers != barrier; });
+    if (!isReleased) {
+      cout << "MCgrid: Skipping a checkpoint, only " << nArrivedThreads << " of ";
+      cout << numberOfFillThreadSlots() << " fill threads reached it within ";
+      cout << barrierTimeout << " seconds" << endl;
+      postpone(PDFHandler::NEvents());
+      releaseBarrier();
+    }
+  }
+
+  // Only the snapshots are taken here, writing them is left to the writer
+  void checkpointer::takeCheckpoint(const uint64_t nEvents, const double sumOfWeights)
+  {
+    traceSpan span("checkpoint", "take checkpoint");
+    if (writer.joinable())
+      writer.join();
+
+    generation++;
+    postpone(nEvents);
+
+    std::stringstream manifest;
+    manifest << "Generation: " << generation << endl;
+    manifest << "NEvents: " << nEvents << endl;
+    manifest.precision(17);
+    manifest << "SumOfWeights: " << sumOfWeights << endl;
+
+    std::vector<pendingFile> files;
+    for (size_t i(0); i<grids.size(); i++) {
+      const std::string::size_type slash = grids[i]->recordName().find('/');
+      createPath(directory + "/" + grids[i]->recordName().substr(0, slash));
+      pendingFile file;
+      file.path = filePath(grids[i]->recordName(), generation);
+      file.snapshot = grids[i]->snapshot();
+      files.push_back(file);
+      manifest << "Grid: " << grids[i]->recordName() << " " << grids[i]->checkpointKind() << endl;
+    }
+    // The files of the previous checkpoint are complete, as its writer has
+    // been joined, and are not overwritten by this one
+    for (std::map<std::string, std::string>::const_iterator carried = resumedGrids.begin();
+         carried != resumedGrids.end(); ++carried) {
+      createPath(directory + "/" + carried->first.substr(0, carried->first.find('/')));
+      pendingFile file;
+      file.path = filePath(carried->first, generation);
+      file.snapshot = new carriedFile(filePath(carried->first, generation - 1));
+      files.push_back(file);
+      manifest << "Grid: " << carried->first << " " << carried->second << endl;
+    }
+    for (size_t i(0); i<eventCounters.size(); i++) {
+      pendingFile file;
+      file.path = filePath(eventCounters[i]->name() + ".evtcount", generation);
+      file.snapshot = new eventCountSnapshot(*eventCounters[i]);
+      files.push_back(file);
+      manifest << "EventCounter: " << eventCounters[i]->name() << endl;
+    }
+
+    cout << "MCgrid: Writing checkpoint " << generation << " after " << nEvents << " events" << endl;
+    isWriting.store(true);
+    const std::string manifestText = manifest.str();
+    const std::string path = manifestPath();
+    writer = std::thread([this, files, manifestText, path]() {
+      traceSpan writeSpan("checkpoint", "write checkpoint");
+      for (size_t i(0); i<files.size(); i++) {
+        writeFile(files[i]);
+        delete files[i].snapshot;
+      }
+      const std::string temporaryPath = path + ".tmp";
+      {
+        std::ofstream manifest(temporaryPath.c_str());
+        manifest << manifestText;
+      }
+      std::rename(temporaryPath.c_str(), path.c_str());
+      isWriting.store(false);
+    });
+  }
+
+}
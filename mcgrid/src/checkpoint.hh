@@ -0,0 +1,136 @@
+//
+//  checkpoint.hh
+//  MCgrid 17/10/2026.
+//
+
+#ifndef mcgrid_checkpoint_hh
+#define mcgrid_checkpoint_hh
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <stdint.h>
+
+namespace MCgrid {
+
+  class _grid;
+  class mcgrid_base_pdf;
+
+  /**
+   * MCgrid::checkpointSnapshot is a copy of the state of a grid or an event
+   * counter, taken between two events. It is written by the checkpoint
+   * writer thread while the event loop continues.
+   **/
+  class checkpointSnapshot
+  {
+  public:
+    virtual ~checkpointSnapshot() {};
+    virtual void write(std::string const& path) const = 0;
+  };
+
+  /**
+   * MCgrid::checkpointer periodically writes the booked grids, the
+   * subprocess event counters and the number of events of a run to
+   * <MCGRID_OUTPUT_PATH>/checkpoint, every MCGRID_CHECKPOINT_EVENTS events
+   * and/or every MCGRID_CHECKPOINT_SECONDS seconds. The sum of the event
+   * weights is checkpointed as well, such that resumed grids can correct the
+   * normalisation given for the events after the resumption.
+   *
+   * A checkpoint is taken when an event is counted, before any of its fills,
+   * so it contains complete events only. No thread may fill while the
+   * snapshots are copied, so once a checkpoint is due every fill thread
+   * waits in a barrier when it counts its next event, and the last one to
+   * arrive takes the snapshots. If not all fill threads arrive within
+   * barrierTimeout seconds, for example as a thread has run out of events,
+   * the checkpoint is skipped. The snapshots are written by a background
+   * thread, into one of two sets of files alternating between checkpoints. The manifest is written last and
+   * selects the complete set, such that a job preempted while writing still
+   * resumes from the previous checkpoint. If a checkpoint is due while the
+   * previous one is still being written, it is postponed.
+   *
+   * A run finding a manifest resumes from it: the event count is restored
+   * and each grid and event counter adds its snapshot when it is booked.
+   * Grids missing from the checkpoint, such as lazily booked bins of a
+   * BinnedGrid which had no events yet, start empty. Checkpointed grids
+   * that are not booked again are carried over to the next checkpoint.
+   * The checkpoint is removed once the run has finished.
+   **/
+  class checkpointer
+  {
+  public:
+    // NULL if neither MCGRID_CHECKPOINT_EVENTS nor MCGRID_CHECKPOINT_SECONDS is set
+    static checkpointer* fromEnvironment();
+
+    // Waits for the writer and removes the checkpoint, as this is only
+    // called once the run has finished
+    ~checkpointer();
+
+    // Number of events of the checkpoint the run resumes from, or zero
+    uint64_t resumedEvents() const { return nResumedEvents; };
+
+    // Sum of the event weights of the checkpoint the run resumes from, or zero
+    double resumedSumOfWeights() const { return resumedWeightSum; };
+
+    // Add a grid or event counter to the checkpoints, resuming its state
+    // from the checkpoint if there is one
+    void addGrid(_grid*);
+    void addEventCounter(mcgrid_base_pdf*);
+
+    // Remove a grid that is destroyed before the run has finished
+    void removeGrid(_grid*);
+
+    // Called by each fill thread before it counts an event, with the number
+    // of events counted so far. Waits in the barrier of a due checkpoint
+    void handleEvent(const uint64_t nEvents);
+
+    // Seconds the fill threads wait for each other in the barrier
+    static const int barrierTimeout = 60;
+
+  private:
+    checkpointer(const uint64_t eventInterval, const double secondInterval);
+    checkpointer(checkpointer const&);
+    checkpointer& operator=(checkpointer const&);
+
+    void readManifest();
+    bool isDue(const uint64_t nEvents) const;
+    void takeCheckpoint(const uint64_t nEvents, const double sumOfWeights);
+    void postpone(const uint64_t nEvents);
+    void releaseBarrier();
+    std::string manifestPath() const;
+    std::string filePath(std::string const& name, const uint64_t generation) const;
+
+    const uint64_t eventInterval;    //!< Events between checkpoints, or 0
+    const double secondInterval;     //!< Seconds between checkpoints, or 0
+    const std::string directory;
+
+    std::vector<_grid*> grids;
+    std::set<std::string> gridNames;   //!< Names of all grids ever added, to remove their files
+    std::vector<mcgrid_base_pdf*> eventCounters;
+
+    uint64_t generation;             //!< Number of the last checkpoint
+    uint64_t nResumedEvents;
+    double resumedWeightSum;
+    std::map<std::string, std::string> resumedGrids;   //!< Name and kind of the resumed grids not booked yet
+    std::vector<std::string> resumedEventCounters;
+
+    std::atomic<uint64_t> lastCheckpointEvents;
+    std::atomic<std::chrono::steady_clock::rep> lastCheckpointTime;   //!< Ticks of the steady clock
+    std::thread writer;
+    std::atomic<bool> isWriting;
+
+    std::mutex mutex;                    //!< Guards the grids and the barrier
+    std::condition_variable barrierReleased;
+    std::atomic<bool> isBarrierPending;  //!< Whether the fill threads gather for a checkpoint
+    int nArrivedThreads;                 //!< Fill threads waiting in the barrier
+    uint64_t nReleasedBarriers;
+  };
+
+}
+
+#endif
@@ -0,0 +1,134 @@
+//
+//  closureCheck.cpp
+//  MCgrid 17/10/2026.
+//
+
+#include "closureCheck.hh"
+
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <cmath>
+
+#include "config.h"
+
+#include "system.hh"
+#include "exportQueue.hh"
+#if LHAPDF_ENABLED
+#include "mcgrid/mcgrid_convolution.hh"
+#endif
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+namespace MCgrid {
+
+  const double closureCheck::defaultThreshold = 1e-3;
+
+  closureCheck::closureCheck(std::vector<double> const& _lowEdges,
+                             std::vector<double> const& _highEdges):
+    lowEdges(_lowEdges),
+    highEdges(_highEdges),
+    normalisation(1.0)
+  { }
+
+  bool closureCheck::isEnabled()
+  {
+    return environmentVariableForKey("MCGRID_CLOSURE_PDF") != "";
+  }
+
+  void closureCheck::add(const int bin, const double wgt)
+  {
+    if (bin < 0)
+      return;
+    std::vector<double>& sums = threadSums.local();
+    if (sums.empty())
+      sums.resize(lowEdges.size(), 0.0);
+    sums[bin] += wgt;
+  }
+
+  // The threads are summed in slot order, as the subprocess event counters
+  std::vector<double> closureCheck::reference() const
+  {
+    std::vector<double> result(lowEdges.size(), 0.0);
+    for (int slot=0; slot<maxFillThreads; slot++) {
+      std::vector<double>* sums = threadSums.get(slot);
+      if (sums == NULL || sums->empty())
+        continue;
+      for (size_t i(0); i<result.size(); i++)
+        result[i] += (*sums)[i];
+    }
+    for (size_t i(0); i<result.size(); i++)
+      result[i] *= normalisation / (highEdges[i] - lowEdges[i]);
+    return result;
+  }
+
+  /*
+   *  MCGRID_CLOSURE_PDF is an LHAPDF set name, optionally followed by the
+   *  member, e.g. "CT10/0". The grid is convoluted at the central scale.
+   */
+  void closureCheck::check(std::string const& gridFile, std::string const& gridName) const
+  {
+#if LHAPDF_ENABLED
+    std::string pdfSet = environmentVariableForKey("MCGRID_CLOSURE_PDF");
+    int member(0);
+    const size_t slash = pdfSet.find('/');
+    if (slash != std::string::npos) {
+      member = atoi(pdfSet.substr(slash + 1).c_str());
+      pdfSet = pdfSet.substr(0, slash);
+    }
+
+    double threshold(defaultThreshold);
+    const std::string thresholdString = environmentVariableForKey("MCGRID_CLOSURE_THRESHOLD");
+    if (thresholdString != "")
+      threshold = atof(thresholdString.c_str());
+
+    gridConvolution convolution(gridFile);
+    const std::vector<double> prediction = convolution.convolute(pdfSet, member,
+                                                                 std::vector<scaleFactors>(1))[0];
+    const std::vector<double> expected = reference();
+
+    if (prediction.size() != expected.size()) {
+      cerr << "MCgrid::Error - Closure check of " << gridName << " failed: the grid has ";
+      cerr << prediction.size() << " bins, but the histogram has " << expected.size() << "." << endl;
+      stopOnError("closure check failed, wrong number of bins");
+    }
+
+    std::ofstream file((gridFile + ".closure").c_str());
+    file << "# Closure check of " << gridName << " with " << pdfSet << "/" << member << endl;
+    file << "# low high reference grid relative_deviation" << endl;
+    file.precision(10);
+
+    double maxDeviation(0.0);
+    size_t maxBin(0);
+    for (size_t i(0); i<expected.size(); i++) {
+      double deviation(0.0);
+      if (expected[i] != 0.0)
+        deviation = std::fabs(prediction[i]/expected[i] - 1.0);
+      else if (prediction[i] != 0.0)
+        deviation = INFINITY;
+      file << lowEdges[i] << " " << highEdges[i] << " " << expected[i] << " ";
+      file << prediction[i] << " " << deviation << endl;
+      if (deviation > maxDeviation) {
+        maxDeviation = deviation;
+        maxBin = i;
+      }
+    }
+
+    cout << "MCgrid: Closure check of " << gridName << ": maximum relative deviation ";
+    cout << maxDeviation << " in bin " << maxBin << endl;
+    if (maxDeviation > threshold) {
+      cerr << "MCgrid::Error - Closure check of " << gridName << " failed: the relative deviation ";
+      cerr << "of bin " << maxBin << " [" << lowEdges[maxBin] << ", " << highEdges[maxBin] << "] is ";
+      cerr << maxDeviation << ", above the threshold of " << threshold << "." << endl;
+      cerr << "                The deviations of all bins are written to " << gridFile << ".closure" << endl;
+      stopOnError("closure check failed, see " + gridFile + ".closure");
+    }
+#else
+    cout << "MCgrid: Skipping the closure check of " << gridName;
+    cout << ", MCgrid has been configured without LHAPDF 6" << endl;
+#endif
+  }
+
+}
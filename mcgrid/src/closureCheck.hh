@@ -0,0 +1,59 @@
+//
+//  closureCheck.hh
+//  MCgrid 17/10/2026.
+//
+
+#ifndef mcgrid_closure_check_hh
+#define mcgrid_closure_check_hh
+
+#include <string>
+#include <vector>
+
+#include "threading.hh"
+
+namespace MCgrid {
+
+  /**
+   * MCgrid::closureCheck compares an exported grid with the events filled
+   * into it. Each fill thread sums up the event weights per bin, which is
+   * the reference the grid has to reproduce. On export, the grid file is
+   * convoluted with the PDF set given by MCGRID_CLOSURE_PDF, which should be
+   * the one used to generate the events. The relative deviation of each bin
+   * is written next to the grid, and the run is stopped if it exceeds
+   * MCGRID_CLOSURE_THRESHOLD in any bin.
+   **/
+  class closureCheck
+  {
+  public:
+    // The bin edges are those of the histogram the grid is booked for
+    closureCheck(std::vector<double> const& lowEdges,
+                 std::vector<double> const& highEdges);
+
+    // Whether MCGRID_CLOSURE_PDF is set
+    static bool isEnabled();
+
+    // Add the weight of a fill of the calling thread
+    void add(const int bin, const double wgt);
+
+    // Multiply the reference with the normalisation of the grid
+    void scale(const double scale) { normalisation *= scale; };
+
+    // Convolute the grid file and compare it with the reference
+    void check(std::string const& gridFile, std::string const& gridName) const;
+
+    // Default of MCGRID_CLOSURE_THRESHOLD
+    static const double defaultThreshold;
+
+  private:
+    // The reference cross section of each bin, divided by the bin width
+    std::vector<double> reference() const;
+
+    const std::vector<double> lowEdges;
+    const std::vector<double> highEdges;
+    perThread< std::vector<double> > threadSums;   //!< Per-thread sum of weights per bin
+    double normalisation;                          //!< Product of all scale factors
+  };
+
+}
+
+#endif
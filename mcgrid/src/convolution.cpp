@@ -0,0 +1,549 @@
+//
+//  convolution.cpp
+//  MCgrid 17/10/2026.
+//
+
+#include <iostream>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <cmath>
+
+// System
+#include "config.h"
+
+#include "mcgrid/mcgrid_convolution.hh"
+#include "pdfNodeTable.hh"
+#include "memberContraction.hh"
+#include "threading.hh"
+#include "exportQueue.hh"
+
+#include "LHAPDF/LHAPDF.h"
+
+// Interface-specific includes
+#if APPLGRID_ENABLED
+#include "appl_grid/appl_grid.h"
+#include "applContraction.hh"
+#endif
+#if FASTNLO_ENABLED
+#include "fastnlotk/fastNLOReader.h"
+#endif
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+namespace MCgrid
+{
+  // ************************ Utility Functions ****************************
+
+  static bool hasExtension(std::string const& path, std::string const& extension)
+  {
+    return path.size() > extension.size()
+        && path.compare(path.size() - extension.size(), extension.size(), extension) == 0;
+  }
+
+  // Grids are read through ROOT and PDF sets through LHAPDF's global
+  // configuration, which is why loading either is serialised. Grids may be
+  // written by concurrent exports at the same time, see gridFileMutex
+  static std::mutex& loadMutex = gridFileMutex();
+
+  /**
+   * MCgrid::convolutionBackend is the interface to one copy of a grid, which
+   * computes the predictions from the PDFs and alpha_s of one PDF member
+   **/
+  class convolutionBackend
+  {
+  public:
+    virtual ~convolutionBackend() {};
+
+    virtual size_t nBins() const = 0;
+    virtual double binLow(const size_t bin) const = 0;
+    virtual double binHigh(const size_t bin) const = 0;
+
+    virtual std::vector<double> convolute(pdfNodes& table,
+                                          scaleFactors const& scales,
+                                          const int nLoops) = 0;
+
+    // The contraction of blocks of members over the coefficients of the
+    // grid, or NULL if only the grid library can convolute it
+    virtual memberContraction* contraction() { return NULL; };
+  };
+
+  // ************************ APPLgrid convolution ****************************
+
+#if APPLGRID_ENABLED
+  // APPLgrid takes plain function pointers for the PDFs and alpha_s, which
+  // read from the table of the convolution running on the calling thread
+  static thread_local pdfNodes* activeTable = NULL;
+
+  static void tabulatedPDF(const double& x, const double& Q, double* xf)
+  {
+    const double* values = activeTable->xfx(x, Q);
+    std::copy(values, values + pdfNodes::nPartons, xf);
+  }
+
+  static double tabulatedAlphas(const double& Q)
+  {
+    return activeTable->alphas(Q);
+  }
+
+  class applConvolution: public convolutionBackend
+  {
+  public:
+    applConvolution(std::string const& gridFile):
+      native(NULL)
+    {
+      std::lock_guard<std::mutex> lock(loadMutex);
+      grid = new appl::grid(gridFile);
+    }
+
+    ~applConvolution()
+    {
+      delete native;
+      delete grid;
+    }
+
+    size_t nBins() const { return grid->Nobs(); }
+    double binLow(const size_t bin) const { return grid->obslow(bin); }
+    double binHigh(const size_t bin) const { return grid->obslow(bin) + grid->deltaobs(bin); }
+
+    std::vector<double> convolute(pdfNodes& table,
+                                  scaleFactors const& scales,
+                                  const int nLoops)
+    {
+      const int loops = (nLoops < 0) ? grid->nloops() : std::min(nLoops, grid->nloops());
+      activeTable = &table;
+      const std::vector<double> result = grid->vconvolute(tabulatedPDF, tabulatedAlphas, loops,
+                                                          scales.muR, scales.muF);
+      activeTable = NULL;
+      return result;
+    }
+
+    // The coefficients are read on first use
+    memberContraction* contraction()
+    {
+      if (native == NULL)
+        native = new applContraction(*grid);
+      return native;
+    }
+
+  private:
+    appl::grid* grid;
+    applContraction* native;
+  };
+#endif
+
+  // ************************ fastNLO convolution ****************************
+
+#if FASTNLO_ENABLED
+  /*
+   *  fastNLOReader caches the PDFs and alpha_s on the nodes of the table
+   *  itself, and is given them from the pdfNodeTable of the convolution.
+   */
+  class fastnloTabulatedReader: public fastNLOReader
+  {
+  public:
+    fastnloTabulatedReader(std::string const& gridFile):
+      fastNLOReader(gridFile),
+      table(NULL)
+    {}
+
+    void setTable(pdfNodes* _table)
+    {
+      table = _table;
+      FillPDFCache(0., true);
+      FillAlphasCache(true);
+    }
+
+  protected:
+    bool InitPDF() { return (table != NULL); }
+
+    std::vector<double> GetXFX(double x, double muf) const
+    {
+      const double* values = table->xfx(x, muf);
+      return std::vector<double>(values, values + pdfNodes::nPartons);
+    }
+
+    double EvolveAlphas(double Q) const { return table->alphas(Q); }
+
+  private:
+    pdfNodes* table;
+  };
+
+  class fastnloConvolution: public convolutionBackend
+  {
+  public:
+    fastnloConvolution(std::string const& _gridFile):
+      gridFile(_gridFile)
+    {
+      std::lock_guard<std::mutex> lock(loadMutex);
+      reader = new fastnloTabulatedReader(gridFile);
+    }
+
+    ~fastnloConvolution()
+    {
+      delete reader;
+    }
+
+    size_t nBins() const { return reader->GetNObsBin(); }
+    double binLow(const size_t bin) const { return reader->GetObsBinLoBound(bin, 0); }
+    double binHigh(const size_t bin) const { return reader->GetObsBinUpBound(bin, 0); }
+
+    std::vector<double> convolute(pdfNodes& table,
+                                  scaleFactors const& scales,
+                                  const int nLoops)
+    {
+      // MCgrid tables hold the LO and NLO contributions
+      for (unsigned int order(0); order < 2; order++)
+        reader->SetContributionON(fastNLO::kFixedOrder, order, (nLoops < 0) || ((int)order <= nLoops));
+
+      if (!reader->SetScaleFactorsMuRMuF(scales.muR, scales.muF)) {
+        cerr << "MCgrid::Error - The fastNLO table " << gridFile << " does not provide the scale factors ";
+        cerr << "muR = " << scales.muR << ", muF = " << scales.muF << "." << endl;
+        stopOnError("scale factors not provided by " + gridFile);
+      }
+
+      reader->setTable(&table);
+      reader->CalcCrossSection();
+      return reader->GetCrossSection();
+    }
+
+  private:
+    const std::string gridFile;
+    fastnloTabulatedReader* reader;
+  };
+#endif
+
+  static convolutionBackend* loadBackend(std::string const& gridFile)
+  {
+#if APPLGRID_ENABLED
+    if (hasExtension(gridFile, ".root"))
+      return new applConvolution(gridFile);
+#endif
+#if FASTNLO_ENABLED
+    if (hasExtension(gridFile, ".tab"))
+      return new fastnloConvolution(gridFile);
+#endif
+
+    cerr << "MCgrid::Error - Unable to determine the grid interface for " << gridFile << "." << endl;
+    cerr << "                Is this version of MCgrid configured for use with this grid interface?" << endl;
+    stopOnError("unknown grid interface of " + gridFile);
+  }
+
+  // Run task(i, worker) for i < nTasks on up to nThreads worker threads
+  template<class function>
+  static void runTasks(const size_t nTasks, const int nThreads, function const& task)
+  {
+    std::atomic<size_t> nextTask(0);
+    const int nWorkers = std::max(1, std::min(nThreads, (int)nTasks));
+    std::vector<std::thread> workers;
+    for (int w=0; w<nWorkers; w++) {
+      workers.push_back(std::thread([&, w]() {
+        for (size_t i = nextTask++; i < nTasks; i = nextTask++)
+          task(i, w);
+      }));
+    }
+    for (size_t i(0); i<workers.size(); i++)
+      workers[i].join();
+  }
+
+  // Group scale choices by their factorisation scale factor
+  static std::vector< std::vector<size_t> > factorisationScaleGroups(std::vector<scaleFactors> const& scales)
+  {
+    std::vector< std::vector<size_t> > groups;
+    std::vector<double> groupMuF;
+    for (size_t i(0); i<scales.size(); i++) {
+      const size_t group = std::find(groupMuF.begin(), groupMuF.end(), scales[i].muF) - groupMuF.begin();
+      if (group == groupMuF.size()) {
+        groupMuF.push_back(scales[i].muF);
+        groups.push_back(std::vector<size_t>());
+      }
+      groups[group].push_back(i);
+    }
+    return groups;
+  }
+
+  // The predictions of the members of a block for scale choices sharing
+  // their factorisation scale factor, indexed by scale choice, member and
+  // bin. Each bin is a task, which contracts the grids once for all choices
+  static std::vector< std::vector< std::vector<double> > > contractBlock(memberContraction const& native,
+                                                                        pdfMemberBlockTable const& block,
+                                                                        std::vector<scaleFactors> const& scales,
+                                                                        const int nLoops,
+                                                                        const int nThreads)
+  {
+    const size_t nBins = native.nBins();
+    std::vector< std::vector< std::vector<double> > > results(scales.size(),
+      std::vector< std::vector<double> >(block.size(), std::vector<double>(nBins)));
+    runTasks(nBins, nThreads, [&](const size_t bin, const int worker) {
+      const std::vector< std::vector<double> > predictions = native.contract(block, scales, nLoops, bin);
+      for (size_t scale(0); scale<scales.size(); scale++)
+        for (int m(0); m<block.size(); m++)
+          results[scale][m][bin] = predictions[scale][m];
+    });
+    return results;
+  }
+
+  // Relative deviation from the grid library up to which a contraction of
+  // the members is trusted, relative to the largest bin
+  static const double contractionTolerance = 1e-8;
+
+  /*
+   *  The contraction of the members over the coefficients is used for a
+   *  group of scale choices if it reproduces the predictions of the central
+   *  member, which the grid library has convoluted before.
+   */
+  static memberContraction* validatedContraction(convolutionBackend& backend,
+                                                 std::string const& gridFile,
+                                                 std::string const& pdfSet,
+                                                 std::vector<scaleFactors> const& scales,
+                                                 std::vector< std::vector<double> > const& centralResults,
+                                                 const int nLoops,
+                                                 const int nThreads)
+  {
+    memberContraction* native = backend.contraction();
+    if (native == NULL)
+      return NULL;
+    for (size_t i(0); i<scales.size(); i++)
+      if (!native->supports(scales[i], nLoops))
+        return NULL;
+
+    std::vector<pdfNode> xfxNodeList;
+    std::vector<double> alphasNodeList;
+    native->nodes(scales, xfxNodeList, alphasNodeList);
+    pdfMemberBlockTable* central;
+    {
+      std::lock_guard<std::mutex> lock(loadMutex);
+      central = new pdfMemberBlockTable(pdfSet, 0, 1, xfxNodeList, alphasNodeList, nThreads);
+    }
+
+    const std::vector< std::vector< std::vector<double> > > predictions = contractBlock(*native, *central, scales,
+                                                                                      nLoops, nThreads);
+    bool isReproduced = true;
+    for (size_t i(0); i<scales.size() && isReproduced; i++) {
+      std::vector<double> const& prediction = predictions[i][0];
+      std::vector<double> const& reference = centralResults[i];
+      double largest = 0.0;
+      for (size_t bin(0); bin<reference.size(); bin++)
+        largest = std::max(largest, std::abs(reference[bin]));
+      for (size_t bin(0); bin<reference.size() && bin<prediction.size(); bin++)
+        isReproduced = isReproduced && std::abs(prediction[bin] - reference[bin]) <= contractionTolerance*largest;
+      isReproduced = isReproduced && (prediction.size() == reference.size());
+      if (!isReproduced) {
+        cout << "MCgrid: The contraction of the coefficients of " << gridFile << " does not reproduce the grid library ";
+        cout << "for muR = " << scales[i].muR << ", muF = " << scales[i].muF << "," << endl;
+        cout << "                each member is convoluted by the grid library instead." << endl;
+      }
+    }
+    delete central;
+    return isReproduced ? native : NULL;
+  }
+
+  // ************************ Public interface ****************************
+
+  std::vector<scaleFactors> scaleVariations(const int nPoints, const double factor)
+  {
+    if (nPoints != 3 && nPoints != 7 && nPoints != 9) {
+      cerr << "MCgrid::Error - Scale variations with " << nPoints << " points are not supported, use 3, 7 or 9." << endl;
+      exit(-1);
+    }
+
+    const double variations[] = {1.0, factor, 1.0/factor};
+    std::vector<scaleFactors> scales;
+    for (int r(0); r<3; r++) {
+      for (int f(0); f<3; f++) {
+        const bool correlated = (r == f);
+        const bool opposite = (r != 0 && f != 0 && r != f);
+        if ((nPoints == 3 && !correlated) || (nPoints == 7 && opposite))
+          continue;
+        scales.push_back(scaleFactors(variations[r], variations[f]));
+      }
+    }
+    return scales;
+  }
+
+  void scaleEnvelope(std::vector< std::vector<double> > const& predictions,
+                     std::vector<double>& lower,
+                     std::vector<double>& upper)
+  {
+    lower.clear();
+    upper.clear();
+    if (predictions.empty())
+      return;
+    lower = predictions[0];
+    upper = predictions[0];
+    for (size_t i(1); i<predictions.size(); i++) {
+      for (size_t bin(0); bin<lower.size(); bin++) {
+        lower[bin] = std::min(lower[bin], predictions[i][bin]);
+        upper[bin] = std::max(upper[bin], predictions[i][bin]);
+      }
+    }
+  }
+
+  gridConvolution::gridConvolution(std::string const& _gridFile, const int _nThreads):
+    gridFile(_gridFile),
+    nThreads(std::max(1, _nThreads)),
+    backends(nThreads, (convolutionBackend*)NULL),
+    nNodes(0)
+  {
+    backends[0] = loadBackend(gridFile);
+  }
+
+  gridConvolution::~gridConvolution()
+  {
+    for (size_t i(0); i<backends.size(); i++)
+      delete backends[i];
+  }
+
+  size_t gridConvolution::nBins() const
+  {
+    return backends[0]->nBins();
+  }
+
+  double gridConvolution::binLow(const size_t bin) const
+  {
+    return backends[0]->binLow(bin);
+  }
+
+  double gridConvolution::binHigh(const size_t bin) const
+  {
+    return backends[0]->binHigh(bin);
+  }
+
+  convolutionBackend& gridConvolution::backend(const int worker)
+  {
+    if (backends[worker] == NULL)
+      backends[worker] = loadBackend(gridFile);
+    return *backends[worker];
+  }
+
+  pdfNodeTable* gridConvolution::loadTable(std::string const& pdfSet, const int member) const
+  {
+    std::lock_guard<std::mutex> lock(loadMutex);
+    return new pdfNodeTable(pdfSet, member);
+  }
+
+  /*
+   *  Scale choices sharing a factorisation scale factor are evaluated on the
+   *  same PDF nodes. The first choice of each factorisation scale fills the
+   *  table of its nodes, the remaining choices are then convoluted from the
+   *  filled tables in parallel. Renormalisation scale variations only add
+   *  the alpha_s nodes at the varied scales, which are evaluated by each
+   *  thread itself. Each thread has its own grid.
+   */
+  std::vector< std::vector<double> > gridConvolution::convolute(std::string const& pdfSet,
+                                                                const int member,
+                                                                std::vector<scaleFactors> const& scales,
+                                                                const int nLoops)
+  {
+    const std::vector< std::vector<size_t> > groups = factorisationScaleGroups(scales);
+    std::vector< std::vector<double> > results(scales.size());
+    std::vector<pdfNodeTable*> tables(groups.size(), (pdfNodeTable*)NULL);
+
+    runTasks(groups.size(), nThreads, [&](const size_t group, const int worker) {
+      tables[group] = loadTable(pdfSet, member);
+      const size_t scale = groups[group][0];
+      results[scale] = backend(worker).convolute(*tables[group], scales[scale], nLoops);
+    });
+
+    std::vector< std::pair<size_t, size_t> > variations;
+    for (size_t group(0); group<groups.size(); group++)
+      for (size_t i(1); i<groups[group].size(); i++)
+        variations.push_back(std::make_pair(group, groups[group][i]));
+
+    runTasks(variations.size(), nThreads, [&](const size_t variation, const int worker) {
+      const size_t scale = variations[variation].second;
+      pdfNodeTableView view(*tables[variations[variation].first],
+                            [&]() { return loadTable(pdfSet, member); });
+      results[scale] = backend(worker).convolute(view, scales[scale], nLoops);
+    });
+
+    nNodes = 0;
+    for (size_t group(0); group<groups.size(); group++) {
+      nNodes += tables[group]->nNodes();
+      delete tables[group];
+    }
+    return results;
+  }
+
+  /*
+   *  For each factorisation scale factor, the central member is convoluted
+   *  by the grid library. If the coefficients of the grid can be contracted
+   *  with whole blocks of members, and the contraction reproduces the
+   *  central member, the remaining members are tabulated on the nodes of the
+   *  coefficients in blocks and contracted block by block. Otherwise the
+   *  nodes are found by the convolution of the central member, and each
+   *  remaining member is convoluted by the grid library from a block table.
+   *  Blocks are small enough to be held in memory.
+   */
+  std::vector< std::vector< std::vector<double> > > gridConvolution::convoluteMembers(std::string const& pdfSet,
+                                                                                      std::vector<scaleFactors> const& scales,
+                                                                                      const int nLoops)
+  {
+    int nMembers;
+    {
+      std::lock_guard<std::mutex> lock(loadMutex);
+      nMembers = LHAPDF::PDFSet(pdfSet).size();
+    }
+
+    const std::vector< std::vector<size_t> > groups = factorisationScaleGroups(scales);
+    std::vector< std::vector< std::vector<double> > > results(scales.size(),
+      std::vector< std::vector<double> >(nMembers));
+    nNodes = 0;
+
+    for (size_t g(0); g<groups.size(); g++) {
+      std::vector<size_t> const& group = groups[g];
+      std::vector<scaleFactors> groupScales;
+      std::vector< std::vector<double> > centralResults;
+
+      std::vector<pdfNode> xfxNodeList;
+      std::vector<double> alphasNodeList;
+      {
+        pdfNodeTable* central = loadTable(pdfSet, 0);
+        for (size_t i(0); i<group.size(); i++) {
+          results[group[i]][0] = backend(0).convolute(*central, scales[group[i]], nLoops);
+          groupScales.push_back(scales[group[i]]);
+          centralResults.push_back(results[group[i]][0]);
+        }
+        central->nodes(xfxNodeList, alphasNodeList);
+        delete central;
+      }
+
+      memberContraction* native = validatedContraction(backend(0), gridFile, pdfSet, groupScales,
+                                                       centralResults, nLoops, nThreads);
+      if (native != NULL)
+        native->nodes(groupScales, xfxNodeList, alphasNodeList);
+      nNodes += xfxNodeList.size();
+
+      const int blockSize = pdfMemberBlockTable::membersPerBlock(xfxNodeList.size());
+      for (int first=1; first<nMembers; first+=blockSize) {
+        const int nBlockMembers = std::min(blockSize, nMembers - first);
+        pdfMemberBlockTable* block;
+        {
+          std::lock_guard<std::mutex> lock(loadMutex);
+          block = new pdfMemberBlockTable(pdfSet, first, nBlockMembers,
+                                          xfxNodeList, alphasNodeList, nThreads);
+        }
+
+        if (native != NULL) {
+          const std::vector< std::vector< std::vector<double> > > members = contractBlock(*native, *block, groupScales,
+                                                                                          nLoops, nThreads);
+          for (size_t i(0); i<group.size(); i++)
+            for (int m(0); m<nBlockMembers; m++)
+              results[group[i]][first + m] = members[i][m];
+        } else {
+          runTasks(nBlockMembers, nThreads, [&](const size_t m, const int worker) {
+            for (size_t i(0); i<group.size(); i++)
+              results[group[i]][first + m] = backend(worker).convolute(block->member(m), scales[group[i]], nLoops);
+          });
+        }
+        delete block;
+      }
+    }
+
+    return results;
+  }
+}
@@ -0,0 +1,430 @@
+//
+//  eventRecord.cpp
+//  MCgrid 17/10/2026.
+//
+
+#include "config.h"
+
+#include <cstring>
+#include <cstdlib>
+
+#if HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#include "eventRecord.hh"
+#include "mcgrid.hh"
+#include "fillInfoCache.hh"
+#include "mcgrid/mcgrid_pdf.hh"
+
+#include "Rivet/Rivet.hh"
+#include "Rivet/Event.hh"
+#include "HepMC/GenEvent.h"
+
+using Rivet::cerr;
+using Rivet::cout;
+using Rivet::endl;
+
+namespace MCgrid {
+
+  static const char headerMagic[8] = {'M','C','G','R','D','R','E','C'};
+  static const char footerMagic[8] = {'M','C','G','R','D','E','N','D'};
+  static const uint32_t recordVersion = 1;
+
+  // Events are collected until a chunk holds at least this many bytes
+  const size_t eventRecorder::chunkSize = 1 << 20;
+
+  // ************************ Serialisation helpers ****************************
+
+  template<class T>
+  static void put(std::string& buffer, T const& value)
+  {
+    buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+  }
+
+  template<class T>
+  static void get(const char*& data, const char* end, T& value)
+  {
+    if (data + sizeof(T) > end) {
+      cerr << "MCgrid::Error - Event record is truncated." << endl;
+      exit(-1);
+    }
+    memcpy(&value, data, sizeof(T));
+    data += sizeof(T);
+  }
+
+  static void putFillInfo(std::string& buffer, fillInfo const& info)
+  {
+    put(buffer, info.wgt);
+    put(buffer, (int32_t)info.fl1);
+    put(buffer, (int32_t)info.fl2);
+    put(buffer, info.x1);
+    put(buffer, info.x2);
+    put(buffer, info.pdfQ2);
+    put(buffer, info.alphas);
+  }
+
+  static void getFillInfo(const char*& data, const char* end, fillInfo& info)
+  {
+    int32_t fl1, fl2;
+    get(data, end, info.wgt);
+    get(data, end, fl1);
+    get(data, end, fl2);
+    get(data, end, info.x1);
+    get(data, end, info.x2);
+    get(data, end, info.pdfQ2);
+    get(data, end, info.alphas);
+    info.fl1 = fl1;
+    info.fl2 = fl2;
+  }
+
+  static void putSherpaFillInfo(std::string& buffer, sherpaFillInfo const& info)
+  {
+    putFillInfo(buffer, info);
+    put(buffer, (int32_t)info.reweight_type);
+    put(buffer, info.B);
+    put(buffer, info.VI);
+    put(buffer, info.VI_wren_0);
+    put(buffer, info.RS);
+    put(buffer, info.MuR2);
+    put(buffer, info.KP_x1p);
+    put(buffer, info.KP_x2p);
+    for (int i=0; i<16; i++)
+      put(buffer, info.KP_wfac[i]);
+    put(buffer, (uint32_t)info.DADS_fill_infos.size());
+    for (size_t i(0); i < info.DADS_fill_infos.size(); i++)
+      putFillInfo(buffer, info.DADS_fill_infos[i]);
+    put(buffer, (uint32_t)info.RDA_fill_infos.size());
+    for (size_t i(0); i < info.RDA_fill_infos.size(); i++)
+      putFillInfo(buffer, info.RDA_fill_infos[i]);
+  }
+
+  static void getSherpaFillInfo(const char*& data, const char* end, sherpaFillInfo& info)
+  {
+    int32_t reweightType;
+    uint32_t nSubInfos;
+    getFillInfo(data, end, info);
+    get(data, end, reweightType);
+    info.reweight_type = (ReweightType)reweightType;
+    get(data, end, info.B);
+    get(data, end, info.VI);
+    get(data, end, info.VI_wren_0);
+    get(data, end, info.RS);
+    get(data, end, info.MuR2);
+    get(data, end, info.KP_x1p);
+    get(data, end, info.KP_x2p);
+    for (int i=0; i<16; i++)
+      get(data, end, info.KP_wfac[i]);
+    get(data, end, nSubInfos);
+    info.DADS_fill_infos.assign(nSubInfos, fillInfo(0.0, 0, 0, 0.0, 0.0, 0.0, 0.0));
+    for (uint32_t i=0; i<nSubInfos; i++)
+      getFillInfo(data, end, info.DADS_fill_infos[i]);
+    get(data, end, nSubInfos);
+    info.RDA_fill_infos.assign(nSubInfos, fillInfo(0.0, 0, 0, 0.0, 0.0, 0.0, 0.0));
+    for (uint32_t i=0; i<nSubInfos; i++)
+      getFillInfo(data, end, info.RDA_fill_infos[i]);
+  }
+
+  recordedEvent::recordedEvent():
+  flags(0)
+  { }
+
+  // **************************** eventRecorder ********************************
+
+  eventRecorder::threadState::threadState():
+  flags(0),
+  nEvents(0)
+  { }
+
+  eventRecorder::eventRecorder(std::string const& path):
+  file(path.c_str(), std::ios::binary | std::ios::trunc),
+#if HAVE_ZLIB
+  compression(recordZlib),
+#else
+  compression(recordUncompressed),
+#endif
+  closed(false)
+  {
+    if (!file.good()) {
+      cerr << "MCgrid::Error - Unable to open the event record " << path << " for writing." << endl;
+      exit(-1);
+    }
+    cout << "MCgrid: Recording events to " << path << endl;
+
+    file.write(headerMagic, sizeof(headerMagic));
+    file.write(reinterpret_cast<const char*>(&recordVersion), sizeof(recordVersion));
+    file.write(reinterpret_cast<const char*>(&compression), sizeof(compression));
+  }
+
+  eventRecorder::~eventRecorder()
+  {
+    close();
+  }
+
+  uint32_t eventRecorder::gridKey(std::string const& gridName)
+  {
+    std::lock_guard<std::mutex> lock(gridMutex);
+    std::map<std::string, uint32_t>::const_iterator it = gridKeys.find(gridName);
+    if (it != gridKeys.end())
+      return it->second;
+
+    const uint32_t key = gridNames.size();
+    gridKeys.insert(std::make_pair(gridName, key));
+    gridNames.push_back(gridName);
+    return key;
+  }
+
+  void eventRecorder::recordCountedEvent(Rivet::Event const& event)
+  {
+    stateForEvent(event).flags |= recordCounted;
+  }
+
+  void eventRecorder::recordFill(Rivet::Event const& event, const uint32_t gridKey, const double coord)
+  {
+    stateForEvent(event).fills.push_back(std::make_pair(gridKey, coord));
+  }
+
+  eventRecorder::threadState& eventRecorder::stateForEvent(Rivet::Event const& event)
+  {
+    threadState& state = states.local();
+    const eventKey key = PDFHandler::FillInfoCache().currentKey(event);
+    if (state.key == key)
+      return state;
+
+    if (state.key.isSet())
+      finishEvent(state);
+
+    // The fill info is shared with the grids through the fill info cache
+    state.info.clear();
+    if (globalFillMode == FILL_SHERPA) {
+      sherpaFillInfo const& info = PDFHandler::FillInfoCache().sherpaInfo(event, false);
+      state.flags = recordSherpa | (info.hasScaleLogWeights ? recordScaleLogWeights : 0);
+      putSherpaFillInfo(state.info, info);
+    } else {
+      state.flags = 0;
+      putFillInfo(state.info, PDFHandler::FillInfoCache().genericInfo(event));
+    }
+    state.key = key;
+    return state;
+  }
+
+  void eventRecorder::finishEvent(threadState& state)
+  {
+    put(state.chunk, state.flags);
+    state.chunk.append(state.info);
+    put(state.chunk, (uint32_t)state.fills.size());
+    for (size_t i(0); i < state.fills.size(); i++) {
+      put(state.chunk, state.fills[i].first);
+      put(state.chunk, state.fills[i].second);
+    }
+    state.nEvents++;
+
+    state.key = eventKey();
+    state.fills.clear();
+
+    if (state.chunk.size() >= chunkSize)
+      writeChunk(state);
+  }
+
+  void eventRecorder::writeChunk(threadState& state)
+  {
+    if (state.nEvents == 0)
+      return;
+
+    recordChunk chunk;
+    chunk.rawSize = state.chunk.size();
+    chunk.nEvents = state.nEvents;
+
+    // Compress outside of the lock
+    std::string stored;
+#if HAVE_ZLIB
+    uLongf storedSize = compressBound(state.chunk.size());
+    stored.resize(storedSize);
+    if (compress2(reinterpret_cast<Bytef*>(&stored[0]), &storedSize,
+                  reinterpret_cast<const Bytef*>(state.chunk.data()), state.chunk.size(),
+                  Z_BEST_SPEED) != Z_OK) {
+      cerr << "MCgrid::Error - Unable to compress event record chunk." << endl;
+      exit(-1);
+    }
+    stored.resize(storedSize);
+#else
+    stored.swap(state.chunk);
+#endif
+    chunk.storedSize = stored.size();
+
+    {
+      std::lock_guard<std::mutex> lock(fileMutex);
+      chunk.offset = file.tellp();
+      file.write(stored.data(), stored.size());
+      chunks.push_back(chunk);
+    }
+
+    state.chunk.clear();
+    state.nEvents = 0;
+  }
+
+  void eventRecorder::close()
+  {
+    if (closed)
+      return;
+    closed = true;
+
+    for (int slot=0; slot<maxFillThreads; slot++) {
+      threadState* state = states.get(slot);
+      if (state == NULL)
+        continue;
+      if (state->key.isSet())
+        finishEvent(*state);
+      writeChunk(*state);
+    }
+
+    const uint64_t indexOffset = file.tellp();
+    std::string index;
+    put(index, (uint64_t)chunks.size());
+    for (size_t i(0); i < chunks.size(); i++) {
+      put(index, chunks[i].offset);
+      put(index, chunks[i].rawSize);
+      put(index, chunks[i].storedSize);
+      put(index, chunks[i].nEvents);
+    }
+    put(index, (uint32_t)gridNames.size());
+    for (size_t i(0); i < gridNames.size(); i++) {
+      put(index, (uint32_t)gridNames[i].size());
+      index.append(gridNames[i]);
+    }
+    put(index, indexOffset);
+    index.append(footerMagic, sizeof(footerMagic));
+
+    file.write(index.data(), index.size());
+    file.close();
+    cout << "MCgrid: Event record complete" << endl;
+  }
+
+  // ************************** eventRecordReader ******************************
+
+  static void readRecordError(std::string const& path)
+  {
+    cerr << "MCgrid::Error - " << path << " is not a complete MCgrid event record." << endl;
+    exit(-1);
+  }
+
+  eventRecordReader::eventRecordReader(std::string const& _path):
+  path(_path)
+  {
+    std::ifstream file(path.c_str(), std::ios::binary);
+    if (!file.good()) {
+      cerr << "MCgrid::Error - Unable to open the event record " << path << "." << endl;
+      exit(-1);
+    }
+
+    char magic[8];
+    uint32_t version;
+    file.read(magic, sizeof(magic));
+    file.read(reinterpret_cast<char*>(&version), sizeof(version));
+    file.read(reinterpret_cast<char*>(&compression), sizeof(compression));
+    if (!file.good() || memcmp(magic, headerMagic, sizeof(magic)) != 0)
+      readRecordError(path);
+    if (version != recordVersion) {
+      cerr << "MCgrid::Error - Event record " << path << " has version " << version;
+      cerr << ", but this version of MCgrid reads version " << recordVersion << "." << endl;
+      exit(-1);
+    }
+#if !HAVE_ZLIB
+    if (compression == recordZlib) {
+      cerr << "MCgrid::Error - Event record " << path << " is compressed, but this";
+      cerr << " version of MCgrid has been configured without zlib." << endl;
+      exit(-1);
+    }
+#endif
+
+    // Read the footer and then the index
+    uint64_t indexOffset;
+    const int footerSize = sizeof(indexOffset) + sizeof(magic);
+    file.seekg(-footerSize, std::ios::end);
+    const uint64_t footerOffset = file.tellg();
+    file.read(reinterpret_cast<char*>(&indexOffset), sizeof(indexOffset));
+    file.read(magic, sizeof(magic));
+    if (!file.good() || memcmp(magic, footerMagic, sizeof(magic)) != 0 || indexOffset > footerOffset)
+      readRecordError(path);
+
+    std::string index(footerOffset - indexOffset, '\0');
+    file.seekg(indexOffset);
+    file.read(&index[0], index.size());
+    if (!file.good())
+      readRecordError(path);
+
+    const char* data = index.data();
+    const char* end = data + index.size();
+    uint64_t nChunks;
+    get(data, end, nChunks);
+    chunks.resize(nChunks);
+    for (uint64_t i=0; i<nChunks; i++) {
+      get(data, end, chunks[i].offset);
+      get(data, end, chunks[i].rawSize);
+      get(data, end, chunks[i].storedSize);
+      get(data, end, chunks[i].nEvents);
+    }
+    uint32_t nGrids;
+    get(data, end, nGrids);
+    for (uint32_t i=0; i<nGrids; i++) {
+      uint32_t length;
+      get(data, end, length);
+      if (data + length > end)
+        readRecordError(path);
+      names.push_back(std::string(data, length));
+      data += length;
+    }
+  }
+
+  void eventRecordReader::readChunk(const size_t i, std::vector<recordedEvent>& events) const
+  {
+    recordChunk const& chunk = chunks[i];
+
+    // Each call uses its own stream, such that chunks can be read concurrently
+    std::ifstream file(path.c_str(), std::ios::binary);
+    std::string stored(chunk.storedSize, '\0');
+    file.seekg(chunk.offset);
+    file.read(&stored[0], stored.size());
+    if (!file.good())
+      readRecordError(path);
+
+    std::string raw;
+#if HAVE_ZLIB
+    if (compression == recordZlib) {
+      raw.resize(chunk.rawSize);
+      uLongf rawSize = chunk.rawSize;
+      if (uncompress(reinterpret_cast<Bytef*>(&raw[0]), &rawSize,
+                     reinterpret_cast<const Bytef*>(stored.data()), stored.size()) != Z_OK
+          || rawSize != chunk.rawSize)
+        readRecordError(path);
+    } else {
+      raw.swap(stored);
+    }
+#else
+    raw.swap(stored);
+#endif
+
+    const char* data = raw.data();
+    const char* end = data + raw.size();
+    events.resize(chunk.nEvents);
+    for (uint32_t j=0; j<chunk.nEvents; j++) {
+      recordedEvent& event = events[j];
+      get(data, end, event.flags);
+      if (event.flags & recordSherpa) {
+        getSherpaFillInfo(data, end, event.info);
+        event.info.hasScaleLogWeights = (event.flags & recordScaleLogWeights);
+      } else {
+        getFillInfo(data, end, event.info);
+      }
+
+      uint32_t nFills;
+      get(data, end, nFills);
+      event.fills.resize(nFills);
+      for (uint32_t k=0; k<nFills; k++) {
+        get(data, end, event.fills[k].first);
+        get(data, end, event.fills[k].second);
+      }
+    }
+  }
+
+}
@@ -0,0 +1,159 @@
+//
+//  eventRecord.hh
+//  MCgrid 17/10/2026.
+//
+
+#ifndef mcgrid_event_record_hh
+#define mcgrid_event_record_hh
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <fstream>
+#include <stdint.h>
+
+#include "threading.hh"
+#include "sherpaFillInfo.hh"
+#include "fillInfoCache.hh"
+
+namespace Rivet{ class Event; }
+namespace HepMC{ class GenEvent; }
+
+namespace MCgrid {
+
+  /*
+   *  Event record file format
+   *
+   *  An event record stores the decoded fill information of each event and
+   *  the coordinates it has been filled with into each grid, such that the
+   *  grids can be filled again without rerunning the event generation. All
+   *  numbers are stored in the byte order of the writing machine.
+   *
+   *    header:  "MCGRDREC", uint32 version, uint32 compression
+   *    chunks:  independently (zlib-)compressed blocks of event entries
+   *    index:   uint64 nChunks, {uint64 offset, uint32 rawSize,
+   *             uint32 storedSize, uint32 nEvents} per chunk,
+   *             uint32 nGrids, {uint32 length, name} per grid
+   *    footer:  uint64 index offset, "MCGRDEND"
+   *
+   *  An event entry consists of a uint8 flag set (eventRecordFlags), the
+   *  fillInfo fields, the sherpaFillInfo fields for SHERPA events (whose
+   *  scale logarithm weights are 0 unless recordScaleLogWeights is set), the
+   *  number of fills followed by a {uint32 grid, double coord} per fill.
+   *  The chunk index allows several threads to read different chunks.
+   */
+
+  typedef enum {
+    recordCounted = 1 << 0,  //!< The event has been passed to PDFHandler::HandleEvent
+    recordSherpa  = 1 << 1,  //!< The event carries a full sherpaFillInfo
+    recordScaleLogWeights = 1 << 2  //!< Its scale logarithm weights were present
+  } eventRecordFlags;
+
+  typedef enum {
+    recordUncompressed = 0,
+    recordZlib         = 1
+  } eventRecordCompression;
+
+  struct recordChunk
+  {
+    uint64_t offset;
+    uint32_t rawSize;
+    uint32_t storedSize;
+    uint32_t nEvents;
+  };
+
+  // A decoded event entry
+  struct recordedEvent
+  {
+    recordedEvent();
+
+    uint8_t flags;
+    sherpaFillInfo info;  //!< Only the fillInfo part is set for generic events
+    std::vector<std::pair<uint32_t, double> > fills;
+  };
+
+  /**
+   * MCgrid::eventRecorder writes the events of a run to an event record. It
+   * is owned by the PDFHandler and enabled by setting MCGRID_RECORD to the
+   * path of the record file. Each fill thread collects its events into its
+   * own chunk, and complete chunks are appended to the file.
+   **/
+  class eventRecorder
+  {
+  public:
+    eventRecorder(std::string const& path);
+    ~eventRecorder();
+
+    // Key under which the fills of a grid are recorded
+    uint32_t gridKey(std::string const& gridName);
+
+    // Record that an event has been counted by the PDFHandler
+    void recordCountedEvent(Rivet::Event const&);
+
+    // Record a fill of an event into a grid
+    void recordFill(Rivet::Event const&, const uint32_t gridKey, const double coord);
+
+    // Write out all pending events, the chunk index and the footer
+    void close();
+
+  private:
+    struct threadState
+    {
+      threadState();
+
+      eventKey key;                     //!< Event that is currently collected
+      uint8_t flags;
+      std::string info;                 //!< Serialised fill info of the current event
+      std::vector<std::pair<uint32_t, double> > fills;
+
+      std::string chunk;                //!< Serialised events of the current chunk
+      uint32_t nEvents;                 //!< Number of events in the current chunk
+    };
+
+    // Start collecting a new event, if it is not the current one
+    threadState& stateForEvent(Rivet::Event const&);
+    void finishEvent(threadState&);
+    void writeChunk(threadState&);
+
+    static const size_t chunkSize;
+
+    std::ofstream file;
+    const uint32_t compression;
+    bool closed;
+
+    std::mutex fileMutex;                       //!< Guards the file and the chunk index
+    std::vector<recordChunk> chunks;
+
+    std::mutex gridMutex;                       //!< Guards the grid keys
+    std::map<std::string, uint32_t> gridKeys;
+    std::vector<std::string> gridNames;
+
+    perThread<threadState> states;
+  };
+
+  /**
+   * MCgrid::eventRecordReader reads an event record written by the
+   * eventRecorder. Chunks can be read concurrently.
+   **/
+  class eventRecordReader
+  {
+  public:
+    eventRecordReader(std::string const& path);
+
+    size_t numberOfChunks() const { return chunks.size(); };
+    std::vector<std::string> const& gridNames() const { return names; };
+
+    // Read and decode all events of a chunk
+    void readChunk(const size_t chunk, std::vector<recordedEvent>& events) const;
+
+  private:
+    const std::string path;
+    uint32_t compression;
+    std::vector<recordChunk> chunks;
+    std::vector<std::string> names;
+  };
+
+}
+
+#endif
@@ -0,0 +1,151 @@
+//
+//  eventWeights.hh
+//  MCgrid 17/10/2026.
+//
+
+#ifndef mcgrid_event_weights_hh
+#define mcgrid_event_weights_hh
+
+#include <vector>
+#include <cstddef>
+
+#include "subprocessWeights.hh"
+
+namespace MCgrid {
+
+  class mcgrid_base_pdf;
+
+  /**
+   * MCgrid::eventWeights lists the fills of the underlying grid computed
+   * from a single event: the subprocess weights of each term type at
+   * (x1, x2, Q^2). They do not depend on the observable, so grids sharing a
+   * subprocess PDF can fill the same list at their own coordinate. Only the
+   * touched subprocesses are kept, in one flat array for all fills.
+   **/
+  class eventWeights
+  {
+  public:
+    struct fill
+    {
+      double x1, x2, pdfQ2;
+      int termType;
+      size_t begin, end;   //!< Range of the subprocess weights of the fill
+    };
+
+    eventWeights() {};
+
+    // Keeps the capacity, such that the list is reused for the next event
+    void clear()
+    {
+      fills.clear();
+      subprocs.clear();
+      weights.clear();
+    };
+
+    void add(subprocessWeights const& w, const double x1, const double x2,
+             const double pdfQ2, const int termType)
+    {
+      fill f = {x1, x2, pdfQ2, termType, subprocs.size(), subprocs.size()};
+      std::vector<int> const& touched = w.touchedSubprocesses();
+      for (size_t i(0); i < touched.size(); i++) {
+        subprocs.push_back(touched[i]);
+        weights.push_back(w[touched[i]]);
+      }
+      f.end = subprocs.size();
+      fills.push_back(f);
+    };
+
+    size_t size() const { return fills.size(); };
+    fill const& operator[](const size_t i) const { return fills[i]; };
+
+    // Set the subprocess weights of a fill
+    void copyWeights(fill const& f, subprocessWeights& w) const
+    {
+      w.clear();
+      for (size_t i(f.begin); i < f.end; i++)
+        w.add(subprocs[i], weights[i]);
+    };
+
+  private:
+    std::vector<fill> fills;
+    std::vector<int> subprocs;
+    std::vector<double> weights;
+  };
+
+  /**
+   * MCgrid::eventWeightCache keeps the eventWeights of the event that is
+   * currently filled, one list for each combination of the settings the
+   * weights depend on. The first grid to fill an event computes the list,
+   * the others reuse it. Each fill thread has its own cache, which has to
+   * be cleared before the next event is filled.
+   **/
+  class eventWeightCache
+  {
+  public:
+    struct key
+    {
+      const void* info;              //!< Fill info of the event
+      const mcgrid_base_pdf* pdf;
+      int leadingOrder;
+      double alphaSPrefactor;
+      bool isUsingScaleLogGrids;
+      int nActiveFlavors;            //!< Of the KP projections, or 0 without
+
+      bool operator==(key const& other) const
+      {
+        return info == other.info && pdf == other.pdf && leadingOrder == other.leadingOrder
+          && alphaSPrefactor == other.alphaSPrefactor && isUsingScaleLogGrids == other.isUsingScaleLogGrids
+          && nActiveFlavors == other.nActiveFlavors;
+      };
+    };
+
+    eventWeightCache(): nUsed(0) {};
+
+    ~eventWeightCache()
+    {
+      for (size_t i(0); i < entries.size(); i++)
+        delete entries[i].weights;
+    };
+
+    // The lists of the entries are kept for the next event
+    void clear() { nUsed = 0; };
+
+    // The list computed for the key, or NULL if there is none yet
+    eventWeights const* find(key const& k) const
+    {
+      for (size_t i(0); i < nUsed; i++)
+        if (entries[i].k == k)
+          return entries[i].weights;
+      return NULL;
+    };
+
+    // An empty list for the key, to be computed by the caller
+    eventWeights& insert(key const& k)
+    {
+      if (nUsed == entries.size()) {
+        entry e = {k, new eventWeights()};
+        entries.push_back(e);
+      }
+      entry& e = entries[nUsed++];
+      e.k = k;
+      e.weights->clear();
+      return *e.weights;
+    };
+
+  private:
+    eventWeightCache(eventWeightCache const&);
+    eventWeightCache& operator=(eventWeightCache const&);
+
+    struct entry
+    {
+      key k;
+      eventWeights* weights;
+    };
+
+    std::vector<entry> entries;
+    size_t nUsed;                  //!< Entries belonging to the current event
+  };
+
+}
+
+#endif
@@ -0,0 +1,147 @@
+//
+//  exportQueue.cpp
+//  MCgrid 17/10/2026.
+//
+
+#include "exportQueue.hh"
+
+#include <iostream>
+#include <cstdlib>
+#include <deque>
+#include <map>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+
+#include "system.hh"
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+namespace MCgrid {
+
+  namespace {
+
+    struct queuedExport
+    {
+      const void* grid;
+      std::string gridName;
+      std::function<void()> task;
+    };
+
+    // Workers are started on demand, up to the number of export threads,
+    // and stop once the queue is empty. They are detached, and the queue
+    // is never destroyed, such that a worker may still be returning at exit
+    struct exportPool
+    {
+      std::mutex mutex;
+      std::condition_variable finished;
+      std::deque<queuedExport> queue;
+      std::map<const void*, int> nPending;   //!< Queued or running exports per grid
+      int nWorkers;
+      std::vector<std::string> failures;
+
+      exportPool(): nWorkers(0) {};
+    };
+
+    exportPool& pool()
+    {
+      static exportPool* const instance = new exportPool();
+      return *instance;
+    }
+
+    thread_local bool isExportThread = false;
+
+    void runExports()
+    {
+      isExportThread = true;
+      exportPool& exports = pool();
+      std::unique_lock<std::mutex> lock(exports.mutex);
+      while (!exports.queue.empty()) {
+        const queuedExport next = exports.queue.front();
+        exports.queue.pop_front();
+        lock.unlock();
+
+        // Errors of MCgrid arrive as exportError, see stopOnError, next to
+        // the exceptions of the grid libraries
+        std::string failure;
+        try {
+          next.task();
+        } catch (std::exception const& e) {
+          failure = e.what();
+        } catch (...) {
+          failure = "unknown exception";
+        }
+
+        lock.lock();
+        if (failure != "")
+          exports.failures.push_back(next.gridName + ": " + failure);
+        if (--exports.nPending[next.grid] == 0)
+          exports.nPending.erase(next.grid);
+        exports.finished.notify_all();
+      }
+      exports.nWorkers--;
+    }
+
+  }
+
+  void stopOnError(std::string const& reason)
+  {
+    if (isExportThread)
+      throw exportError(reason);
+    exit(-1);
+  }
+
+  int exportThreads()
+  {
+    static const int nThreads = atoi(environmentVariableForKey("MCGRID_EXPORT_THREADS").c_str());
+    return nThreads;
+  }
+
+  void queueExport(const void* grid,
+                   std::string const& gridName,
+                   std::function<void()> const& task)
+  {
+    exportPool& exports = pool();
+    std::lock_guard<std::mutex> lock(exports.mutex);
+    queuedExport entry;
+    entry.grid = grid;
+    entry.gridName = gridName;
+    entry.task = task;
+    exports.queue.push_back(entry);
+    exports.nPending[grid]++;
+    if (exports.nWorkers < exportThreads()) {
+      exports.nWorkers++;
+      std::thread(runExports).detach();
+    }
+  }
+
+  void waitForExport(const void* grid)
+  {
+    exportPool& exports = pool();
+    std::unique_lock<std::mutex> lock(exports.mutex);
+    exports.finished.wait(lock, [&]() { return exports.nPending.count(grid) == 0; });
+  }
+
+  void waitForExports()
+  {
+    exportPool& exports = pool();
+    std::unique_lock<std::mutex> lock(exports.mutex);
+    if (exports.nPending.empty() && exports.failures.empty())
+      return;
+    cout << "MCgrid: Waiting for the grid exports to finish ..." << endl;
+    exports.finished.wait(lock, [&]() { return exports.nPending.empty(); });
+
+    if (!exports.failures.empty()) {
+      cerr << "MCgrid::Error - " << exports.failures.size() << " grid export(s) failed:" << endl;
+      for (size_t i(0); i<exports.failures.size(); i++)
+        cerr << "                " << exports.failures[i] << endl;
+      exit(-1);
+    }
+    cout << "MCgrid: ... all grids exported." << endl;
+  }
+
+}
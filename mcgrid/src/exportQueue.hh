@@ -0,0 +1,55 @@
+//
+//  exportQueue.hh
+//  MCgrid 17/10/2026.
+//
+
+#ifndef mcgrid_export_queue_hh
+#define mcgrid_export_queue_hh
+
+#include <string>
+#include <functional>
+#include <stdexcept>
+
+namespace MCgrid {
+
+  /*
+   *  Setting MCGRID_EXPORT_THREADS to a number larger than one makes grids
+   *  export asynchronously: grid::exportgrid only queues the export, which
+   *  is then run on a pool of that many threads, such that the merging,
+   *  optimisation and writing of different grids overlap. All exports are
+   *  finished when the analysis checks out of the PDFHandler, which is also
+   *  where failed exports are reported and the run is stopped. MCgrid's own
+   *  errors in code that runs during an export stop through stopOnError,
+   *  which throws an exportError on an export thread instead of calling
+   *  exit(-1) there, while the main thread may still be running.
+   */
+
+  class exportError: public std::runtime_error
+  {
+  public:
+    exportError(std::string const& reason): std::runtime_error(reason) {};
+  };
+
+  // Stop the run after an error whose message has been written to cerr. On
+  // an export thread, an exportError is thrown, failing the export
+  [[noreturn]] void stopOnError(std::string const& reason);
+
+  // Number of export threads, exports are synchronous if this is below two
+  int exportThreads();
+
+  // Queue the export of a grid. The grid identifies its exports for
+  // waitForExport, the name is used to report a failure of the export
+  void queueExport(const void* grid,
+                   std::string const& gridName,
+                   std::function<void()> const& task);
+
+  // Wait until the queued exports of a grid are finished
+  void waitForExport(const void* grid);
+
+  // Wait until all queued exports are finished. If any of them failed, the
+  // failures are reported per grid and the run is stopped
+  void waitForExports();
+
+}
+
+#endif
@@ -42,24 +42,14 @@ namespace MCgrid {
   alphas(event.genEvent()->alphaQCD())
   { }
 
-  fillInfo::fillInfo(HepMC::WeightContainer const & usr_wgt, std::string const & usr_wgt_key_prefix, const double pdfQ2, const double alphas):
-  wgt(usr_wgt[usr_wgt_key_prefix + "Weight"]),
-  fl1(pdgToLHA(usr_wgt[usr_wgt_key_prefix + "fl1"])),
-  fl2(pdgToLHA(usr_wgt[usr_wgt_key_prefix + "fl2"])),
-  x1(usr_wgt[usr_wgt_key_prefix + "x1"]),
-  x2(usr_wgt[usr_wgt_key_prefix + "x2"]),
-  pdfQ2(pdfQ2),
-  alphas(alphas)
-  { }
-
-  fillInfo::fillInfo(HepMC::WeightContainer const & usr_wgt, std::string const & usr_wgt_key_prefix, int fl1, int fl2, double x1, double x2):
-  wgt(usr_wgt[usr_wgt_key_prefix + "Weight"]),
+  fillInfo::fillInfo(double wgt, int fl1, int fl2, double x1, double x2, double pdfQ2, double alphas):
+  wgt(wgt),
   fl1(fl1),
   fl2(fl2),
   x1(x1),
   x2(x2),
-  pdfQ2(usr_wgt[usr_wgt_key_prefix + "MuF12"]),
-  alphas(usr_wgt[usr_wgt_key_prefix + "AlphaS"])
+  pdfQ2(pdfQ2),
+  alphas(alphas)
   { }
 
 }
@@ -9,7 +9,6 @@
 #include <string>
 
 namespace Rivet{ class Event; }
-namespace HepMC{ class WeightContainer; }
 
 namespace MCgrid {
 
@@ -20,11 +19,8 @@ namespace MCgrid {
   public:
     fillInfo(Rivet::Event const&);
 
-    // Initialise (DADS) fill info from Sherpa fill info user weights
-    fillInfo(HepMC::WeightContainer const &, std::string const & usr_wgt_key_prefix, const double pdfQ2, const double alphas);
-    
-    // Initialise (RDA) fill info from Sherpa fill info user weights
-    fillInfo(HepMC::WeightContainer const &, std::string const & usr_wgt_key_prefix, int fl1, int fl2, double x1, double x2);
+    // Initialise (DADS/RDA) fill info from already decoded values
+    fillInfo(double wgt, int fl1, int fl2, double x1, double x2, double pdfQ2, double alphas);
 
     double wgt;      //!< Event weight
 
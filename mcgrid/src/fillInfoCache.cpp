@@ -0,0 +1,84 @@
+//
+//  fillInfoCache.cpp
+//  MCgrid 17/10/2026.
+//
+
+#include "fillInfoCache.hh"
+#include "fillInfo.hh"
+#include "sherpaFillInfo.hh"
+
+#include "Rivet/Rivet.hh"
+#include "Rivet/Event.hh"
+#include "HepMC/GenEvent.h"
+
+namespace MCgrid {
+
+  eventKey::eventKey():
+  genEvent(NULL),
+  eventNumber(0),
+  generation(0),
+  nWeights(0),
+  firstWeight(0)
+  { }
+
+  eventKey::eventKey(Rivet::Event const& event, const uint64_t _generation):
+  genEvent(event.genEvent()),
+  eventNumber(genEvent->event_number()),
+  generation(_generation),
+  nWeights(genEvent->weights().size()),
+  firstWeight((nWeights > 0) ? genEvent->weights()[0] : 0)
+  { }
+
+  bool eventKey::operator==(eventKey const& other) const
+  {
+    return genEvent == other.genEvent && eventNumber == other.eventNumber
+        && generation == other.generation && nWeights == other.nWeights
+        && firstWeight == other.firstWeight;
+  }
+
+  fillInfoCache::fillInfoCache():
+  generation(0),
+  generic(NULL),
+  sherpa(NULL)
+  { }
+
+  fillInfoCache::~fillInfoCache()
+  {
+    delete generic;
+    delete sherpa;
+  }
+
+  fillInfo const& fillInfoCache::genericInfo(Rivet::Event const& event)
+  {
+    updateForEvent(event);
+    if (generic == NULL)
+      generic = new fillInfo(event);
+    return *generic;
+  }
+
+  sherpaFillInfo const& fillInfoCache::sherpaInfo(Rivet::Event const& event, const bool requireScaleLogWeights)
+  {
+    updateForEvent(event);
+    if (sherpa == NULL)
+      sherpa = new sherpaFillInfo(event, layout, requireScaleLogWeights);
+    else if (requireScaleLogWeights && !sherpa->hasScaleLogWeights)
+      sherpa->readScaleLogWeights(event.genEvent()->weights(), layout);
+    return *sherpa;
+  }
+
+  void fillInfoCache::updateForEvent(Rivet::Event const& event)
+  {
+    const eventKey currentEventKey = currentKey(event);
+    if (currentEventKey == key)
+      return;
+
+    delete generic;
+    delete sherpa;
+    generic = NULL;
+    sherpa = NULL;
+    weights.clear();
+
+    key = currentEventKey;
+  }
+
+}
@@ -0,0 +1,92 @@
+//
+//  fillInfoCache.hh
+//  MCgrid 17/10/2026.
+//
+
+#ifndef mcgrid_fill_info_cache_hh
+#define mcgrid_fill_info_cache_hh
+
+#include <stdint.h>
+
+#include "sherpaWeightLayout.hh"
+#include "eventWeights.hh"
+
+namespace Rivet{ class Event; }
+namespace HepMC{ class GenEvent; }
+
+namespace MCgrid {
+
+  class fillInfo;
+  class sherpaFillInfo;
+
+  /**
+   * MCgrid::eventKey identifies the event that is currently analysed by a
+   * fill thread. Generators and readers may reuse the GenEvent object and
+   * need not number their events, so the key also holds the event
+   * generation of the thread, which PDFHandler::HandleEvent advances for
+   * every counted event, and the size and first entry of the weights.
+   **/
+  struct eventKey
+  {
+    eventKey();
+    eventKey(Rivet::Event const&, const uint64_t generation);
+
+    bool operator==(eventKey const&) const;
+    bool operator!=(eventKey const& other) const { return !(*this == other); };
+
+    // Whether the key belongs to an event
+    bool isSet() const { return genEvent != NULL; };
+
+    const HepMC::GenEvent* genEvent;
+    int eventNumber;
+    uint64_t generation;
+    size_t nWeights;
+    double firstWeight;
+  };
+
+  /**
+   * MCgrid::fillInfoCache keeps the fill information decoded from the event
+   * that is currently analysed, such that every booked grid reuses the same
+   * decoding instead of parsing the HepMC record again. The cache is keyed on
+   * an eventKey. It also keeps the subprocess
+   * weights computed from the decoded event, see eventWeightCache. The
+   * PDFHandler owns one cache per fill thread.
+   **/
+  class fillInfoCache
+  {
+  public:
+    fillInfoCache();
+    ~fillInfoCache();
+
+    // Return the decoded fill info, decoding it on the first request per event.
+    // The scale logarithm weights of the SHERPA fill info are checked to be
+    // present once a grid requires them
+    fillInfo const& genericInfo(Rivet::Event const&);
+    sherpaFillInfo const& sherpaInfo(Rivet::Event const&, const bool requireScaleLogWeights);
+
+    // The subprocess weights of the event of the last requested fill info
+    eventWeightCache& weightCache() { return weights; };
+
+    // Start the next event of this fill thread, called for each counted event
+    void nextEvent() { generation++; };
+
+    // Key of the event currently analysed by this fill thread
+    eventKey currentKey(Rivet::Event const& event) const { return eventKey(event, generation); };
+
+  private:
+    // Forget the cached infos if the event has changed
+    void updateForEvent(Rivet::Event const&);
+
+    uint64_t generation;             //!< Number of counted events of this thread
+    eventKey key;                    //!< Event the cached infos belong to
+
+    fillInfo* generic;               //!< Cached generic fill info (or NULL)
+    sherpaFillInfo* sherpa;          //!< Cached SHERPA fill info (or NULL)
+
+    eventWeightCache weights;        //!< Subprocess weights of the cached infos
+    sherpaWeightLayout layout;       //!< Resolved SHERPA user weight keys
+  };
+
+}
+
+#endif
@@ -0,0 +1,80 @@
+//
+//  fillProfile.cpp
+//  MCgrid 17/10/2026.
+//
+
+#include "fillProfile.hh"
+
+#include <fstream>
+
+using std::endl;
+
+namespace MCgrid {
+
+  fillProfile::fillProfile():
+    nFills(0),
+    decodingNs(0),
+    fillNs(0),
+    referenceNs(0)
+  {
+    for (int i(0); i < nTermTypes; i++) {
+      nUnderlyingFills[i] = 0;
+      nNonzeroWeights[i] = 0;
+      backendNs[i] = 0;
+    }
+  }
+
+  void fillProfile::merge(fillProfile const& other)
+  {
+    nFills += other.nFills;
+    decodingNs += other.decodingNs;
+    fillNs += other.fillNs;
+    referenceNs += other.referenceNs;
+    for (int i(0); i < nTermTypes; i++) {
+      nUnderlyingFills[i] += other.nUnderlyingFills[i];
+      nNonzeroWeights[i] += other.nNonzeroWeights[i];
+      backendNs[i] += other.backendNs[i];
+    }
+  }
+
+  /*
+   *  The projection time is the time spent in fillFromInfo outside of the
+   *  reference histogram and the underlying grid, i.e. computing the
+   *  subprocess weights (or recording the phase space in a warmup run).
+   */
+  void fillProfile::write(std::string const& path,
+                          std::string const& gridName,
+                          std::string const& backendName,
+                          std::string const& fillModeName,
+                          const uint64_t nEvents) const
+  {
+    uint64_t totalBackendNs(0);
+    for (int i(0); i < nTermTypes; i++)
+      totalBackendNs += backendNs[i];
+    const uint64_t projectionNs = fillNs - referenceNs - totalBackendNs;
+
+    std::ofstream file(path.c_str());
+    file << "{" << endl;
+    file << "  \"grid\": \"" << gridName << "\"," << endl;
+    file << "  \"backend\": \"" << backendName << "\"," << endl;
+    file << "  \"fillMode\": \"" << fillModeName << "\"," << endl;
+    file << "  \"events\": " << nEvents << "," << endl;
+    file << "  \"fills\": " << nFills << "," << endl;
+    file << "  \"decodingSeconds\": " << decodingNs*1e-9 << "," << endl;
+    file << "  \"projectionSeconds\": " << projectionNs*1e-9 << "," << endl;
+    file << "  \"referenceSeconds\": " << referenceNs*1e-9 << "," << endl;
+    file << "  \"backendSeconds\": " << totalBackendNs*1e-9 << "," << endl;
+    file << "  \"termTypes\": {" << endl;
+    const char* termTypeNames[] = {"LO", "NLO", "RenormalisationSingleLog", "FactorisationSingleLog"};
+    for (int i(0); i < nTermTypes; i++) {
+      file << "    \"" << termTypeNames[i] << "\": {";
+      file << "\"underlyingFills\": " << nUnderlyingFills[i] << ", ";
+      file << "\"nonzeroWeights\": " << nNonzeroWeights[i] << ", ";
+      file << "\"backendSeconds\": " << backendNs[i]*1e-9 << "}";
+      file << ((i+1 < nTermTypes) ? "," : "") << endl;
+    }
+    file << "  }" << endl;
+    file << "}" << endl;
+  }
+
+}
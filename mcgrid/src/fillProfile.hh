@@ -0,0 +1,79 @@
+//
+//  fillProfile.hh
+//  MCgrid 17/10/2026.
+//
+
+#ifndef mcgrid_fill_profile_hh
+#define mcgrid_fill_profile_hh
+
+#include <string>
+#include <chrono>
+#include <stdint.h>
+
+namespace MCgrid {
+
+  /**
+   * MCgrid::fillProfile counts the fills of a grid and the time spent in
+   * the parts of the fill path. Fills are counted per term type, in the
+   * order of _grid::termType. Each fill thread has its own profile, which
+   * are merged on export. Profiling is enabled by setting MCGRID_PROFILE.
+   **/
+  class fillProfile
+  {
+  public:
+    fillProfile();
+
+    void merge(fillProfile const&);
+
+    // Write the profile as a JSON object
+    void write(std::string const& path,
+               std::string const& gridName,
+               std::string const& backendName,
+               std::string const& fillModeName,
+               const uint64_t nEvents) const;
+
+    static const int nTermTypes = 4;
+
+    uint64_t nFills;                         //!< Calls of _grid::fillFromInfo
+    uint64_t nUnderlyingFills[nTermTypes];   //!< Calls of _grid::fillUnderlyingGrid
+    uint64_t nNonzeroWeights[nTermTypes];    //!< Nonzero subprocess weights passed to fillUnderlyingGrid
+
+    uint64_t decodingNs;                     //!< Decoding the event (or reading the decoded event from the cache)
+    uint64_t fillNs;                         //!< All of _grid::fillFromInfo
+    uint64_t referenceNs;                    //!< Filling the reference histogram
+    uint64_t backendNs[nTermTypes];          //!< Filling the underlying grid
+  };
+
+  // Steady time in nanoseconds
+  inline uint64_t profileTime()
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  /**
+   * MCgrid::profileTimer adds the time until it goes out of scope to a
+   * counter. It does nothing if the counter is NULL, i.e. if profiling is
+   * disabled.
+   **/
+  class profileTimer
+  {
+  public:
+    profileTimer(uint64_t* counter):
+      counter(counter),
+      start((counter != NULL) ? profileTime() : 0) {};
+
+    ~profileTimer()
+    {
+      if (counter != NULL)
+        *counter += profileTime() - start;
+    };
+
+  private:
+    uint64_t* const counter;
+    const uint64_t start;
+  };
+
+}
+
+#endif
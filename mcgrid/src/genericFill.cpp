@@ -31,7 +31,7 @@ using Rivet::endl;
  *  from the full weight.
  */
 
-void _grid::genericFill(double coord, fillInfo const& info)
+void _grid::genericFill(subprocessWeights& weights, eventWeights& fills, fillInfo const& info)
 {
   // NOTE: As we do not need it when treating Sherpa events, the PDF values
   // itself are currently not read out from the HepMC record. If it is
@@ -48,10 +48,10 @@ void _grid::genericFill(double coord, fillInfo const& info)
   const double asfac = pow(info.alphas * alphaSPrefactor, aspowers);
   const double meweight_without_asfac = meweight / asfac;
   
-  // Populate weight grid and fill the APPLgrid
-  zeroWeights();
-  fillWeight(info.fl1, info.fl2, meweight_without_asfac, true);
-  fillUnderlyingGrid(info.x1, info.x2, info.pdfQ2, coord, LO);
+  // Populate weight grid
+  zeroWeights(weights);
+  fillWeight(weights, info.fl1, info.fl2, meweight_without_asfac, true);
+  fills.add(weights, info.x1, info.x2, info.pdfQ2, LO);
   
   return;
 }
@@ -7,6 +7,8 @@
 #include <vector>
 #include <cmath>
 #include <memory>
+#include <mutex>
+#include <algorithm>
 
 // System
 #include "config.h"
@@ -18,6 +20,10 @@
 #include "mcgrid/mcgrid_pdf.hh"
 #include "fillInfo.hh"
 #include "sherpaFillInfo.hh"
+#include "fillInfoCache.hh"
+#include "eventRecord.hh"
+#include "trace.hh"
+#include "exportQueue.hh"
 #include "banner.hh"
 #include "system.hh"
 #if APPLGRID_ENABLED
@@ -26,6 +32,7 @@
 #if FASTNLO_ENABLED
 #include "grid_fnlo.hh"
 #endif
+#include "grid_null.hh"
 
 // Rivet includes
 #include "Rivet/Rivet.hh"
@@ -47,9 +54,92 @@ static std::string idFromPath( std::string const& fullpath)
   return fullpath.substr(ls+1);
 }
 
+namespace {
+  struct cellOrdering
+  {
+    cellOrdering(const Rivet::Histo2DPtr _histo2D): histo2D(_histo2D) {};
+    bool operator()(const size_t a, const size_t b) const
+    {
+      YODA::HistoBin2D const& binA = histo2D.get()->bin(a);
+      YODA::HistoBin2D const& binB = histo2D.get()->bin(b);
+      if (binA.xMin() != binB.xMin())
+        return binA.xMin() < binB.xMin();
+      return binA.yMin() < binB.yMin();
+    }
+    const Rivet::Histo2DPtr histo2D;
+  };
+}
+
+std::vector<size_t> getCellOrder(const Rivet::Histo2DPtr histo2D)
+{
+  std::vector<size_t> order;
+  for (size_t i=0; i<histo2D.get()->numBins(); i++)
+    order.push_back(i);
+  std::sort(order.begin(), order.end(), cellOrdering(histo2D));
+  return order;
+}
+
+// The cells of a 2D histogram as consecutive bins, each as wide as the area
+// of its cell. Grids can then be normalised and convoluted as for a 1D
+// histogram, while the cross sections are differential in both observables
+static Rivet::Histo1DPtr cellHistogram(const Rivet::Histo2DPtr histo2D)
+{
+  const std::vector<size_t> order = getCellOrder(histo2D);
+  std::vector<double> edges(1, 0.0);
+  for (size_t i=0; i<order.size(); i++) {
+    YODA::HistoBin2D const& bin = histo2D.get()->bin(order[i]);
+    edges.push_back(edges.back() + (bin.xMax() - bin.xMin())*(bin.yMax() - bin.yMin()));
+  }
+  return Rivet::Histo1DPtr(new YODA::Histo1D(edges, histo2D.get()->path()));
+}
+
 
 // *********************** Booking Functions **************************
 
+// Grids booked lazily by a BinnedGrid are booked by the fill threads
+static std::mutex& bookingMutex = gridBookingMutex();
+
+// Book a MCgrid::grid object for a 1D histogram, or for the cells of a 2D
+// histogram, returning the shared pointer
+template<class T>
+static gridPtr bookGridForHistograms(const Rivet::Histo1DPtr hist,
+                                     const Rivet::Histo2DPtr hist2D,
+                                     const std::string histoDir,
+                                     T config)
+{
+  std::lock_guard<std::mutex> lock(bookingMutex);
+  showBannerOnce();
+  traceSpan span("booking", "book grid", histoDir + "/" + idFromPath(hist.get()->path()));
+  createPath(MCgridPhasespacePath());
+  createPath(MCgridOutputPath());
+
+  // The null backend only records the fills, see MCGRID_NULL_BACKEND
+  const bool useNullBackend = boolForEnvironmentVariableForKey("MCGRID_NULL_BACKEND");
+
+  #if APPLGRID_ENABLED
+    const applGridConfig *appl_config = dynamic_cast<const applGridConfig*>(&config);
+    if (appl_config) {
+      if (useNullBackend)
+        return gridPtr(new _grid_null(hist, histoDir, *appl_config, hist2D));
+      return gridPtr(new _grid_appl(hist, histoDir, *appl_config, hist2D));
+    }
+  #endif
+
+  #if FASTNLO_ENABLED
+    const fastnloConfig *fnlo_config = dynamic_cast<const fastnloConfig*>(&config);
+    if (fnlo_config) {
+      if (useNullBackend)
+        return gridPtr(new _grid_null(hist, histoDir, *fnlo_config, hist2D));
+      return gridPtr(new _grid_fnlo(hist, histoDir, *fnlo_config, hist2D));
+    }
+  #endif
+
+  cerr << "MCgrid::Error - Failed attempt to read the grid configuration.";
+  cerr << " Is this version of MCgrid configured for use with this grid";
+  cerr << " interface?";
+  exit(-1);
+}
+
 // Book a MCgrid::grid object, returning the shared pointer
 template<class T>
 gridPtr bookGrid(const Rivet::Histo1DPtr hist,
@@ -61,21 +151,47 @@ gridPtr bookGrid(const Rivet::Histo1DPtr hist,
     // Return a pointer to a grid dummy with empty implementations
     return gridPtr(new grid_dummy());
   }
-  showBannerOnce();
-  createPath(MCgridPhasespacePath());
-  createPath(MCgridOutputPath());
+  return bookGridForHistograms(hist, Rivet::Histo2DPtr(), histoDir, config);
+}
+
+// Book a MCgrid::grid object for a 2D histogram, returning the shared pointer
+template<class T>
+gridPtr bookGrid(const Rivet::Histo2DPtr hist,
+                 const std::string histoDir,
+                 T config)
+{
+  if (boolForEnvironmentVariableForKey("MCGRID_DISABLED")) {
+    showDisabledInfoOnce();
+    return gridPtr(new grid_dummy());
+  }
+  return bookGridForHistograms(cellHistogram(hist), hist, histoDir, config);
+}
+
+template<class T>
+void bookSubprocessPDF(const Rivet::Histo1DPtr hist,
+                       const std::string histoDir,
+                       T config)
+{
+  if (boolForEnvironmentVariableForKey("MCGRID_DISABLED"))
+    return;
+  std::lock_guard<std::mutex> lock(bookingMutex);
 
   #if APPLGRID_ENABLED
     const applGridConfig *appl_config = dynamic_cast<const applGridConfig*>(&config);
     if (appl_config) {
-      return gridPtr(new _grid_appl(hist, histoDir, *appl_config));
+      mcgrid_appl_pdf_params pdf_params(appl_config->subprocConfig.fileName,
+                                        appl_config->subprocConfig.beam1,
+                                        appl_config->subprocConfig.beam2);
+      PDFHandler::BookPDF(pdf_params, histoDir);
+      return;
     }
   #endif
 
   #if FASTNLO_ENABLED
     const fastnloConfig *fnlo_config = dynamic_cast<const fastnloConfig*>(&config);
     if (fnlo_config) {
-      return gridPtr(new _grid_fnlo(hist, histoDir, *fnlo_config));
+      bookFastNLOSubprocessPDF(*fnlo_config, hist, histoDir);
+      return;
     }
   #endif
 
@@ -89,9 +205,13 @@ gridPtr bookGrid(const Rivet::Histo1DPtr hist,
 // MCgrid-enhanced Rivet analyses)
 #if APPLGRID_ENABLED
 template gridPtr bookGrid(const Rivet::Histo1DPtr, const std::string, applGridConfig);
+template gridPtr bookGrid(const Rivet::Histo2DPtr, const std::string, applGridConfig);
+template void bookSubprocessPDF(const Rivet::Histo1DPtr, const std::string, applGridConfig);
 #endif
 #if FASTNLO_ENABLED
 template gridPtr bookGrid(const Rivet::Histo1DPtr, const std::string, fastnloConfig);
+template gridPtr bookGrid(const Rivet::Histo2DPtr, const std::string, fastnloConfig);
+template void bookSubprocessPDF(const Rivet::Histo1DPtr, const std::string, fastnloConfig);
 #endif
 
 // ************************* grid class *********************************
@@ -100,31 +220,63 @@ _grid::_grid(const Rivet::Histo1DPtr histPtr,
              const std::string _analysis,
              const int _leadingOrder,
              const bool _isUsingScaleLogGrids,
-             const double _alphaSPrefactor
+             const double _alphaSPrefactor,
+             const Rivet::Histo2DPtr histo2DPtr
              ):
 histo                 (histPtr),
+histo2D               (histo2DPtr),
 mode                  (globalFillMode),
 path                  (idFromPath(histo.get()->path())),
 analysis              (_analysis),
 leadingOrder          (_leadingOrder),
 isUsingScaleLogGrids  (_isUsingScaleLogGrids),
 alphaSPrefactor       (_alphaSPrefactor),
-fl1projection         (new double[11]),
-fl2projection         (new double[11])
+isRecordingExtent     (false),
+profiles              (NULL),
+isTracingFills        (isTracing()),
+closure               (NULL),
+resumedSumOfWeights   (0.0),
+kpProjections         (NULL),
+recordKey             (-1)
 {
   // Inform the user what we're up to
   cout << "MCgrid: Generating new grid for histogram " << path << " of analysis " << analysis << endl;
 
-  // Convert projection arrays to LHA basis
-  fl1projection+=5;
-  fl2projection+=5;
+  if (histo2D) {
+    cout << "MCgrid: The grid has one bin for each of the " << histo2D.get()->numBins() << " cells of the 2D histogram" << endl;
+    cellBins = getCellOrder(histo2D);
+    binCells.resize(cellBins.size());
+    for (size_t i=0; i<cellBins.size(); i++)
+      binCells[cellBins[i]] = i;
+  }
+
+  if (boolForEnvironmentVariableForKey("MCGRID_PROFILE"))
+    profiles = new perThread<fillProfile>();
+
+  if (closureCheck::isEnabled()) {
+    std::vector<double> lowEdges, highEdges;
+    for (size_t i=0; i<histo.get()->numBins(); i++) {
+      lowEdges.push_back(histo.get()->bin(i).xMin());
+      highEdges.push_back(histo.get()->bin(i).xMax());
+    }
+    closure = new closureCheck(lowEdges, highEdges);
+  }
 }
 
 void _grid::readPDFWithParameters(mcgrid_base_pdf_params const& params, const std::string & analysis)
 {
   pdf = PDFHandler::BookPDF(params, analysis);
   nSubProc = pdf->NumberOfSubprocesses();
-  weights = new double[nSubProc];
+  hasBookedGrids.store(true);
+
+  // The KP projections only depend on the subprocess PDF and the number of
+  // active flavours, so they are compiled once per subprocess PDF. This also
+  // keeps them read-only while filling from several threads
+  if (mode == FILL_SHERPA)
+    kpProjections = pdf->KPProjections(numberOfActiveFlavors);
+
+  if (PDFHandler::Recorder() != NULL)
+    recordKey = PDFHandler::Recorder()->gridKey(recordName());
 
   if (Rivet::fileexists(phasespaceFilePath()))
   {
@@ -136,17 +288,150 @@ void _grid::readPDFWithParameters(mcgrid_base_pdf_params const& params, const st
       exit(-1);
     }
   }
+  else if (Rivet::fileexists(phasespaceExtent::filePath(phasespaceFilePath())))
+  {
+    // The phase space grid will be created from merged warmup runs
+    if (!pdf->isInitialised())
+    {
+      cerr << "MCgrid Error: Merged phase space extents are available, but event count data is not present."<<endl;
+      cerr << "                  Please merge the event count data of the phase space runs as well." <<endl;
+      exit(-1);
+    }
+  }
+}
+
+bool _grid::readMergedPhasespaceExtent(phasespaceExtent& extent) const
+{
+  if (Rivet::fileexists(phasespaceFilePath()))
+    return false;
+  return phasespaceExtent::read(phasespaceExtent::filePath(phasespaceFilePath()), extent);
+}
+
+void _grid::checkClosure(std::string const& filePath) const
+{
+  if (closure == NULL)
+    return;
+  traceSpan span("export", "closure check", recordName());
+  closure->check(filePath, recordName());
+}
+
+/*
+ *  The export is queued as is, the normalisation has to be applied with
+ *  scale() before. Exports of different grids run concurrently, but ROOT
+ *  files are still read and written one at a time, see gridFileMutex.
+ */
+void _grid::exportgrid()
+{
+  if (exportThreads() < 2) {
+    exportUnderlyingGrid();
+    return;
+  }
+  cout << "MCgrid: Queueing export of " << recordName() << endl;
+  queueExport(this, recordName(), [this]() { exportUnderlyingGrid(); });
+}
+
+// ************************* checkpoints ********************************
+
+namespace {
+  class phasespaceExtentSnapshot: public checkpointSnapshot
+  {
+  public:
+    phasespaceExtentSnapshot(phasespaceExtent const& _extent): extent(_extent) {};
+    void write(std::string const& path) const { extent.write(path); };
+
+  private:
+    const phasespaceExtent extent;
+  };
+}
+
+void _grid::registerCheckpoint()
+{
+  if (PDFHandler::Checkpointer() != NULL)
+    PDFHandler::Checkpointer()->addGrid(this);
+}
+
+// The snapshot is taken between two events, while no thread fills
+checkpointSnapshot* _grid::snapshot() const
+{
+  traceSpan span("checkpoint", "snapshot", recordName());
+  if (isRecordingExtent)
+    return new phasespaceExtentSnapshot(recordedPhasespaceExtent());
+  return snapshotUnderlyingGrid();
+}
+
+// Called on booking, before any fill. The reference weights of the closure
+// check can not be resumed, which is why the check is skipped
+void _grid::resume(std::string const& path)
+{
+  if (closure != NULL) {
+    cout << "MCgrid: Skipping the closure check of " << recordName() << ", the grid is resumed from a checkpoint" << endl;
+    delete closure;
+    closure = NULL;
+  }
+
+  if (!isRecordingExtent) {
+    resumeUnderlyingGrid(path);
+    resumedSumOfWeights = PDFHandler::Checkpointer()->resumedSumOfWeights();
+    return;
+  }
+  phasespaceExtent* extent = new phasespaceExtent();
+  if (!phasespaceExtent::read(path, *extent)) {
+    cerr << "MCgrid::Error - Unable to read the checkpointed phase space extent " << path << endl;
+    exit(-1);
+  }
+  delete threadExtents.release(0);
+  threadExtents.set(0, extent);
+}
+
+double _grid::resumedNormalisation() const
+{
+  const double sumOfWeights = PDFHandler::SumOfWeights();
+  if (resumedSumOfWeights == 0.0 || sumOfWeights == 0.0)
+    return 1.0;
+  const double normalisation = (sumOfWeights - resumedSumOfWeights) / sumOfWeights;
+  cout << "MCgrid: " << recordName() << " is resumed from a checkpoint, its normalisation is ";
+  cout << "multiplied by " << normalisation << " to include the events before the resumption" << endl;
+  return normalisation;
+}
+
+void _grid::waitForQueuedExport() const
+{
+  waitForExport(this);
+}
+
+void _grid::exportProfile(std::string const& filePath) const
+{
+  if (profiles == NULL)
+    return;
+
+  fillProfile profile;
+  for (int slot=0; slot<maxFillThreads; slot++) {
+    fillProfile* threadProfile = profiles->get(slot);
+    if (threadProfile != NULL)
+      profile.merge(*threadProfile);
+  }
+  profile.write(filePath + ".profile.json", recordName(), gridInterfaceName(),
+                fillString[mode], PDFHandler::NEvents());
+}
+
+phasespaceExtent _grid::recordedPhasespaceExtent() const
+{
+  phasespaceExtent extent;
+  for (int slot=0; slot<maxFillThreads; slot++) {
+    phasespaceExtent* threadExtent = threadExtents.get(slot);
+    if (threadExtent != NULL)
+      extent.merge(*threadExtent);
+  }
+  return extent;
 }
 
 // Grid class destructor
 _grid::~_grid()
 { 
-  fl1projection-=5;
-  fl2projection-=5;
-  
-  delete[] fl1projection;
-  delete[] fl2projection;
-  delete[] weights;
+  if (PDFHandler::Checkpointer() != NULL)
+    PDFHandler::Checkpointer()->removeGrid(this);
+  delete profiles;
+  delete closure;
 }
 
 
@@ -154,69 +439,238 @@ _grid::~_grid()
  *  grid::fill
  *  Provides the conversion of a HepMC event into the appropriate
  *  fill call for applgrid or fastNLO, based upon the specified fillMode
- *  and interface
+ *  and interface. The decoded event is shared between all grids through
+ *  the PDFHandler's fill info cache. May be called from several threads
+ *  at once, see setFillThreadSlot
  **/
 void _grid::fill( double coord, const Rivet::Event& event)
 {
+  if (recordKey >= 0)
+    PDFHandler::Recorder()->recordFill(event, recordKey, coord);
+
+  fillProfile* profile = localProfile();
   switch (mode)
   {
-    case FILL_GENERIC: {
-      fillInfo info(event);  
-      fillReferenceHistogram(coord, info.wgt);
-      genericFill(coord, info);
+    case FILL_GENERIC:
+    {
+      fillInfo const* info;
+      {
+        profileTimer timer(profile ? &profile->decodingNs : NULL);
+        info = &PDFHandler::FillInfoCache().genericInfo(event);
+      }
+      fillFromInfo(coord, *info, &PDFHandler::FillInfoCache().weightCache());
       break;
     }
       
-    case FILL_SHERPA: {
-      sherpaFillInfo info(event);  
-      fillReferenceHistogram(coord, info.wgt);
-      sherpaFill(coord, info);
+    case FILL_SHERPA:
+    {
+      sherpaFillInfo const* info;
+      {
+        profileTimer timer(profile ? &profile->decodingNs : NULL);
+        info = &PDFHandler::FillInfoCache().sherpaInfo(event, isUsingScaleLogGrids);
+      }
+      fillFromInfo(coord, *info, &PDFHandler::FillInfoCache().weightCache());
       break;
     }
   }
 }
 
+// The coordinate of the 2D histogram bin is the centre of its cell
+void _grid::fill( double x, double y, const Rivet::Event& event)
+{
+  if (!histo2D) {
+    cerr << "MCgrid::Error - The grid " << recordName() << " has been booked for a 1D histogram, ";
+    cerr << "fill it with a single coordinate." << endl;
+    exit(-1);
+  }
+  const int bin = histo2D.get()->binIndexAt(x, y);
+  if (bin < 0)
+    return;
+  fill(histo.get()->bin(binCells[bin]).xMid(), event);
+}
+
+YODA::HistoBin2D const& _grid::cellBin(double coord) const
+{
+  return histo2D.get()->bin(cellBins[histo.get()->binIndexAt(coord)]);
+}
+
+void _grid::fillFromInfo(double coord, fillInfo const& info, eventWeightCache* cache)
+{
+  assert(mode == FILL_GENERIC);
+  traceFillScope traceScope(isTracingFills);
+  fillProfile* profile = localProfile();
+  profileTimer timer(profile ? &profile->fillNs : NULL);
+  if (profile)
+    profile->nFills++;
+
+  if (isRecordingExtent) {
+    recordExtent(info.x1, info.x2, info.pdfQ2, coord);
+    return;
+  }
+
+  {
+    profileTimer referenceTimer(profile ? &profile->referenceNs : NULL);
+    fillReferenceHistogram(coord, info.wgt);
+    if (closure)
+      closure->add(histo.get()->binIndexAt(coord), info.wgt);
+  }
+
+  eventWeights const* fills = (cache != NULL) ? cache->find(weightCacheKey(&info)) : NULL;
+  if (fills == NULL) {
+    eventWeights& computed = newEventWeights(&info, cache);
+    genericFill(localWeights(), computed, info);
+    fills = &computed;
+  }
+  fillEventWeights(*fills, coord);
+}
+
+void _grid::fillFromInfo(double coord, sherpaFillInfo const& info, eventWeightCache* cache)
+{
+  assert(mode == FILL_SHERPA);
+  // Replayed events whose scale logarithm weights were missing in the
+  // recorded run carry them as 0
+  if (isUsingScaleLogGrids && !info.hasScaleLogWeights) {
+    cerr << "MCgrid::Error - The event lacks the scale logarithm weights required by the grid " << recordName() << "." << endl;
+    cerr << "                Please check the reweighting options of the recorded SHERPA run." << endl;
+    exit(-1);
+  }
+  traceFillScope traceScope(isTracingFills);
+  fillProfile* profile = localProfile();
+  profileTimer timer(profile ? &profile->fillNs : NULL);
+  if (profile)
+    profile->nFills++;
+
+  if (isRecordingExtent) {
+    sherpaRecordExtent(coord, info);
+    return;
+  }
+
+  {
+    profileTimer referenceTimer(profile ? &profile->referenceNs : NULL);
+    fillReferenceHistogram(coord, info.wgt);
+    if (closure)
+      closure->add(histo.get()->binIndexAt(coord), info.wgt);
+  }
+
+  eventWeights const* fills = (cache != NULL) ? cache->find(weightCacheKey(&info)) : NULL;
+  if (fills == NULL) {
+    eventWeights& computed = newEventWeights(&info, cache);
+    sherpaFill(localWeights(), computed, info);
+    fills = &computed;
+  }
+  fillEventWeights(*fills, coord);
+}
+
+eventWeightCache::key _grid::weightCacheKey(const void* info) const
+{
+  eventWeightCache::key key;
+  key.info = info;
+  key.pdf = pdf;
+  key.leadingOrder = leadingOrder;
+  key.alphaSPrefactor = alphaSPrefactor;
+  key.isUsingScaleLogGrids = isUsingScaleLogGrids;
+  key.nActiveFlavors = (kpProjections != NULL) ? kpProjections->numberOfActiveFlavors() : 0;
+  return key;
+}
+
+eventWeights& _grid::newEventWeights(const void* info, eventWeightCache* cache)
+{
+  if (cache != NULL)
+    return cache->insert(weightCacheKey(info));
+  eventWeights& fills = threadFills.local();
+  fills.clear();
+  return fills;
+}
+
+void _grid::fillEventWeights(eventWeights const& fills, const double coord)
+{
+  subprocessWeights& weights = localWeights();
+  for (size_t i(0); i < fills.size(); i++) {
+    eventWeights::fill const& fill = fills[i];
+    fills.copyWeights(fill, weights);
+    fillBackend(weights, fill.x1, fill.x2, fill.pdfQ2, coord, static_cast<termType>(fill.termType));
+  }
+}
+
+void _grid::fillBackend(subprocessWeights const& weights,
+                        const double x1,
+                        const double x2,
+                        const double pdfQ2,
+                        const double coord,
+                        const termType termType)
+{
+  fillProfile* profile = localProfile();
+  if (profile == NULL) {
+    fillUnderlyingGrid(weights, x1, x2, pdfQ2, coord, termType);
+    return;
+  }
+
+  profile->nUnderlyingFills[termType]++;
+  std::vector<int> const& touched = weights.touchedSubprocesses();
+  for (size_t i(0); i < touched.size(); i++)
+    if (weights[touched[i]] != 0.0)
+      profile->nNonzeroWeights[termType]++;
+
+  profileTimer timer(&profile->backendNs[termType]);
+  fillUnderlyingGrid(weights, x1, x2, pdfQ2, coord, termType);
+}
+
+std::string _grid::recordName() const
+{
+  return analysis + "/" + path;
+}
+
+
+// The weight container of the calling thread
+subprocessWeights& _grid::localWeights()
+{
+  subprocessWeights& weights = threadWeights.local();
+  if (weights.size() != nSubProc)
+    weights.resize(nSubProc);
+  return weights;
+}
+
 
 // Zeros the weight container
-void _grid::zeroWeights()
+void _grid::zeroWeights(subprocessWeights& weights)
 {
-  for (int i=0; i<nSubProc; i++)
-    weights[i] = 0;
+  weights.clear();
 }
 
 
 // Populate the subprocess weight array with a single weight
-void _grid::fillWeight(const int fl1,
+void _grid::fillWeight(subprocessWeights& weights,
+                       const int fl1,
                       const int fl2,
                       const double eventweight,
                       const bool shouldApplyEventRatio
                       )
 {
-  const int subproc = pdf->decideSubProcess(fl1, fl2);
-  const double norm = (shouldApplyEventRatio) ? pdf->EventRatio(fl1, fl2) : 1.0;
-  weights[subproc] += norm * eventweight;
+  const subprocessLookup lookup = pdf->LookupSubProcess(fl1, fl2);
+  const double norm = (shouldApplyEventRatio) ? lookup.eventRatio : 1.0;
+  weights.add(lookup.subproc, norm * eventweight);
 }
 
 
-void _grid::projectWeights ( const int fl1,  // beam 1 flavour
+void _grid::projectWeights ( subprocessWeights& weights,
+                            const int fl1,  // beam 1 flavour
                             const int fl2,  // beam 2 flavour
                             const double wgt,  // weight to be projected
-                            wgtProjector projectBeam1,
-                            wgtProjector projectBeam2,
-                            const bool shouldApplyEventRatio
+                            const kpProjector projectBeam1,
+                            const kpProjector projectBeam2
                           )
 {
-  // Build projections
-  projectBeam1(fl1, fl1projection);
-  projectBeam2(fl2, fl2projection);
+  kpProjections->project(fl1, fl2, wgt, projectBeam1, projectBeam2, weights);
+}
 
-  // Project weights onto beam partons
-  for ( int i=-5; i<=5; i++ )
-    if (fl1projection[i])
-      for( int j=-5; j<=5; j++ )
-        if (fl2projection[j])
-          fillWeight(i, j, fl1projection[i]*fl2projection[j]*wgt, shouldApplyEventRatio);
-  return;
+void _grid::recordExtent(const double x1,
+                         const double x2,
+                         const double pdfQ2,
+                         const double coord)
+{
+  const int bin = histo.get()->binIndexAt(coord);
+  if (bin >= 0)
+    threadExtents.local().add(bin, x1, x2, pdfQ2);
 }
 
 std::string _grid::gridInterfaceName(gridInterface interface) const
@@ -290,6 +744,8 @@ std::string _grid::gridOrPhasespaceFilePath() const
 void _grid::scale(double const& scale)
 {
   cout << "MCgrid: Will set " << path << " normalisation to: " << scale << endl;
+  if (closure)
+    closure->scale(scale);
 }
   
 }
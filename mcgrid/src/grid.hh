@@ -12,14 +12,20 @@
 #include "mcgrid/mcgrid_pdf.hh"
 
 #include "mcgrid.hh"
+#include "kpProjection.hh"
+#include "subprocessWeights.hh"
+#include "eventWeights.hh"
+#include "threading.hh"
+#include "phasespaceExtent.hh"
+#include "fillProfile.hh"
+#include "closureCheck.hh"
+#include "checkpoint.hh"
 
 // Forward decl
 namespace MCgrid{ class fillInfo; class sherpaFillInfo; }
 
 namespace MCgrid {
 
-typedef void (*wgtProjector)(const int, double*);
-
 // Returns vector of lower bin edges for appl_grid constructor
 static std::vector<double> getBinning( const Rivet::Histo1DPtr histo)
 {
@@ -33,11 +39,17 @@ static std::vector<double> getBinning( const Rivet::Histo1DPtr histo)
   return lowEdges;
 }
 
+// Returns the bins of a 2D histogram in the order of the cells of its grid,
+// by their lower x edges and then their lower y edges. This is the order of
+// the bins of a double-differential fastNLO table
+std::vector<size_t> getCellOrder(const Rivet::Histo2DPtr histo2D);
+
 // Empty implementation for (abstract) grid declaration in public header
 // Used in `bookGrid` to return a dummy object when the MCGRID_DISABLED env var is set
 class grid_dummy : public grid {
 public:
   void fill( double coord, const Rivet::Event& event) {}
+  void fill( double x, double y, const Rivet::Event& event) {}
   void exportgrid() {}
   void scale( double const& scale) {}
 };
@@ -46,15 +58,34 @@ public:
 class _grid : public grid {
 public:
 
-  // Create a new grid based upon a YODA histogram
+  // Create a new grid based upon a YODA histogram. A grid booked for a 2D
+  // histogram is given the histogram of its cells as well, see bookGrid
   _grid(const Rivet::Histo1DPtr,
         const std::string _analysis,
         const int _leadingOrder,
         const bool _isUsingScaleLogGrids = false,
-        const double _alphaSPrefactor = 1/(2.0*M_PI));
+        const double _alphaSPrefactor = 1/(2.0*M_PI),
+        const Rivet::Histo2DPtr = Rivet::Histo2DPtr());
 
   ~_grid();
 
+  // Fill the grid with an already decoded event, as done by grid::fill and
+  // when replaying an event record. The info type must match the fill mode.
+  // Grids filling the same info share its subprocess weights through the
+  // cache of the fill thread, if one is given
+  void fillFromInfo(double coord, fillInfo const&, eventWeightCache* = NULL);
+  void fillFromInfo(double coord, sherpaFillInfo const&, eventWeightCache* = NULL);
+
+  // Name of the grid in an event record, <analysis>/<histogram name>
+  std::string recordName() const;
+
+  // Checkpointing, see checkpointer. Warmup runs checkpoint the recorded
+  // phase space extent, which works with every backend
+  virtual bool isCheckpointable() const { return isRecordingExtent; };
+  std::string checkpointKind() const { return isRecordingExtent ? "extent" : "grid"; };
+  checkpointSnapshot* snapshot() const;
+  void resume(std::string const& path);
+
 protected:
   
   std::string gridInterfaceName(gridInterface) const;
@@ -65,10 +96,50 @@ protected:
   // Setup subprocess configuration PDF
   void readPDFWithParameters(mcgrid_base_pdf_params const &, const std::string & analysis);
 
+  // Read the merged extents of parallel warmup runs, if there is no phase
+  // space grid yet. The backends then recreate the phase space grid by
+  // filling the corner points of each bin into a warmup grid
+  bool readMergedPhasespaceExtent(phasespaceExtent&) const;
+
+  // The phase space extent recorded in this warmup run by all fill threads
+  phasespaceExtent recordedPhasespaceExtent() const;
+
+  // Write the fill profile of all fill threads next to the exported grid,
+  // if MCGRID_PROFILE is set
+  void exportProfile(std::string const& filePath) const;
+
+  // Compare the exported grid with the filled event weights, if
+  // MCGRID_CLOSURE_PDF is set
+  void checkClosure(std::string const& filePath) const;
+
+  // Add the grid to the checkpoints of the run, if checkpointing is
+  // enabled. Backends call this at the end of their constructor
+  void registerCheckpoint();
+
+  // Copy the state of the underlying grid for a checkpoint, or add a
+  // checkpointed state to it. Only needed if isCheckpointable
+  virtual checkpointSnapshot* snapshotUnderlyingGrid() const { return NULL; };
+  virtual void resumeUnderlyingGrid(std::string const& path) {};
+
+  // Factor correcting the normalisation of a grid resumed from a checkpoint.
+  // Rivet's sum of weights only covers the events after the resumption, the
+  // grid also contains those before it
+  double resumedNormalisation() const;
+
+  // Wait until a queued export of the grid is finished. Backends call this
+  // first in their destructor, as the export uses their members
+  void waitForQueuedExport() const;
+
   // Scale the weight output of the grid
   virtual void scale( double const& scale);
 
-  const Rivet::Histo1DPtr histo;   //!< Pointer to associated rivet histogram
+  // The bin of the 2D histogram of a coordinate of the cell histogram
+  YODA::HistoBin2D const& cellBin(double coord) const;
+
+  const Rivet::Histo1DPtr histo;   //!< Pointer to associated rivet histogram, or the histogram of the cells of histo2D
+  const Rivet::Histo2DPtr histo2D; //!< Pointer to associated 2D rivet histogram (or NULL)
+  std::vector<size_t> cellBins;    //!< Bin of histo2D for each cell, see getCellOrder
+  std::vector<int> binCells;       //!< Cell for each bin of histo2D
   const std::string path;          //!< Path identifier obtained from histogram
   const std::string analysis;      //!< Analysis subdirectory
 
@@ -79,7 +150,14 @@ protected:
 
   int        nSubProc;             //!< Number of active subprocesses
   mcgrid_base_pdf* pdf;            //!< PDF for subprocess classification
-  double*    weights;              //!< Array of subprocess weights to be passed to appl::grid::fill or fastNLOCreate::fill
+  perThread<subprocessWeights> threadWeights; //!< Per-thread subprocess weights to be passed to appl::grid::fill or fastNLOCreate::fill
+  perThread<eventWeights> threadFills; //!< Per-thread weights of an event filled without a cache
+  bool isRecordingExtent;          //!< Whether this is a warmup run, which only records the phase space extent
+  perThread<phasespaceExtent> threadExtents; //!< Per-thread phase space extent of a warmup run
+  perThread<fillProfile>* profiles; //!< Per-thread fill profiles if MCGRID_PROFILE is set (or NULL)
+  const bool isTracingFills;       //!< Whether fills are added to the MCGRID_TRACE timeline
+  closureCheck* closure;           //!< Per-bin reference weights if MCGRID_CLOSURE_PDF is set (or NULL)
+  double resumedSumOfWeights;      //!< Sum of the event weights of the checkpoint the grid is resumed from, or 0
   
   // The term type is used to differentiate between contributions that might be tracked by different subgrids
   typedef enum termType {
@@ -94,21 +172,59 @@ private:
 
   // Fill the grid with an event
   void fill( double coord, const Rivet::Event& event);
+  void fill( double x, double y, const Rivet::Event& event);
   virtual void fillReferenceHistogram(double coord, double wgt) = 0;
   
-  // Write the grid to file
-  virtual void exportgrid() = 0;
+  // Write the grid to file, or queue writing it if MCGRID_EXPORT_THREADS is set
+  void exportgrid();
+  virtual void exportUnderlyingGrid() = 0;
+
+  // The weight container of the calling thread
+  subprocessWeights& localWeights();
+
+  // The fill profile of the calling thread, or NULL if not profiling
+  fillProfile* localProfile() { return (profiles == NULL) ? NULL : &profiles->local(); };
 
-  // Zeros the internal weight container;
-  void zeroWeights();
+  // Zeros a weight container
+  void zeroWeights(subprocessWeights&);
   
-  // Fillmodes specify the conversion from HepMC
-  void genericFill(double coord, fillInfo const&);  // Basic fillmode
-  void sherpaFill( double coord, sherpaFillInfo const&); // SHERPA fillmode
-  void sherpaBLikeFill(double coord, double norm, fillInfo const&, termType termType);
-  void sherpaKPFill(double coord, double norm, sherpaFillInfo const&, termType termType);
+  // Fillmodes specify the conversion from HepMC. The weights of each fill
+  // of the underlying grid are added to the event weights, they do not
+  // depend on the observable
+  void genericFill(subprocessWeights&, eventWeights&, fillInfo const&);  // Basic fillmode
+  void sherpaFill(subprocessWeights&, eventWeights&, sherpaFillInfo const&); // SHERPA fillmode
+  void sherpaBLikeFill(subprocessWeights&, eventWeights&, double norm, fillInfo const&, termType termType);
+  void sherpaKPFill(subprocessWeights&, eventWeights&, double norm, sherpaFillInfo const&, termType termType);
+
+  // The key of the event weights of a fill info in an eventWeightCache.
+  // Grids with the same key compute the same weights
+  eventWeightCache::key weightCacheKey(const void* info) const;
+
+  // The list to compute the event weights into: a new entry of the cache,
+  // or the list of the calling thread without one
+  eventWeights& newEventWeights(const void* info, eventWeightCache*);
+
+  // Fill the event weights into the underlying grid at the coordinate
+  void fillEventWeights(eventWeights const&, const double coord);
+
+  // Warmup runs only record the x1, x2 and Q^2 ranges of the fills into each
+  // bin. These mirror the fill methods without any weight computations
+  void recordExtent(const double x1, const double x2, const double pdfQ2, const double coord);
+  void sherpaRecordExtent(double coord, sherpaFillInfo const&);
+
+  // Fill the subprocess weights into the underlying grid, counting and
+  // timing the fill when profiling
+  void fillBackend(subprocessWeights const&,
+                   const double x1,
+                   const double x2,
+                   const double pdfQ2,
+                   const double coord,
+                   const termType termType);
 
-  virtual void fillUnderlyingGrid(const double x1,
+  // Fill the subprocess weights into the underlying grid. This is called
+  // concurrently by all fill threads
+  virtual void fillUnderlyingGrid(subprocessWeights const&,
+                                  const double x1,
                                   const double x2,
                                   const double pdfQ2,
                                   const double coord,
@@ -117,20 +233,21 @@ private:
   // Populate the subprocess weight array with a single weight
   // The weight is multiplied by the return value of the EventRatio function,
   // if shouldApplyEventRatio is true
-  void fillWeight(const int fl1,
+  void fillWeight(subprocessWeights&,
+                  const int fl1,
                   const int fl2,
                   const double eventweight,
                   const bool shouldApplyEventRatio
                   );
   
   // Project a weight across other parton channels based upon the basic
-  // initial beam flavours.
-  void projectWeights( const int fl1,                     // beam 1 flavour
+  // initial beam flavours, using the precompiled projection table.
+  void projectWeights( subprocessWeights&,
+                       const int fl1,                     // beam 1 flavour
                        const int fl2,                     // beam 2 flavour
                        const double w,                    // weight to be projected
-                       wgtProjector,                      // beam 1 projector
-                       wgtProjector,                      // beam 2 projector
-                       const bool shouldApplyEventRatio   // passed to fillWeight function
+                       const kpProjector,                 // beam 1 projector
+                       const kpProjector                  // beam 2 projector
   );
 
   virtual std::string gridInterfaceName() const = 0;
@@ -144,8 +261,8 @@ private:
   
   // **************************** Attributes ****************************
   
-  double* fl1projection;          //!< Projection of weights over beam 1 partons
-  double* fl2projection;          //!< Projection of weights over beam 2 partons
+  kpProjectionTable const* kpProjections; //!< Precompiled KP projections, owned by the subprocess PDF
+  int recordKey;                    //!< Key of the grid in the event record, -1 if not recording
 };
 
 }
@@ -7,10 +7,16 @@
 
 #if APPLGRID_ENABLED
 
+#include <cstdio>
+#include <unistd.h>
+#include <mutex>
+
 #include "appl_grid/appl_grid.h"
 #include "appl_grid/lumi_pdf.h"
 
 #include "grid_appl.hh"
+#include "runInfo.hh"
+#include "trace.hh"
 
 using Rivet::cerr;
 using Rivet::cout;
@@ -24,8 +30,11 @@ namespace MCgrid
   }
   _grid_appl::_grid_appl(const Rivet::Histo1DPtr histPtr,
                          const std::string _analysis,
-                         applGridConfig config):
-    _grid(histPtr, _analysis, config.lo, config.shouldUseScaleLogGrids, config.shouldUseScaleLogGrids ? 4*M_PI : 1/(2*M_PI))
+                         applGridConfig config,
+                         const Rivet::Histo2DPtr histo2DPtr):
+    _grid(histPtr, _analysis, config.lo, config.shouldUseScaleLogGrids, config.shouldUseScaleLogGrids ? 4*M_PI : 1/(2*M_PI), histo2DPtr),
+    config(config),
+    applgrid(NULL)
   {
     // Inform the user what we're up to
     cout << "MCgrid: Use APPLgrid as underlying grid implementation" << endl;
@@ -40,14 +49,45 @@ namespace MCgrid
     readPDFWithParameters(*pdf_params, analysis);
     delete pdf_params;
 
+    warmupRun = !Rivet::fileexists(phasespaceFilePath());
+    phasespaceExtent extent;
+    if (readMergedPhasespaceExtent(extent)) {
+      cout << "MCgrid: Creating phase space grid from merged warmup runs" << endl;
+      materialisePhasespace(extent);
+      warmupRun = false;
+    }
+
+    if (isUsingScaleLogGrids)
+      cout << "MCgrid: Enabling dedicated scale logarithm APPLgrids" << endl;
+
+    // A warmup run only records the phase space extent, the phase space grid
+    // is created from it on export
+    isRecordingExtent = isWarmup();
     if (!isWarmup()) {
-      // Create grid based on an existing phase space grid
       cout << "MCgrid: Reading phase space optimised APPLgrid" << endl;
-      applgrid = new appl::grid(phasespaceFilePath());
+      applgrid = newUnderlyingGrid();
+    }
+    registerCheckpoint();
+  }
+
+  _grid_appl::~_grid_appl()
+  {
+    waitForQueuedExport();
+    delete applgrid;
+  }
+
+  appl::grid* _grid_appl::newUnderlyingGrid() const
+  {
+    std::lock_guard<std::mutex> lock(gridFileMutex());
+    appl::grid *newgrid;
+    if (!isWarmup()) {
+      // Create grid based on an existing phase space grid
+      traceSpan span("phasespace", "read phase space grid", recordName());
+      newgrid = new appl::grid(phasespaceFilePath());
     } else {
       // Create grid from scratch
       applGridArch arch = config.arch;
-      applgrid = new appl::grid(getBinning(histo),
+      newgrid = new appl::grid(getBinning(histo),
                                 arch.nQ,
                                 config.q2min,
                                 config.q2max,
@@ -65,54 +105,215 @@ namespace MCgrid
 
     // Configure scale logarithm treatment
     if (isUsingScaleLogGrids) {
-      cout << "MCgrid: Enabling dedicated scale logarithm APPLgrids" << endl;
-      applgrid->amcatnlo();
-      assert(applgrid->calculation() == 1);
+      newgrid->amcatnlo();
+      assert(newgrid->calculation() == 1);
     } else {
-      assert(applgrid->calculation() == 0);
+      assert(newgrid->calculation() == 0);
     }
+    return newgrid;
   }
 
-  _grid_appl::~_grid_appl()
+  // The corner points of each bin are filled into all orders of a warmup
+  // grid, which is then optimised as at the end of a warmup run. The grid is
+  // written to a temporary file first, such that concurrently starting runs
+  // never read an incomplete phase space grid.
+  void _grid_appl::materialisePhasespace(phasespaceExtent const& extent)
   {
-    delete applgrid;
+    traceSpan span("phasespace", "create phase space grid", recordName());
+    appl::grid *warmupgrid = newUnderlyingGrid();
+
+    const int nGridIndices = isUsingScaleLogGrids ? 4 : 2;
+    std::vector<double> unitWeights(nSubProc, 1.0);
+    for (size_t i(0); i < extent.numberOfBins() && i < histo.get()->numBins(); i++) {
+      const double coord = histo.get()->bin(i).xMid();
+      const std::vector<phasespaceExtent::cornerPoint> corners = extent.cornerPoints(i);
+      for (size_t j(0); j < corners.size(); j++)
+        for (int gridIndex=0; gridIndex<nGridIndices; gridIndex++)
+          warmupgrid->fill_grid(corners[j].x1, corners[j].x2, corners[j].q2, coord, &unitWeights[0], gridIndex);
+    }
+
+    {
+      traceSpan optimiseSpan("phasespace", "optimise", recordName());
+      warmupgrid->optimise();
+    }
+
+    std::stringstream temporaryPath;
+    temporaryPath << phasespaceFilePath() << ".tmp." << getpid();
+    std::lock_guard<std::mutex> lock(gridFileMutex());
+    warmupgrid->Write(temporaryPath.str());
+    std::rename(temporaryPath.str().c_str(), phasespaceFilePath().c_str());
+    delete warmupgrid;
+  }
+
+  void applFillBuffer::fillInto(appl::grid& grid, const int nSubProc) const
+  {
+    for (size_t i(0); i < fills.size(); i++)
+      grid.fill_grid(fills[i].x1, fills[i].x2, fills[i].pdfQ2, fills[i].coord,
+                     &subprocWeights[i*nSubProc], fills[i].gridIndex);
+    for (size_t i(0); i < referenceFills.size(); i++)
+      grid.getReference()->Fill(referenceFills[i].first, referenceFills[i].second);
+  }
+
+  applFillSlot::~applFillSlot()
+  {
+    if (replica == NULL)
+      return;
+    std::lock_guard<std::mutex> lock(gridFileMutex());
+    delete replica;
+  }
+
+  applFillSlot* _grid_appl::localFillSlot()
+  {
+    if (fillThreadSlot() == 0)
+      return NULL;
+    return &fillSlots.local();
+  }
+
+  void _grid_appl::spillFillBuffer(applFillSlot& slot)
+  {
+    if (slot.replica == NULL)
+      slot.replica = newUnderlyingGrid();
+    slot.buffer.fillInto(*slot.replica, nSubProc);
+    slot.buffer.clear();
+  }
+
+  // Once the fill threads are done, the fills of each slot are added to the
+  // grid, which slot 0 has filled directly. Only the arithmetic of the grids
+  // is done here, which does not need gridFileMutex
+  void _grid_appl::flushFillBuffers()
+  {
+    traceSpan span("export", "flush fill buffers", recordName());
+    for (int slot=1; slot<maxFillThreads; slot++) {
+      applFillSlot *fills = fillSlots.release(slot);
+      if (fills == NULL)
+        continue;
+      if (fills->replica != NULL) {
+        spillFillBuffer(*fills);
+        *applgrid += *fills->replica;
+      } else {
+        fills->buffer.fillInto(*applgrid, nSubProc);
+      }
+      delete fills;
+    }
+  }
+
+  namespace {
+    // Owns a merged copy of the grid, which is written by the checkpoint writer
+    class applSnapshot: public checkpointSnapshot
+    {
+    public:
+      applSnapshot(appl::grid* _grid): grid(_grid) {};
+      ~applSnapshot()
+      {
+        std::lock_guard<std::mutex> lock(gridFileMutex());
+        delete grid;
+      }
+
+      void write(std::string const& path) const
+      {
+        std::lock_guard<std::mutex> lock(gridFileMutex());
+        grid->Write(path);
+      }
+
+    private:
+      appl::grid* const grid;
+    };
+  }
+
+  // The replicas and buffered fills are added to a copy in the same order
+  // as on export, such that the fill threads keep them
+  checkpointSnapshot* _grid_appl::snapshotUnderlyingGrid() const
+  {
+    appl::grid *snapshot;
+    {
+      std::lock_guard<std::mutex> lock(gridFileMutex());
+      snapshot = new appl::grid(*applgrid);
+    }
+    for (int slot=1; slot<maxFillThreads; slot++) {
+      applFillSlot *fills = fillSlots.get(slot);
+      if (fills == NULL)
+        continue;
+      if (fills->replica != NULL)
+        *snapshot += *fills->replica;
+      fills->buffer.fillInto(*snapshot, nSubProc);
+    }
+    return new applSnapshot(snapshot);
+  }
+
+  void _grid_appl::resumeUnderlyingGrid(std::string const& path)
+  {
+    std::lock_guard<std::mutex> lock(gridFileMutex());
+    appl::grid *checkpoint = new appl::grid(path);
+    *applgrid += *checkpoint;
+    delete checkpoint;
   }
 
   void _grid_appl::fillReferenceHistogram(double coord, double wgt) {
+    applFillSlot *fills = localFillSlot();
+    if (fills != NULL) {
+      fills->buffer.addReference(coord, wgt);
+      return;
+    }
     applgrid->getReference()->Fill(coord, wgt);
   }
 
   bool _grid_appl::isWarmup() const
   {
     // NOTE: The isOptimized member function of appl::grid is not really useful here,
-    // as a even a warmup grid will be optimized at some point
-    return !Rivet::fileexists(phasespaceFilePath());
+    // as a even a warmup grid will be optimized at some point. The phase
+    // space file is looked up once on construction, as it is written during
+    // the export of a warmup run
+    return warmupRun;
   }
 
-  void _grid_appl::exportgrid()
+  void _grid_appl::exportUnderlyingGrid()
   {
+    traceSpan span("export", "export grid", recordName());
     if (isWarmup()) {
+      const phasespaceExtent extent = recordedPhasespaceExtent();
+      extent.write(phasespaceExtent::filePath(phasespaceFilePath()));
       cout << "MCgrid: Optimising grid phase space ..." << endl;
-      applgrid->optimise();
+      materialisePhasespace(extent);
       cout << "MCgrid: ... grid optimised." << endl;
-      cout << "MCgrid: Writing out phase space grid." << endl;
-    } else {
-      cout << "MCgrid: Exporting final " << gridInstanceString[applgridInterface];
-      cout << "." << endl;
+      exportProfile(phasespaceFilePath());
+      cout << "MCgrid: Export Complete"<<endl;
+      return;
     }
 
-    applgrid->Write(gridOrPhasespaceFilePath());
+    flushFillBuffers();
+    cout << "MCgrid: Exporting final " << gridInstanceString[applgridInterface];
+    cout << "." << endl;
+
+    const std::string filePath(gridOrPhasespaceFilePath());
+    {
+      traceSpan writeSpan("write", "write grid", recordName());
+      std::lock_guard<std::mutex> lock(gridFileMutex());
+      applgrid->Write(filePath);
+    }
+
+    // Keep the event count next to the grid, such that it can be combined
+    // with the grids of other runs, see mergeGrids
+    runInfo info;
+    info.nEvents = PDFHandler::NEvents();
+    exportRunInfo(filePath, info);
+    exportProfile(filePath);
+    checkClosure(filePath);
     cout << "MCgrid: Export Complete"<<endl;
   }
 
   void _grid_appl::scale(double const & scale)
   {
     _grid::scale(scale);
-    applgrid->run() = 1.0/scale;
+    if (isWarmup())
+      return;
+    traceSpan span("normalisation", "normalise", recordName());
+    flushFillBuffers();
+    applgrid->run() = 1.0/(scale*resumedNormalisation());
     applgrid->setNormalised(false);
   }
 
-  void _grid_appl::fillUnderlyingGrid(const double x1,
+  void _grid_appl::fillUnderlyingGrid(subprocessWeights const& weights,
+                                      const double x1,
                                       const double x2,
                                       const double pdfQ2,
                                       const double coord,
@@ -137,7 +338,14 @@ namespace MCgrid
     } else {
       gridIndex = perturbativeOrderForTermType(type);
     }
-    applgrid->fill_grid(x1, x2, pdfQ2, coord, weights, gridIndex);
+    applFillSlot *fills = localFillSlot();
+    if (fills == NULL) {
+      applgrid->fill_grid(x1, x2, pdfQ2, coord, weights.data(), gridIndex);
+      return;
+    }
+    fills->buffer.add(x1, x2, pdfQ2, coord, weights.data(), nSubProc, gridIndex);
+    if (fills->buffer.isFull())
+      spillFillBuffer(*fills);
   }
 
   std::string _grid_appl::phasespaceFileExtension() const
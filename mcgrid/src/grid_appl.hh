@@ -6,18 +6,90 @@
 #ifndef MCgrid_grid_appl_h
 #define MCgrid_grid_appl_h
 
+#include <vector>
+#include <mutex>
+
 #include "grid.hh"
+#include "threading.hh"
 
 namespace appl{ class grid; }
 
 namespace MCgrid {
 
+/**
+ * MCgrid::applFillBuffer collects a bounded number of fills of one fill
+ * thread, which are then added to an APPLgrid in the order they were made.
+ **/
+class applFillBuffer
+{
+public:
+  struct fill
+  {
+    double x1, x2, pdfQ2, coord;
+    int gridIndex;
+  };
+
+  // Number of grid fills buffered before they are added to a grid
+  static const size_t capacity = 1024;
+
+  applFillBuffer() {};
+
+  bool isFull() const { return fills.size() >= capacity; };
+
+  void add(const double x1, const double x2, const double pdfQ2, const double coord,
+           const double* weights, const int nSubProc, const int gridIndex)
+  {
+    fill f = {x1, x2, pdfQ2, coord, gridIndex};
+    fills.push_back(f);
+    subprocWeights.insert(subprocWeights.end(), weights, weights + nSubProc);
+  };
+
+  void addReference(const double coord, const double wgt)
+  {
+    referenceFills.push_back(std::make_pair(coord, wgt));
+  };
+
+  // Fill the buffered fills into a grid, keeping the buffer
+  void fillInto(appl::grid&, const int nSubProc) const;
+
+  // Keeps the capacity, such that the buffer is reused
+  void clear()
+  {
+    fills.clear();
+    subprocWeights.clear();
+    referenceFills.clear();
+  };
+
+private:
+  std::vector<fill> fills;
+  std::vector<double> subprocWeights;   //!< nSubProc weights per fill
+  std::vector< std::pair<double, double> > referenceFills;
+};
+
+/**
+ * MCgrid::applFillSlot holds the fills of a fill thread other than the one
+ * of slot 0. They are buffered first, and once the buffer is full they are
+ * added to a replica of the grid owned by the thread, such that threads
+ * with only a few fills do not hold a full grid. The replicas and buffers
+ * are added to the grid in slot order when the grid is scaled or exported,
+ * which makes the result independent of the thread scheduling.
+ **/
+struct applFillSlot
+{
+  applFillSlot(): replica(NULL) {};
+  ~applFillSlot();
+
+  applFillBuffer buffer;
+  appl::grid* replica;   //!< Grid of the thread, NULL until the buffer first runs full
+};
+
 class _grid_appl : public _grid {
 public:
   // Create a new APPLgrid-backed grid based upon a YODA histogram
   _grid_appl(const Rivet::Histo1DPtr,
              const std::string _analysis,
-             applGridConfig);
+             applGridConfig,
+             const Rivet::Histo2DPtr = Rivet::Histo2DPtr());
 
   ~_grid_appl();
 
@@ -25,9 +97,10 @@ private:
   std::string gridInterfaceName() const;
   void fillReferenceHistogram(double coord, double wgt);
   bool isWarmup() const;
-  void exportgrid();
+  void exportUnderlyingGrid();
   void scale(double const & scale);
-  void fillUnderlyingGrid(const double x1,
+  void fillUnderlyingGrid(subprocessWeights const&,
+                          const double x1,
                           const double x2,
                           const double pdfQ2,
                           const double coord,
@@ -35,7 +108,34 @@ private:
   std::string phasespaceFileExtension() const;
   std::string gridFileExtension() const;
 
-  appl::grid *applgrid;
+  // The grid and the buffered fills are checkpointed, see checkpointer
+  bool isCheckpointable() const { return true; };
+  checkpointSnapshot* snapshotUnderlyingGrid() const;
+  void resumeUnderlyingGrid(std::string const& path);
+
+  // Create an empty grid for the configured binning, either from the phase
+  // space grid or from scratch
+  appl::grid* newUnderlyingGrid() const;
+
+  // The fills of the calling thread, or NULL for slot 0, which fills the
+  // grid directly
+  applFillSlot* localFillSlot();
+
+  // Add the buffered fills of a slot to its replica, creating the replica
+  // on first use, and clear the buffer
+  void spillFillBuffer(applFillSlot&);
+
+  // Add the replicas and buffered fills of all fill threads to the grid,
+  // in slot order
+  void flushFillBuffers();
+
+  // Write a phase space grid for the merged extents of parallel warmup runs
+  void materialisePhasespace(phasespaceExtent const&);
+
+  const applGridConfig config;  //!< Configuration used to create the grid
+  bool warmupRun;               //!< Whether there was no phase space grid on construction
+  appl::grid *applgrid;         //!< Grid filled by slot 0 and exported (NULL in a warmup run)
+  perThread<applFillSlot> fillSlots; //!< Fills of the fill threads other than slot 0
 };
 
 }
@@ -7,10 +7,17 @@
 
 #if FASTNLO_ENABLED
 
+#include <cstdio>
+#include <sstream>
+#include <unistd.h>
+
 #include "fastnlotk/fastNLOCreate.h"
 #include "fastnlotk/read_steer.h"
 
 #include "grid_fnlo.hh"
+#include "runInfo.hh"
+#include "trace.hh"
+#include "exportQueue.hh"
 
 using Rivet::cerr;
 using Rivet::cout;
@@ -18,35 +25,52 @@ using Rivet::endl;
 
 namespace MCgrid {
 
-  std::string _grid_fnlo::gridInterfaceName() const
-  {
-    return _grid::gridInterfaceName(fastnloInterface);
-  }
-  _grid_fnlo::_grid_fnlo(const Rivet::Histo1DPtr histPtr,
-                         const std::string _analysis,
-                         fastnloConfig config):
-    _grid(histPtr, _analysis, config.lo)
+  // Read the steering file of a fastNLO config into the given namespace,
+  // together with the values MCgrid sets for each grid
+  void readFastNLOSteering(fastnloConfig const& config,
+                           std::string const& steeringNameSpace,
+                           const Rivet::Histo1DPtr histo,
+                           const Rivet::Histo2DPtr histo2D,
+                           std::string const& analysis,
+                           std::string const& histoName,
+                           std::string const& outputFileName)
   {
-    // For fastNLO-based grids, we need to create the grid before the pdf,
-    // as it is using fastNLOCreate instance methods, for example to retrieve
-    // the number of subprocesses.
-
-    // Inform the user what we're up to
-    cout << "MCgrid: Use fastNLO as underlying grid implementation" << endl;
-
     const std::string str = config.subprocConfig.fileName;
-    const std::string steeringNameSpace = phasespaceFilePath();
 
     // Values passed here will overwrite a possible value in the steering
-    ADD_NS("DifferentialDimension", 1, steeringNameSpace);
-    std::vector<int> dimensionIsDifferential(1, 2);
-    ADDARRAY_NS("DimensionIsDifferential", dimensionIsDifferential, steeringNameSpace);
+    if (histo2D) {
+      // One row of lower and upper edges in both observables per cell, in
+      // the order of the cells of the grid histogram
+      ADD_NS("DifferentialDimension", 2, steeringNameSpace);
+      std::vector<int> dimensionIsDifferential(2, 2);
+      ADDARRAY_NS("DimensionIsDifferential", dimensionIsDifferential, steeringNameSpace);
+      std::vector<std::string> header;
+      header.push_back("dim0Lo");
+      header.push_back("dim0Up");
+      header.push_back("dim1Lo");
+      header.push_back("dim1Up");
+      std::vector<std::vector<double> > binning;
+      const std::vector<size_t> cells = getCellOrder(histo2D);
+      for (size_t i=0; i<cells.size(); i++) {
+        std::vector<double> row;
+        row.push_back(histo2D.get()->bin(cells[i]).xMin());
+        row.push_back(histo2D.get()->bin(cells[i]).xMax());
+        row.push_back(histo2D.get()->bin(cells[i]).yMin());
+        row.push_back(histo2D.get()->bin(cells[i]).yMax());
+        binning.push_back(row);
+      }
+      ADDTABLE_NS("DoubleDifferentialBinning", header, binning, steeringNameSpace);
+    } else {
+      ADD_NS("DifferentialDimension", 1, steeringNameSpace);
+      std::vector<int> dimensionIsDifferential(1, 2);
+      ADDARRAY_NS("DimensionIsDifferential", dimensionIsDifferential, steeringNameSpace);
+      ADDARRAY_NS("SingleDifferentialBinning", getBinning(histo), steeringNameSpace);
+    }
     ADD_NS("CalculateBinSize", true, steeringNameSpace);
     ADD_NS("BinSizeFactor", 1.0, steeringNameSpace);
-    ADDARRAY_NS("SingleDifferentialBinning", getBinning(histo), steeringNameSpace);
     ADD_NS("LeadingOrder", config.lo, steeringNameSpace);
-    ADD_NS("OutputFilename", gridFileName(0), steeringNameSpace);
-    ADD_NS("FlexibleScaleTable", false, steeringNameSpace);
+    ADD_NS("OutputFilename", outputFileName, steeringNameSpace);
+    ADD_NS("FlexibleScaleTable", config.shouldUseScaleLogGrids, steeringNameSpace);
     ADD_NS("ReadBinningFromSteering", true, steeringNameSpace);
     ADD_NS("NPDF", 2, steeringNameSpace);
     ADD_NS("NPDFDim", 2, steeringNameSpace);
@@ -61,6 +85,11 @@ namespace MCgrid {
       ADD_NS("X_NNodes", config.arch.nX, steeringNameSpace);
       ADD_NS("Mu1_NNodes", config.arch.nQ, steeringNameSpace);
       ADD_NS("X_NoOfNodesPerMagnitude", config.arch.nXPerMagnitude, steeringNameSpace);
+      if (config.shouldUseScaleLogGrids) {
+        ADD_NS("Mu2_Kernel", config.arch.qkernel, steeringNameSpace);
+        ADD_NS("Mu2_DistanceMeasure", config.arch.qdistanceMeasure, steeringNameSpace);
+        ADD_NS("Mu2_NNodes", config.arch.nQ, steeringNameSpace);
+      }
     }
     std::vector<double> description(1, 1.0);
     ADDARRAY_NS("ScaleVariationFactors", description, steeringNameSpace);
@@ -92,13 +121,13 @@ namespace MCgrid {
 
     // Set ScenarioName default
     if (!EXIST_NS(ScenarioName, str)) {
-      ADD_NS("ScenarioName", path, steeringNameSpace);
+      ADD_NS("ScenarioName", histoName, steeringNameSpace);
     }
 
     // Set ScenarioDescription.RIVET_ID default
     if (!CONTAINKEYARRAY_NS(RIVET_ID, ScenarioDescription, steeringNameSpace)) {
       // Generate Rivet ID skipping the leading slash '/'
-      std::string rivetID("RIVET_ID=" + analysis.substr(1) + "/" + path);
+      std::string rivetID("RIVET_ID=" + analysis.substr(1) + "/" + histoName);
       if (EXISTARRAY_NS(ScenarioDescription, steeringNameSpace)) {
         PUSHBACKARRAY_NS(rivetID, ScenarioDescription, steeringNameSpace);
       } else {
@@ -107,13 +136,19 @@ namespace MCgrid {
       }
     }
 
-    if (mode == FILL_SHERPA) {
+    if (globalFillMode == FILL_SHERPA) {
       if (!EXISTARRAY_NS(CodeDescription, steeringNameSpace)) {
         std::vector<std::string> description(1, "Sherpa");
         ADDARRAY_NS("CodeDescription", description, steeringNameSpace);
       }
     }
 
+    // Both scales of a flexible-scale table are the scale of the fill
+    if (config.shouldUseScaleLogGrids && !EXIST_NS(ScaleDescriptionScale2, steeringNameSpace)
+        && EXIST_NS(ScaleDescriptionScale1, steeringNameSpace)) {
+      ADD_NS("ScaleDescriptionScale2", STRING_NS(ScaleDescriptionScale1, steeringNameSpace), steeringNameSpace);
+    }
+
     // Set OutputPrecision default
     if (!EXIST_NS(OutputPrecision, steeringNameSpace)) {
       ADD_NS("OutputPrecision", 8, steeringNameSpace);
@@ -133,21 +168,87 @@ namespace MCgrid {
     if (!EXIST_NS(CheckScaleLimitsAgainstBins, steeringNameSpace)) {
       ADD_NS("CheckScaleLimitsAgainstBins", true, steeringNameSpace);
     }
+  }
+
+  void bookFastNLOSubprocessPDF(fastnloConfig const& config,
+                                const Rivet::Histo1DPtr histo,
+                                std::string const& analysis)
+  {
+    const std::string str = config.subprocConfig.fileName;
+    if (PDFHandler::IsBooked(str))
+      return;
+
+    const std::string steeringNameSpace = "MCgrid subprocesses " + str;
+    const std::string histoName = histo.get()->path().substr(histo.get()->path().find_last_of('/') + 1);
+    readFastNLOSteering(config, steeringNameSpace, histo, Rivet::Histo2DPtr(), analysis, histoName, histoName + ".tab");
+    fastNLOCreate* subprocessTable = new fastNLOCreate(str, steeringNameSpace, false);
+    mcgrid_fnlo_pdf_params pdf_params(str, subprocessTable, true);
+    PDFHandler::BookPDF(pdf_params, analysis);
+  }
 
-    ftableBase = new fastNLOCreate(str,
-                                   steeringNameSpace,
-                                   false);
-    ftableBase->SetOrderOfAlphasOfCalculation(config.lo);
+  std::string _grid_fnlo::gridInterfaceName() const
+  {
+    return _grid::gridInterfaceName(fastnloInterface);
+  }
+  _grid_fnlo::_grid_fnlo(const Rivet::Histo1DPtr histPtr,
+                         const std::string _analysis,
+                         fastnloConfig config,
+                         const Rivet::Histo2DPtr histo2DPtr):
+    _grid(histPtr, _analysis, config.lo, config.shouldUseScaleLogGrids, 1/(2.0*M_PI), histo2DPtr),
+    steeringFile(config.subprocConfig.fileName)
+  {
+    // For fastNLO-based grids, we need to create the grid before the pdf,
+    // as it is using fastNLOCreate instance methods, for example to retrieve
+    // the number of subprocesses.
+
+    // Inform the user what we're up to
+    cout << "MCgrid: Use fastNLO as underlying grid implementation" << endl;
+    if (isUsingScaleLogGrids)
+      cout << "MCgrid: Enabling flexible-scale fastNLO tables for the scale logarithms" << endl;
+
+    const std::string str = config.subprocConfig.fileName;
+    const std::string steeringNameSpace = phasespaceFilePath();
+    {
+      traceSpan span("phasespace", "read steering", recordName());
+      readFastNLOSteering(config, steeringNameSpace, histo, histo2D, analysis, path, gridFileName(0));
+    }
+
+    // The warmup values of merged parallel warmup runs. A warmup table is
+    // written to the path of its steering namespace, so it is created in a
+    // temporary namespace and then renamed, such that concurrently starting
+    // runs never read an incomplete warmup table
+    phasespaceExtent extent;
+    if (readMergedPhasespaceExtent(extent)) {
+      cout << "MCgrid: Creating warmup table from merged warmup runs" << endl;
+      traceSpan span("phasespace", "create warmup table", recordName());
+      std::stringstream temporaryPath;
+      temporaryPath << phasespaceFilePath() << ".tmp." << getpid() << "." << phasespaceFileExtension();
+      readFastNLOSteering(config, temporaryPath.str(), histo, histo2D, analysis, path, gridFileName(0));
+      fastNLOCreate warmupTable(str, temporaryPath.str(), false);
+      warmupTable.SetOrderOfAlphasOfCalculation(config.lo);
+      fillPhasespaceCorners(warmupTable, extent);
+
+      uint64_t nEntries(0);
+      for (size_t i(0); i < extent.numberOfBins(); i++)
+        nEntries += extent.bin(i).nEntries;
+      warmupTable.SetNumberOfEvents(nEntries);
+      warmupTable.WriteTable();
+      if (std::rename(temporaryPath.str().c_str(), phasespaceFilePath().c_str()) != 0) {
+        cerr << "MCgrid::Error - Unable to move the warmup table " << temporaryPath.str();
+        cerr << " to " << phasespaceFilePath() << "." << endl;
+        stopOnError("unable to move the warmup table");
+      }
+    }
+
+    traceSpan span("phasespace", "read warmup table", recordName());
+    ftableBase = newTable(0);
     if (ftableBase->GetIsWarmup()) {
       ftableNLO = NULL;
     } else {
       // This is no warmup run, prepare to fill NLO events
       // As it is initialized from the same steering,
       // the NLO grid will use the same warmup values than the LO grid
-      ftableNLO = new fastNLOCreate(str,
-                                    steeringNameSpace,
-                                    false);
-      ftableNLO->SetOrderOfAlphasOfCalculation(config.lo + 1);
+      ftableNLO = newTable(1);
     }
 
     mcgrid_base_pdf_params *pdf_params = new mcgrid_fnlo_pdf_params(config.subprocConfig.fileName,
@@ -155,9 +256,163 @@ namespace MCgrid {
 
     readPDFWithParameters(*pdf_params, analysis);
     delete pdf_params;
+
+    // A warmup run only records the phase space extent, which is filled into
+    // the warmup table on export
+    isRecordingExtent = isWarmup();
+    registerCheckpoint();
+  }
+
+  // The observables of a 2D grid are the centre of the cell, as its bins
+  // are those of the double-differential table
+  void _grid_fnlo::setObservables(fastNLOCreate& table, const double coord)
+  {
+    if (!histo2D) {
+      table.fScenario.SetObservable0(coord);
+      return;
+    }
+    YODA::HistoBin2D const& bin = cellBin(coord);
+    table.fScenario.SetObservable0(bin.xMid());
+    table.fScenario.SetObservable1(bin.yMid());
+  }
+
+  void _grid_fnlo::setScales(fastNLOCreate& table, const double pdfQ2)
+  {
+    table.fScenario.SetObsScale1(sqrt(pdfQ2));
+    if (isUsingScaleLogGrids)
+      table.fScenario.SetObsScale2(sqrt(pdfQ2));
+  }
+
+  // Fill the corner points of each bin into a warmup table, which then
+  // writes the warmup values for the following runs. Only the combination
+  // (x1, x2, Q2) is relevant for the warmup, so filling one subproc is enough
+  void _grid_fnlo::fillPhasespaceCorners(fastNLOCreate& warmupTable,
+                                         phasespaceExtent const& extent)
+  {
+    for (size_t i(0); i < extent.numberOfBins() && i < histo.get()->numBins(); i++) {
+      const double coord = histo.get()->bin(i).xMid();
+      const std::vector<phasespaceExtent::cornerPoint> corners = extent.cornerPoints(i);
+      for (size_t j(0); j < corners.size(); j++) {
+        warmupTable.fEvent.SetProcessId(0);
+        warmupTable.fEvent.SetWeight(1.0);
+        warmupTable.fEvent.SetX1(corners[j].x1);
+        warmupTable.fEvent.SetX2(corners[j].x2);
+        setObservables(warmupTable, coord);
+        setScales(warmupTable, corners[j].q2);
+        warmupTable.Fill(0);
+        warmupTable.fEvent.Reset();
+      }
+    }
+  }
+
+  fastNLOCreate* _grid_fnlo::newTable(const int order) const
+  {
+    fastNLOCreate* table = new fastNLOCreate(steeringFile, phasespaceFilePath(), false);
+    table->SetOrderOfAlphasOfCalculation(leadingOrder + order);
+    return table;
+  }
+
+  fnloFillSlot::~fnloFillSlot()
+  {
+    delete base;
+    delete nlo;
+  }
+
+  // Each fill thread fills its own tables, as the event and scenario of a
+  // fastNLOCreate table are shared state. The tables of a thread are read
+  // from the steering of the grid when it first fills
+  fastNLOCreate* _grid_fnlo::localTable(const int order)
+  {
+    if (fillThreadSlot() == 0)
+      return (order == 0) ? ftableBase : ftableNLO;
+
+    fnloFillSlot& fills = fillSlots.local();
+    if (fills.base == NULL) {
+      std::lock_guard<std::mutex> lock(gridBookingMutex());
+      fills.base = newTable(0);
+      fills.nlo = newTable(1);
+    }
+    return (order == 0) ? fills.base : fills.nlo;
+  }
+
+  // The contributions of the tables of a slot are the same as those of the
+  // exported tables, so AddTable sums their coefficients. The event counts
+  // are set on export
+  void _grid_fnlo::mergeFillSlots()
+  {
+    traceSpan span("export", "merge fill thread tables", recordName());
+    for (int slot=1; slot<maxFillThreads; slot++) {
+      fnloFillSlot *fills = fillSlots.release(slot);
+      if (fills == NULL)
+        continue;
+      if (fills->base != NULL) {
+        ftableBase->AddTable(*fills->base);
+        ftableNLO->AddTable(*fills->nlo);
+      }
+      delete fills;
+    }
+  }
+
+  namespace {
+    // Owns a merged copy of the tables, which is written by the checkpoint writer
+    class fnloSnapshot: public checkpointSnapshot
+    {
+    public:
+      fnloSnapshot(fastNLOTable* _table): table(_table) {};
+      ~fnloSnapshot() { delete table; }
+
+      void write(std::string const& path) const
+      {
+        table->SetFilename(path);
+        table->WriteTable();
+      }
+
+    private:
+      fastNLOTable* const table;
+    };
+  }
+
+  // The tables of all slots are added to a copy in the same order as on
+  // export, such that the fill threads keep them. The LO and NLO
+  // contributions are written into one table, as on export
+  checkpointSnapshot* _grid_fnlo::snapshotUnderlyingGrid() const
+  {
+    fastNLOTable *snapshot = new fastNLOTable(static_cast<fastNLOTable const&>(*ftableBase));
+    snapshot->AddTable(static_cast<fastNLOTable const&>(*ftableNLO));
+    for (int slot=1; slot<maxFillThreads; slot++) {
+      fnloFillSlot *fills = fillSlots.get(slot);
+      if (fills == NULL || fills->base == NULL)
+        continue;
+      snapshot->AddTable(*fills->base);
+      snapshot->AddTable(*fills->nlo);
+    }
+    return new fnloSnapshot(snapshot);
+  }
+
+  // Each contribution of the checkpoint is added to the table of its order.
+  // Their event counts are replaced by the number of events of the run on
+  // export, which includes the events before the resumption
+  void _grid_fnlo::resumeUnderlyingGrid(std::string const& path)
+  {
+    fastNLOTable checkpoint(path);
+    for (int i(0); i < checkpoint.GetNcontrib(); i++) {
+      fastNLOCoeffAddBase *contribution = dynamic_cast<fastNLOCoeffAddBase*>(checkpoint.GetCoeffTable(i));
+      if (contribution == NULL)
+        continue;
+      if (contribution->GetNpow() == ftableBase->GetTheCoeffTable()->GetNpow()) {
+        ftableBase->GetTheCoeffTable()->Add(*contribution);
+      } else if (contribution->GetNpow() == ftableNLO->GetTheCoeffTable()->GetNpow()) {
+        ftableNLO->GetTheCoeffTable()->Add(*contribution);
+      } else {
+        cerr << "MCgrid::Error - The checkpointed table " << path << " has a contribution of order ";
+        cerr << contribution->GetNpow() << ", which " << recordName() << " does not fill." << endl;
+        exit(-1);
+      }
+    }
   }
 
   _grid_fnlo::~_grid_fnlo() {
+    waitForQueuedExport();
     delete ftableBase;
     if (ftableNLO != NULL) {
       delete ftableNLO;
@@ -173,8 +428,9 @@ namespace MCgrid {
     return ftableBase->GetIsWarmup();
   }
 
-  void _grid_fnlo::exportgrid()
+  void _grid_fnlo::exportUnderlyingGrid()
   {
+    traceSpan span("export", "export grid", recordName());
     if (isWarmup()) {
       cout << "MCgrid: Writing out phase space grid." << endl;
     } else {
@@ -183,21 +439,41 @@ namespace MCgrid {
     }
 
     const uint64_t nEvents(PDFHandler::NEvents());
-    ftableBase->SetNumberOfEvents(nEvents);
     if (isWarmup()) {
+      ftableBase->SetNumberOfEvents(nEvents);
+      const phasespaceExtent extent = recordedPhasespaceExtent();
+      extent.write(phasespaceExtent::filePath(phasespaceFilePath()));
+      fillPhasespaceCorners(*ftableBase, extent);
+      traceSpan writeSpan("write", "write warmup table", recordName());
       ftableBase->WriteTable();
+      exportProfile(phasespaceFilePath());
     } else {
+      mergeFillSlots();
+      ftableBase->SetNumberOfEvents(nEvents);
       ftableNLO->SetNumberOfEvents(nEvents);
       scaleTables(nEvents);
 
       // fastNLOCreate objects cannot contain more than one contribution.
       // Its superclass however can handle this. So let's upcast.
       fastNLOTable *ftable = static_cast<fastNLOTable*>(ftableBase);
-      ftable->AddTable(static_cast<fastNLOTable>(*ftableNLO));
+      {
+        traceSpan addSpan("export", "add tables", recordName());
+        ftable->AddTable(static_cast<fastNLOTable>(*ftableNLO));
+      }
 
       // Determine file name and write
-      ftable->SetFilename(gridOrPhasespaceFilePath());
-      ftable->WriteTable();
+      const std::string filePath(gridOrPhasespaceFilePath());
+      ftable->SetFilename(filePath);
+      {
+        traceSpan writeSpan("write", "write table", recordName());
+        ftable->WriteTable();
+      }
+
+      runInfo info;
+      info.nEvents = nEvents;
+      exportRunInfo(filePath, info);
+      exportProfile(filePath);
+      checkClosure(filePath);
     }
 
     cout << "MCgrid: Export Complete"<<endl;
@@ -207,50 +483,80 @@ namespace MCgrid {
   {
     _grid::scale(scale);
     if (!isWarmup()) {
-      scaleTables(scale);
+      mergeFillSlots();
+      scaleTables(scale*resumedNormalisation());
     }
   }
 
   void _grid_fnlo::scaleTables(double const & scale)
   {
     if (scale != 1.0) {
+      traceSpan span("normalisation", "normalise", recordName());
       ftableBase->MultiplyCoefficientsByConstant(scale);
       ftableNLO->MultiplyCoefficientsByConstant(scale);
     }
   }
 
-  void _grid_fnlo::fillUnderlyingGrid(const double x1,
+  void _grid_fnlo::fillUnderlyingGrid(subprocessWeights const& weights,
+                                      const double x1,
                                       const double x2,
                                       const double pdfQ2,
                                       const double coord,
                                       const termType termType)
   {
-    // we do not yet support scale log tables in fastNLO
-    assert(termType == LO || termType == NLO);
+    // The scale logs are only filled into flexible-scale tables
+    assert(isUsingScaleLogGrids || termType == LO || termType == NLO);
+
+    // Warmup runs do not fill the table, see fillPhasespaceCorners
+    assert(!isWarmup());
 
     // Determine which table should be filled
-    fastNLOCreate *ftable;
-    if (isWarmup() || !(perturbativeOrderForTermType(termType) == 1)) {
-      ftable = ftableBase;
-    } else {
-      ftable = ftableNLO;
-    }
+    fastNLOCreate *ftable = localTable(perturbativeOrderForTermType(termType));
+
+    // Only the subprocesses that received a weight need to be filled
+    std::vector<int> const& touched = weights.touchedSubprocesses();
+    for (size_t i(0); i < touched.size(); i++)
+      fillSubprocess(ftable, weights, touched[i], x1, x2, pdfQ2, coord, termType);
+  }
 
-    // Fill table
-    // For warmup runs, only the combination (x1, x2, Q2)
-    // is relevant to update the ranges of the grid dimensions.
-    // So filling one subproc is enough
-    const int nSubProcToBeFilled = isWarmup() ? 1 : nSubProc;
-    for (int i=0; i<nSubProcToBeFilled; i++) {
-      ftable->fEvent.SetProcessId(i);
-      ftable->fEvent.SetWeight(weights[i]/x1/x2);
-      ftable->fEvent.SetX1(x1);
-      ftable->fEvent.SetX2(x2);
-      ftable->fScenario.SetObservable0(coord);
-      ftable->fScenario.SetObsScale1(sqrt(pdfQ2));
-      ftable->Fill(0);
-      ftable->fEvent.Reset();
+  void _grid_fnlo::fillSubprocess(fastNLOCreate *ftable,
+                                  subprocessWeights const& weights,
+                                  const int subproc,
+                                  const double x1,
+                                  const double x2,
+                                  const double pdfQ2,
+                                  const double coord,
+                                  const termType termType)
+  {
+    const double weight = weights[subproc]/x1/x2;
+    ftable->fEvent.SetProcessId(subproc);
+    if (!isUsingScaleLogGrids) {
+      ftable->fEvent.SetWeight(weight);
+    } else {
+      // The scale log weights are coefficients of log(mu^2/Q^2), with Q^2
+      // the scale of the fill. Flexible-scale tables store the coefficients
+      // of log(mu^2) instead, the remainder is scale independent
+      switch (termType) {
+        case LO:
+        case NLO:
+          ftable->fEvent.SetWeight_MuIndependent(weight);
+          break;
+        case RenormalisationSingleLog:
+          ftable->fEvent.SetWeight_MuIndependent(-weight*log(pdfQ2));
+          ftable->fEvent.SetWeight_log_mur(weight);
+          break;
+        case FactorisationSingleLog:
+          ftable->fEvent.SetWeight_MuIndependent(-weight*log(pdfQ2));
+          ftable->fEvent.SetWeight_log_muf(weight);
+          break;
+      }
     }
+    ftable->fEvent.SetX1(x1);
+    ftable->fEvent.SetX2(x2);
+    setObservables(*ftable, coord);
+    setScales(*ftable, pdfQ2);
+    ftable->Fill(0);
+    ftable->fEvent.Reset();
   }
 
   std::string _grid_fnlo::phasespaceFileExtension() const
@@ -7,35 +7,97 @@
 #define MCgrid_grid_fnlo_h
 
 #include "grid.hh"
+#include "threading.hh"
 
 class fastNLOCreate;
 
 namespace MCgrid {
 
+// Read the steering file of a fastNLO config into the given namespace,
+// together with the values MCgrid sets for each grid
+void readFastNLOSteering(fastnloConfig const& config,
+                         std::string const& steeringNameSpace,
+                         const Rivet::Histo1DPtr histo,
+                         const Rivet::Histo2DPtr histo2D,
+                         std::string const& analysis,
+                         std::string const& histoName,
+                         std::string const& outputFileName);
+
+// Book the subprocess PDF of a fastNLO config, if it has not been booked
+// yet. The PDF owns the fastNLOCreate instance reading the subprocesses
+void bookFastNLOSubprocessPDF(fastnloConfig const& config,
+                              const Rivet::Histo1DPtr histo,
+                              std::string const& analysis);
+
+/**
+ * MCgrid::fnloFillSlot holds the tables filled by a fill thread other than
+ * the one of slot 0, created on its first fill. The tables of all slots are
+ * added to the exported tables in slot order when the grid is scaled or
+ * exported.
+ **/
+struct fnloFillSlot
+{
+  fnloFillSlot(): base(NULL), nlo(NULL) {};
+  ~fnloFillSlot();
+
+  fastNLOCreate* base;
+  fastNLOCreate* nlo;
+};
+
 class _grid_fnlo : public _grid {
 public:
   _grid_fnlo(const Rivet::Histo1DPtr histPtr,
              const std::string analysis,
-             fastnloConfig config);
+             fastnloConfig config,
+             const Rivet::Histo2DPtr histo2DPtr = Rivet::Histo2DPtr());
   ~_grid_fnlo();
 
 private:
   std::string gridInterfaceName() const;
   void fillReferenceHistogram(double coord, double wgt);
   bool isWarmup() const;
-  void exportgrid();
+  void exportUnderlyingGrid();
   void scale(double const & scale);           //!< Do nothing in a warmup run
   void scaleTables(double const & scale);     //!< Scale LO and NLO contributions
-  void fillUnderlyingGrid(const double x1,
+  void fillUnderlyingGrid(subprocessWeights const&,
+                          const double x1,
                           const double x2,
                           const double pdfQ2,
                           const double coord,
                           const termType termType);
+  void fillSubprocess(fastNLOCreate *ftable,
+                      subprocessWeights const&,
+                      const int subproc,
+                      const double x1,
+                      const double x2,
+                      const double pdfQ2,
+                      const double coord,
+                      const termType termType);
+  void setObservables(fastNLOCreate& table, const double coord);  //!< Observables of a coordinate of the grid histogram
+  void setScales(fastNLOCreate& table, const double pdfQ2);       //!< Both scales of a flexible-scale table
+  void fillPhasespaceCorners(fastNLOCreate& warmupTable,
+                             phasespaceExtent const&);
   std::string phasespaceFileExtension() const;
   std::string gridFileExtension() const;
 
-  fastNLOCreate* ftableBase;  //!< Pointer to fastNLO grid used for warmup or LO
-  fastNLOCreate* ftableNLO;   //!< Pointer to fastNLO grid used for NLO
+  // The tables are checkpointed, see checkpointer
+  bool isCheckpointable() const { return true; };
+  checkpointSnapshot* snapshotUnderlyingGrid() const;
+  void resumeUnderlyingGrid(std::string const& path);
+
+  // A table of the given order (0 is LO) read from the steering of the grid
+  fastNLOCreate* newTable(const int order) const;
+
+  // The tables filled by the calling thread
+  fastNLOCreate* localTable(const int order);
+
+  // Add the tables of all fill threads to the exported tables, in slot order
+  void mergeFillSlots();
+
+  const std::string steeringFile; //!< Steering file of the subprocesses and the tables
+  fastNLOCreate* ftableBase;  //!< Pointer to fastNLO grid used for warmup or LO, filled by slot 0
+  fastNLOCreate* ftableNLO;   //!< Pointer to fastNLO grid used for NLO, filled by slot 0
+  perThread<fnloFillSlot> fillSlots; //!< Tables of the fill threads other than slot 0
 };
 
 }
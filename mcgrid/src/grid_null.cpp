@@ -0,0 +1,284 @@
+//
+//  grid_null.cpp
+//  MCgrid 17/10/2026.
+//
+
+#include "config.h"
+
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <algorithm>
+
+#if FASTNLO_ENABLED
+#include "fastnlotk/fastNLOCreate.h"
+#include "grid_fnlo.hh"
+#endif
+
+#include "grid_null.hh"
+#include "trace.hh"
+
+using Rivet::cerr;
+using Rivet::cout;
+using Rivet::endl;
+
+namespace MCgrid {
+
+  // ************************ nullGridStatistics ****************************
+
+  const double nullGridStatistics::logXMin = -8.0;
+  const double nullGridStatistics::logQ2Max = 8.0;
+
+  // Bin of a value in a histogram with under- and overflow bins
+  static size_t occupancyBin(const double value, const double low, const double high, const int nBins)
+  {
+    if (!(value >= low))
+      return 0;
+    if (value >= high)
+      return nBins + 1;
+    return 1 + (size_t)((value - low)/(high - low)*nBins);
+  }
+
+  nullGridStatistics::nullGridStatistics(const size_t nObservableBins):
+    xMin(std::numeric_limits<double>::max()),
+    xMax(0.0),
+    q2Min(std::numeric_limits<double>::max()),
+    q2Max(0.0),
+    x1Occupancy(nLogBins + 2, 0),
+    x2Occupancy(nLogBins + 2, 0),
+    q2Occupancy(nLogBins + 2, 0),
+    observableOccupancy(nObservableBins + 2, 0)
+  {
+    for (int i(0); i < nTermTypes; i++) {
+      nFills[i] = 0;
+      nNonzeroWeights[i] = 0;
+      weightSum[i] = 0.0;
+      absWeightSum[i] = 0.0;
+    }
+  }
+
+  void nullGridStatistics::add(subprocessWeights const& weights,
+                               const double x1,
+                               const double x2,
+                               const double pdfQ2,
+                               const int observableBin,
+                               const int termType)
+  {
+    nFills[termType]++;
+    std::vector<int> const& touched = weights.touchedSubprocesses();
+    for (size_t i(0); i < touched.size(); i++) {
+      const double w = weights[touched[i]];
+      if (w != 0.0)
+        nNonzeroWeights[termType]++;
+      weightSum[termType] += w;
+      absWeightSum[termType] += std::fabs(w);
+    }
+
+    xMin = std::min(xMin, std::min(x1, x2));
+    xMax = std::max(xMax, std::max(x1, x2));
+    q2Min = std::min(q2Min, pdfQ2);
+    q2Max = std::max(q2Max, pdfQ2);
+
+    x1Occupancy[occupancyBin(std::log10(x1), logXMin, 0.0, nLogBins)]++;
+    x2Occupancy[occupancyBin(std::log10(x2), logXMin, 0.0, nLogBins)]++;
+    q2Occupancy[occupancyBin(std::log10(pdfQ2), 0.0, logQ2Max, nLogBins)]++;
+    observableOccupancy[observableBin + 1]++;
+  }
+
+  void nullGridStatistics::merge(nullGridStatistics const& other)
+  {
+    for (int i(0); i < nTermTypes; i++) {
+      nFills[i] += other.nFills[i];
+      nNonzeroWeights[i] += other.nNonzeroWeights[i];
+      weightSum[i] += other.weightSum[i];
+      absWeightSum[i] += other.absWeightSum[i];
+    }
+    xMin = std::min(xMin, other.xMin);
+    xMax = std::max(xMax, other.xMax);
+    q2Min = std::min(q2Min, other.q2Min);
+    q2Max = std::max(q2Max, other.q2Max);
+    for (size_t i(0); i < x1Occupancy.size(); i++) {
+      x1Occupancy[i] += other.x1Occupancy[i];
+      x2Occupancy[i] += other.x2Occupancy[i];
+      q2Occupancy[i] += other.q2Occupancy[i];
+    }
+    for (size_t i(0); i < observableOccupancy.size(); i++)
+      observableOccupancy[i] += other.observableOccupancy[i];
+  }
+
+  // ************************ _grid_null ************************************
+
+  std::string _grid_null::gridInterfaceName() const
+  {
+    return "null grid";
+  }
+
+#if APPLGRID_ENABLED
+  _grid_null::_grid_null(const Rivet::Histo1DPtr histPtr,
+                         const std::string _analysis,
+                         applGridConfig config,
+                         const Rivet::Histo2DPtr histo2DPtr):
+    _grid(histPtr, _analysis, config.lo, config.shouldUseScaleLogGrids, config.shouldUseScaleLogGrids ? 4*M_PI : 1/(2*M_PI), histo2DPtr),
+    subprocessTable(NULL),
+    normalisation(1.0)
+  {
+    // Inform the user what we're up to
+    cout << "MCgrid: Use the null backend instead of APPLgrid, fills are only recorded" << endl;
+
+    mcgrid_appl_pdf_params pdf_params(config.subprocConfig.fileName,
+                                      config.subprocConfig.beam1,
+                                      config.subprocConfig.beam2);
+    readPDFWithParameters(pdf_params, analysis);
+    registerCheckpoint();
+  }
+#endif
+
+#if FASTNLO_ENABLED
+  _grid_null::_grid_null(const Rivet::Histo1DPtr histPtr,
+                         const std::string _analysis,
+                         fastnloConfig config,
+                         const Rivet::Histo2DPtr histo2DPtr):
+    _grid(histPtr, _analysis, config.lo, config.shouldUseScaleLogGrids, 1/(2.0*M_PI), histo2DPtr),
+    normalisation(1.0)
+  {
+    // Inform the user what we're up to
+    cout << "MCgrid: Use the null backend instead of fastNLO, fills are only recorded" << endl;
+
+    // The subprocess definitions of fastNLO are only available through a
+    // fastNLOCreate instance, which is never filled
+    const std::string steeringNameSpace = phasespaceFilePath();
+    readFastNLOSteering(config, steeringNameSpace, histo, histo2D, analysis, path, gridFileName(0));
+    subprocessTable = new fastNLOCreate(config.subprocConfig.fileName,
+                                        steeringNameSpace,
+                                        false);
+
+    mcgrid_fnlo_pdf_params pdf_params(config.subprocConfig.fileName, subprocessTable);
+    readPDFWithParameters(pdf_params, analysis);
+    registerCheckpoint();
+  }
+#endif
+
+  _grid_null::~_grid_null()
+  {
+    waitForQueuedExport();
+#if FASTNLO_ENABLED
+    delete subprocessTable;
+#endif
+  }
+
+  void _grid_null::fillReferenceHistogram(double coord, double wgt)
+  {
+    // The null backend has no reference histogram
+  }
+
+  bool _grid_null::isWarmup() const
+  {
+    // There is no phase space to optimise
+    return false;
+  }
+
+  void _grid_null::fillUnderlyingGrid(subprocessWeights const& weights,
+                                      const double x1,
+                                      const double x2,
+                                      const double pdfQ2,
+                                      const double coord,
+                                      const termType termType)
+  {
+    const int slot = fillThreadSlot();
+    nullGridStatistics* statistics = threadStatistics.get(slot);
+    if (statistics == NULL) {
+      statistics = new nullGridStatistics(histo.get()->numBins());
+      threadStatistics.set(slot, statistics);
+    }
+
+    int observableBin = histo.get()->binIndexAt(coord);
+    if (observableBin < 0)
+      observableBin = (coord < histo.get()->bin(0).xMin()) ? -1 : histo.get()->numBins();
+    statistics->add(weights, x1, x2, pdfQ2, observableBin, termType);
+  }
+
+  nullGridStatistics _grid_null::mergedStatistics() const
+  {
+    nullGridStatistics statistics(histo.get()->numBins());
+    for (int slot=0; slot<maxFillThreads; slot++) {
+      nullGridStatistics* threadStatistic = threadStatistics.get(slot);
+      if (threadStatistic != NULL)
+        statistics.merge(*threadStatistic);
+    }
+    return statistics;
+  }
+
+  void _grid_null::scale(double const & scale)
+  {
+    _grid::scale(scale);
+    normalisation *= scale;
+  }
+
+  /*
+   *  The statistics are written as plain text, one quantity per line:
+   *    NEvents: <n>
+   *    Normalisation: <product of all scale factors>
+   *    TermType: <name> Fills: <n> NonzeroWeights: <n> WeightSum: <w> AbsWeightSum: <w>
+   *    Range: x <min> <max> Q2 <min> <max>
+   *    Histogram: <name> <nBins> <low> <high> <underflow> <bin contents> <overflow>
+   *  The observable histogram uses the binning of the Rivet histogram.
+   */
+  void _grid_null::exportUnderlyingGrid()
+  {
+    traceSpan span("export", "export grid", recordName());
+    cout << "MCgrid: Exporting fill statistics of the null backend." << endl;
+
+    const nullGridStatistics statistics = mergedStatistics();
+    const std::string filePath(gridOrPhasespaceFilePath());
+    std::ofstream file(filePath.c_str());
+    file.precision(10);
+
+    file << "NEvents: " << PDFHandler::NEvents() << endl;
+    file << "Normalisation: " << normalisation << endl;
+
+    const std::string termTypeNames[] = {"LO", "NLO", "RenormalisationSingleLog", "FactorisationSingleLog"};
+    for (int i(0); i < nullGridStatistics::nTermTypes; i++) {
+      file << "TermType: " << termTypeNames[i];
+      file << " Fills: " << statistics.nFills[i];
+      file << " NonzeroWeights: " << statistics.nNonzeroWeights[i];
+      file << " WeightSum: " << statistics.weightSum[i];
+      file << " AbsWeightSum: " << statistics.absWeightSum[i] << endl;
+    }
+
+    file << "Range: x " << statistics.xMin << " " << statistics.xMax;
+    file << " Q2 " << statistics.q2Min << " " << statistics.q2Max << endl;
+
+    const std::string histogramNames[] = {"log10(x1)", "log10(x2)", "log10(Q2)"};
+    const std::vector<uint64_t>* histograms[] = {&statistics.x1Occupancy, &statistics.x2Occupancy, &statistics.q2Occupancy};
+    for (int i(0); i < 3; i++) {
+      file << "Histogram: " << histogramNames[i] << " " << nullGridStatistics::nLogBins;
+      if (i < 2)
+        file << " " << nullGridStatistics::logXMin << " 0";
+      else
+        file << " 0 " << nullGridStatistics::logQ2Max;
+      for (size_t j(0); j < histograms[i]->size(); j++)
+        file << " " << (*histograms[i])[j];
+      file << endl;
+    }
+
+    const size_t nBins = histo.get()->numBins();
+    file << "Histogram: observable " << nBins << " " << histo.get()->bin(0).xMin();
+    file << " " << histo.get()->bin(nBins - 1).xMax();
+    for (size_t j(0); j < statistics.observableOccupancy.size(); j++)
+      file << " " << statistics.observableOccupancy[j];
+    file << endl;
+
+    exportProfile(filePath);
+    cout << "MCgrid: Export Complete"<<endl;
+  }
+
+  std::string _grid_null::phasespaceFileExtension() const
+  {
+    return "null";
+  }
+
+  std::string _grid_null::gridFileExtension() const
+  {
+    return "stats";
+  }
+}
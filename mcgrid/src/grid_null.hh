@@ -0,0 +1,101 @@
+//
+//  grid_null.hh
+//  MCgrid 17/10/2026.
+//
+
+#ifndef MCgrid_grid_null_h
+#define MCgrid_grid_null_h
+
+#include <vector>
+#include <stdint.h>
+
+#include "grid.hh"
+#include "threading.hh"
+
+class fastNLOCreate;
+
+namespace MCgrid {
+
+/**
+ * MCgrid::nullGridStatistics collects what the null backend is asked to
+ * fill: counters and weight sums per term type, and occupancy histograms of
+ * x, Q^2 and the observable bins
+ **/
+class nullGridStatistics
+{
+public:
+  nullGridStatistics(const size_t nObservableBins);
+
+  void add(subprocessWeights const&,
+           const double x1,
+           const double x2,
+           const double pdfQ2,
+           const int observableBin,
+           const int termType);
+  void merge(nullGridStatistics const&);
+
+  static const int nTermTypes = 4;
+  static const int nLogBins = 80;      //!< Bins of the log10(x) and log10(Q^2) histograms
+  static const double logXMin;         //!< Lower edge of the log10(x) histograms (upper is 0)
+  static const double logQ2Max;        //!< Upper edge of the log10(Q^2) histogram (lower is 0)
+
+  uint64_t nFills[nTermTypes];         //!< Calls of fillUnderlyingGrid
+  uint64_t nNonzeroWeights[nTermTypes];//!< Nonzero subprocess weights passed
+  double weightSum[nTermTypes];        //!< Sum of the subprocess weights
+  double absWeightSum[nTermTypes];     //!< Sum of the absolute subprocess weights
+
+  double xMin, xMax;                   //!< Range of x1 and x2
+  double q2Min, q2Max;                 //!< Range of Q^2
+
+  // Occupancy histograms, the first and last bins are the under- and overflow
+  std::vector<uint64_t> x1Occupancy;
+  std::vector<uint64_t> x2Occupancy;
+  std::vector<uint64_t> q2Occupancy;
+  std::vector<uint64_t> observableOccupancy;
+};
+
+class _grid_null : public _grid {
+public:
+  // Create a null grid that records the fills of an APPLgrid or fastNLO
+  // configuration instead of filling an interpolation grid
+#if APPLGRID_ENABLED
+  _grid_null(const Rivet::Histo1DPtr,
+             const std::string _analysis,
+             applGridConfig,
+             const Rivet::Histo2DPtr = Rivet::Histo2DPtr());
+#endif
+#if FASTNLO_ENABLED
+  _grid_null(const Rivet::Histo1DPtr,
+             const std::string _analysis,
+             fastnloConfig,
+             const Rivet::Histo2DPtr = Rivet::Histo2DPtr());
+#endif
+
+  ~_grid_null();
+
+private:
+  std::string gridInterfaceName() const;
+  void fillReferenceHistogram(double coord, double wgt);
+  bool isWarmup() const;
+  void exportUnderlyingGrid();
+  void scale(double const & scale);
+  void fillUnderlyingGrid(subprocessWeights const&,
+                          const double x1,
+                          const double x2,
+                          const double pdfQ2,
+                          const double coord,
+                          const termType termType);
+  std::string phasespaceFileExtension() const;
+  std::string gridFileExtension() const;
+
+  // The statistics of all fill threads
+  nullGridStatistics mergedStatistics() const;
+
+  fastNLOCreate* subprocessTable;   //!< Provides the subprocess definitions of a fastNLO config (or NULL)
+  double normalisation;             //!< Product of all scale factors
+  perThread<nullGridStatistics> threadStatistics; //!< Statistics of each fill thread
+};
+
+}
+
+#endif
@@ -0,0 +1,127 @@
+//
+//  kpProjection.cpp
+//  MCgrid 17/10/2026.
+//
+
+#include "kpProjection.hh"
+#include "subprocessWeights.hh"
+
+#include "mcgrid/mcgrid_pdf.hh"
+
+namespace MCgrid {
+
+  // Incoming flavours are projected in the LHA basis without top, i.e. -5 to 5
+  static const int maxFlavour = 5;
+  static const int nFlavours = 2*maxFlavour + 1;
+
+  kpProjectionTable::kpProjectionTable(mcgrid_base_pdf const& pdf, const int nActiveFlavors):
+  pdf(pdf),
+  nActiveFlavors(nActiveFlavors),
+  projections(nFlavours*nFlavours*nKPProjectors*nKPProjectors)
+  {
+    for (int fl1=-maxFlavour; fl1<=maxFlavour; fl1++)
+      for (int fl2=-maxFlavour; fl2<=maxFlavour; fl2++)
+        for (int p1=0; p1<nKPProjectors; p1++)
+          for (int p2=0; p2<nKPProjectors; p2++)
+            buildProjection(fl1, fl2, (kpProjector)p1, (kpProjector)p2,
+                            projections[projectionIndex(fl1, fl2, (kpProjector)p1, (kpProjector)p2)]);
+  }
+
+  void kpProjectionTable::project(const int fl1,
+                                  const int fl2,
+                                  const double w,
+                                  const kpProjector projector1,
+                                  const kpProjector projector2,
+                                  subprocessWeights &weights) const
+  {
+    // Flavours outside of the projection basis do not contribute
+    if (fl1 < -maxFlavour || fl1 > maxFlavour || fl2 < -maxFlavour || fl2 > maxFlavour)
+      return;
+
+    const projection& proj = projections[projectionIndex(fl1, fl2, projector1, projector2)];
+    if (!proj.isValid) {
+      // Let the subprocess PDF report the unclassified pair
+      pdf.LookupSubProcess(proj.invalidFl1, proj.invalidFl2);
+    }
+
+    for (size_t i(0); i < proj.contributions.size(); i++)
+      weights.add(proj.contributions[i].subproc, proj.contributions[i].coefficient * w);
+  }
+
+  void kpProjectionTable::buildProjection(const int fl1, const int fl2,
+                                          const kpProjector projector1,
+                                          const kpProjector projector2,
+                                          projection &proj) const
+  {
+    double proj1[nFlavours];
+    double proj2[nFlavours];
+    fillProjector(projector1, fl1, proj1);
+    fillProjector(projector2, fl2, proj2);
+
+    proj.isValid = true;
+    proj.invalidFl1 = 0;
+    proj.invalidFl2 = 0;
+
+    // Project onto beam partons and collect the multiplicity per subprocess
+    std::vector<double> coefficients(pdf.NumberOfSubprocesses(), 0.0);
+    for (int i=-maxFlavour; i<=maxFlavour; i++) {
+      if (!proj1[i+maxFlavour])
+        continue;
+      for (int j=-maxFlavour; j<=maxFlavour; j++) {
+        if (!proj2[j+maxFlavour])
+          continue;
+        if (!pdf.IsClassifiable(i, j)) {
+          if (proj.isValid) {
+            proj.isValid = false;
+            proj.invalidFl1 = i;
+            proj.invalidFl2 = j;
+          }
+          continue;
+        }
+        coefficients[pdf.LookupSubProcess(i, j).subproc] += proj1[i+maxFlavour]*proj2[j+maxFlavour];
+      }
+    }
+
+    for (size_t sub(0); sub < coefficients.size(); sub++) {
+      if (coefficients[sub] != 0.0) {
+        contribution c;
+        c.subproc = sub;
+        c.coefficient = coefficients[sub];
+        proj.contributions.push_back(c);
+      }
+    }
+  }
+
+  // Projection functions for collinear counterterms. These multiply each
+  // flavour contribution for the counterterms, proj is indexed by a+5
+  void kpProjectionTable::fillProjector(const kpProjector projector, const int a, double *proj) const
+  {
+    for (int i=-maxFlavour; i<=maxFlavour; i++) {
+      switch (projector) {
+        case identityProjector:
+          proj[i+maxFlavour] = ( (i==a) ? 1:0 );
+          break;
+        case quarkSumProjector:
+          if (a == 0) {
+            // Do not accidentally introduce initial state quarks that are inactive
+            proj[i+maxFlavour] = ( (i!=0 && i>=-nActiveFlavors && i<=nActiveFlavors) ? 1:0 );
+          } else {
+            proj[i+maxFlavour] = ( (i==a) ? 1:0 );
+          }
+          break;
+        default:
+          proj[i+maxFlavour] = ( (i==0) ? 1:0 );
+          break;
+      }
+    }
+  }
+
+  int kpProjectionTable::projectionIndex(const int fl1, const int fl2,
+                                         const kpProjector projector1,
+                                         const kpProjector projector2)
+  {
+    const int flavourIndex = (fl1+maxFlavour)*nFlavours + fl2+maxFlavour;
+    return (flavourIndex*nKPProjectors + projector1)*nKPProjectors + projector2;
+  }
+
+}
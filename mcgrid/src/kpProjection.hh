@@ -0,0 +1,79 @@
+//
+//  kpProjection.hh
+//  MCgrid 17/10/2026.
+//
+
+#ifndef mcgrid_kp_projection_hh
+#define mcgrid_kp_projection_hh
+
+#include <vector>
+
+namespace MCgrid {
+
+  class mcgrid_base_pdf;
+  class subprocessWeights;
+
+  // Beam projections for the collinear counterterms (cf. sherpaKPFill)
+  typedef enum kpProjector {
+    identityProjector,  //!< f_a(x_a)
+    quarkSumProjector,  //!< f_a^1 = f_a(x_a) (a=quark), \sum_q f_q(x_a) (a=gluon)
+    gluonProjector,     //!< f_a^3 = f_g(x_a)
+    nKPProjectors
+  } kpProjector;
+
+  /**
+   * MCgrid::kpProjectionTable holds the precompiled projection of a KP
+   * weight across the parton channels of a subprocess PDF. For each pair of
+   * incoming flavours and each pair of beam projectors it lists the
+   * subprocesses that receive a contribution together with their
+   * multiplicity, such that a projection is just a few multiply-adds.
+   * The table depends only on the subprocess PDF and on the number of active
+   * flavours.
+   **/
+  class kpProjectionTable
+  {
+  public:
+    kpProjectionTable(mcgrid_base_pdf const&, const int nActiveFlavors);
+
+    // Add the projection of w for incoming flavours fl1, fl2 to weights
+    void project(const int fl1,
+                 const int fl2,
+                 const double w,
+                 const kpProjector projector1,
+                 const kpProjector projector2,
+                 subprocessWeights &weights) const;
+
+    int numberOfActiveFlavors() const { return nActiveFlavors; };
+
+  private:
+    struct contribution
+    {
+      int subproc;         //!< Subprocess receiving the contribution
+      double coefficient;  //!< Number of projected pairs ending up in subproc
+    };
+
+    struct projection
+    {
+      std::vector<contribution> contributions;
+      int invalidFl1;      //!< First pair that can not be classified, if any,
+      int invalidFl2;      //!< used to report the error when actually needed
+      bool isValid;
+    };
+
+    void buildProjection(const int fl1, const int fl2,
+                         const kpProjector projector1,
+                         const kpProjector projector2,
+                         projection &) const;
+    void fillProjector(const kpProjector, const int a, double *proj) const;
+    static int projectionIndex(const int fl1, const int fl2,
+                               const kpProjector projector1,
+                               const kpProjector projector2);
+
+    mcgrid_base_pdf const& pdf;
+    const int nActiveFlavors;
+    std::vector<projection> projections;
+  };
+
+}
+
+#endif
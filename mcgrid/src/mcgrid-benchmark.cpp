@@ -0,0 +1,623 @@
+//
+//  mcgrid-benchmark.cpp
+//  MCgrid 17/10/2026.
+//
+//  Measures the throughput of the grid fill path with synthetic events,
+//  without a Rivet analysis or an event generator. The events are HepMC
+//  events with the weights an event generator would write, and are filled
+//  through grid::fill as in a Rivet analysis, such that the decoding of the
+//  weights is part of the timed fill. Each configuration is first run as a
+//  warmup run to create the phase space grids and event counts, and then
+//  the fills of the production run are timed.
+//  Usage: mcgrid-benchmark [-n <events>] [-w <warmup events>] [-g <grids>]
+//                          [-s <subprocesses,...>] [-b <backends,...>]
+//                          [-a <archs,...>] [-m <lo|nlo|nlops>] [-l]
+//                          [-d <directory>]
+//
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <atomic>
+#include <new>
+#include <memory>
+#include <cmath>
+#include <cstdlib>
+#include <unistd.h>
+
+#include "config.h"
+
+#include "Rivet/Rivet.hh"
+#include "Rivet/Event.hh"
+#include "HepMC/GenEvent.h"
+
+#include "mcgrid/mcgrid.hh"
+#include "mcgrid/mcgrid_pdf.hh"
+#include "mcgrid.hh"
+#include "grid.hh"
+#include "fillInfo.hh"
+#include "sherpaFillInfo.hh"
+
+using std::cout;
+using std::cerr;
+using std::endl;
+
+using namespace MCgrid;
+
+// ************************ Allocation counting ***************************
+
+// Count all heap allocations of the process, including those of the library
+static std::atomic<uint64_t> nAllocations(0);
+
+void* operator new(std::size_t size)
+{
+  nAllocations++;
+  void* p = malloc(size ? size : 1);
+  if (p == NULL)
+    throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void* p) noexcept
+{
+  free(p);
+}
+
+// ************************ Synthetic events ******************************
+
+// A synthetic event, holding the decoded fill information of the fillmode
+// the library has been built with and the observable value
+struct mockEvent
+{
+  mockEvent(): generic(0.0, 0, 0, 0.0, 0.0, 0.0, 0.0), coord(0.0) {}
+  fillInfo generic;
+  sherpaFillInfo sherpa;
+  double coord;
+};
+
+/**
+ * mockEventGenerator creates events with a typical LHC flavour composition,
+ * log-distributed x and Q^2 and running alpha_s. In the SHERPA fillmode,
+ * the Reweight_* weights of LO, NLO (B/VI/KP and RS events) or NLOPS (S
+ * events with DADS terms and H events with RDA terms) runs are generated
+ **/
+class mockEventGenerator
+{
+public:
+  mockEventGenerator(std::string const& mix):
+    rng(20131003),
+    uniform(0.0, 1.0),
+    normal(0.0, 1.0),
+    mix(mix)
+  {
+    // Flavour weights of -5 (bbar) ... 5 (b), 0 is the gluon
+    const double flavourWeights[] = {0.01, 0.02, 0.03, 0.04, 0.05, 0.45, 0.12, 0.20, 0.03, 0.02, 0.01};
+    flavours = std::discrete_distribution<int>(flavourWeights, flavourWeights + 11);
+  }
+
+  mockEvent next()
+  {
+    mockEvent event;
+    event.coord = uniform(rng);
+    const fillInfo info(weight(), flavour(), flavour(), x(), x(), q2(), 0.0);
+    event.generic = info;
+    event.generic.alphas = alphas(info.pdfQ2);
+    if (globalFillMode == FILL_SHERPA)
+      fillSherpaInfo(event.sherpa, event.generic);
+    return event;
+  }
+
+private:
+  int flavour() { return flavours(rng) - 5; }
+  double x() { return std::exp(std::log(1e-4) + uniform(rng)*std::log(0.9/1e-4)); }
+  double q2() { return std::exp(std::log(1e2) + uniform(rng)*std::log(1e6/1e2)); }
+  double weight() { return std::exp(normal(rng)) * ((uniform(rng) < 0.1) ? -1.0 : 1.0); }
+
+  // One-loop running coupling with five flavours
+  double alphas(const double q2) const
+  {
+    const double b0 = (33.0 - 2.0*5.0)/(12.0*M_PI);
+    return 1.0/(b0*std::log(q2/(0.2*0.2)));
+  }
+
+  // x' of the KP terms, between x and 1
+  double xPrime(const double x) { return x + (1.0 - x)*(0.05 + 0.95*uniform(rng)); }
+
+  fillInfo subInfo(fillInfo const& born, const bool newFlavours)
+  {
+    fillInfo info(born);
+    info.wgt = weight();
+    if (newFlavours) {
+      info.fl1 = flavour();
+      info.fl2 = flavour();
+    }
+    return info;
+  }
+
+  void fillSherpaInfo(sherpaFillInfo& info, fillInfo const& born)
+  {
+    static_cast<fillInfo&>(info) = born;
+    info.B = born.wgt;
+
+    if (mix == "lo") {
+      info.reweight_type = ReweightTypeLO;
+      return;
+    }
+
+    const double u = uniform(rng);
+    if (mix == "nlo" && u < 0.5) {
+      // NLO RS event, filled at the renormalisation scale
+      info.reweight_type = ReweightTypeRS;
+      info.RS = weight();
+      info.MuR2 = born.pdfQ2 * std::pow(2.0, 2.0*uniform(rng) - 1.0);
+    } else if (mix == "nlops" && u < 0.4) {
+      // NLOPS H event with 1-4 RDA terms
+      info.reweight_type = ReweightTypeH;
+      const int nRDA = 1 + (int)(4*uniform(rng));
+      for (int i(0); i < nRDA; i++)
+        info.RDA_fill_infos.push_back(subInfo(born, false));
+    } else {
+      // Born-like event with virtual and integrated subtraction terms
+      int type = ReweightTypeB | ReweightTypeVI | ReweightTypeKP;
+      info.VI = weight();
+      info.VI_wren_0 = weight();
+      info.KP_x1p = xPrime(born.x1);
+      info.KP_x2p = xPrime(born.x2);
+      for (int i(0); i < 16; i++)
+        info.KP_wfac[i] = normal(rng);
+
+      // NLOPS S event with 1-3 DADS terms
+      if (mix == "nlops") {
+        type |= ReweightTypeDADS;
+        const int nDADS = 1 + (int)(3*uniform(rng));
+        for (int i(0); i < nDADS; i++)
+          info.DADS_fill_infos.push_back(subInfo(born, true));
+      }
+      info.reweight_type = ReweightType(type);
+    }
+  }
+
+  std::mt19937_64 rng;
+  std::uniform_real_distribution<double> uniform;
+  std::normal_distribution<double> normal;
+  std::discrete_distribution<int> flavours;
+  const std::string mix;
+};
+
+// ************************ HepMC events **********************************
+
+// An event as seen by a Rivet analysis, and its observable value
+struct benchmarkEvent
+{
+  std::shared_ptr<const Rivet::Event> event;
+  double coord;
+};
+
+static int lhaToPDG(const int lha)
+{
+  return (lha == 0) ? 21 : lha;
+}
+
+// Name of a weight of the SHERPA fillmode, see sherpaWeightLayout
+static std::string subEntryName(std::string const& tag, const size_t term, std::string const& field)
+{
+  std::stringstream name;
+  name << "Reweight_" << tag << "_" << term << "_" << field;
+  return name.str();
+}
+
+// Write the SHERPA user weights of an event, as SHERPA does with the
+// HepMC_GenEvent output and the fillmode's reweighting options
+static void writeSherpaWeights(HepMC::WeightContainer& weights, sherpaFillInfo const& info)
+{
+  weights["Reweight_Type"] = info.reweight_type;
+  if (info.reweight_type == ReweightTypeLO || (info.reweight_type & ReweightTypeB))
+    weights["Reweight_B"] = info.B;
+  if (info.reweight_type & ReweightTypeVI) {
+    weights["Reweight_VI"] = info.VI;
+    weights["Reweight_VI_wren_0"] = info.VI_wren_0;
+  }
+  if (info.reweight_type & ReweightTypeKP) {
+    weights["Reweight_KP_x1p"] = info.KP_x1p;
+    weights["Reweight_KP_x2p"] = info.KP_x2p;
+    for (int i(0); i < 16; i++) {
+      std::stringstream name;
+      name << "Reweight_KP_wfac_" << i;
+      weights[name.str()] = info.KP_wfac[i];
+    }
+  }
+  if (info.reweight_type & ReweightTypeRS) {
+    weights["Reweight_RS"] = info.RS;
+    weights["MuR2"] = info.MuR2;
+  }
+
+  weights["Reweight_DADS_N"] = info.DADS_fill_infos.size();
+  for (size_t i(0); i < info.DADS_fill_infos.size(); i++) {
+    fillInfo const& term = info.DADS_fill_infos[i];
+    weights[subEntryName("DADS", i, "Weight")] = term.wgt;
+    weights[subEntryName("DADS", i, "fl1")] = lhaToPDG(term.fl1);
+    weights[subEntryName("DADS", i, "fl2")] = lhaToPDG(term.fl2);
+    weights[subEntryName("DADS", i, "x1")] = term.x1;
+    weights[subEntryName("DADS", i, "x2")] = term.x2;
+  }
+
+  weights["Reweight_RDA_N"] = info.RDA_fill_infos.size();
+  for (size_t i(0); i < info.RDA_fill_infos.size(); i++) {
+    fillInfo const& term = info.RDA_fill_infos[i];
+    weights[subEntryName("RDA", i, "Weight")] = term.wgt;
+    weights[subEntryName("RDA", i, "MuF12")] = term.pdfQ2;
+    weights[subEntryName("RDA", i, "AlphaS")] = term.alphas;
+  }
+}
+
+// Build the HepMC event of a synthetic event. The first weight is the event
+// weight, followed by the SHERPA user weights in the SHERPA fillmode
+static benchmarkEvent hepmcEvent(mockEvent const& mock, const int eventNumber)
+{
+  fillInfo const& info = (globalFillMode == FILL_SHERPA) ? mock.sherpa : mock.generic;
+
+  HepMC::GenEvent genEvent;
+  genEvent.set_event_number(eventNumber);
+  genEvent.set_alphaQCD(info.alphas);
+  genEvent.set_pdf_info(HepMC::PdfInfo(lhaToPDG(info.fl1), lhaToPDG(info.fl2), info.x1, info.x2,
+                                       std::sqrt(info.pdfQ2), 0.0, 0.0));
+  genEvent.weights()["Weight"] = info.wgt;
+  if (globalFillMode == FILL_SHERPA)
+    writeSherpaWeights(genEvent.weights(), mock.sherpa);
+
+  benchmarkEvent event;
+  event.event.reset(new Rivet::Event(genEvent));
+  event.coord = mock.coord;
+  return event;
+}
+
+// ************************ Subprocess definitions ************************
+
+// Distribute all flavour pairs (-5 ... 5) round-robin over nSubprocesses
+static std::vector<std::vector<std::pair<int, int> > > subprocessPartition(const int nSubprocesses)
+{
+  std::vector<std::vector<std::pair<int, int> > > subprocesses(nSubprocesses);
+  int iPair(0);
+  for (int fl1(-5); fl1 <= 5; fl1++)
+    for (int fl2(-5); fl2 <= 5; fl2++)
+      subprocesses[(iPair++) % nSubprocesses].push_back(std::make_pair(fl1, fl2));
+  return subprocesses;
+}
+
+// Write an APPLgrid lumi_pdf configuration, see identifySubprocs.py
+static std::string writeAPPLgridSubprocesses(const int nSubprocesses)
+{
+  std::stringstream fileName;
+  fileName << "benchmark-" << nSubprocesses << ".config";
+  std::ofstream file(fileName.str().c_str());
+  file << "0" << endl;
+  const std::vector<std::vector<std::pair<int, int> > > subprocesses = subprocessPartition(nSubprocesses);
+  for (size_t i(0); i < subprocesses.size(); i++) {
+    file << i << " " << subprocesses[i].size();
+    for (size_t j(0); j < subprocesses[i].size(); j++)
+      file << " " << subprocesses[i][j].first << " " << subprocesses[i][j].second;
+    file << endl;
+  }
+  return fileName.str();
+}
+
+// Write a fastNLO steering file, see createFastNLOSteering.py
+static std::string writeFastNLOSubprocesses(const int nSubprocesses)
+{
+  std::stringstream fileName;
+  fileName << "benchmark-" << nSubprocesses << ".str";
+  std::ofstream file(fileName.str().c_str());
+  file << "PublicationUnits              12" << endl;
+  file << "UnitsOfCoefficients           12" << endl;
+  file << "ScaleDescriptionScale1        \"Q [GeV]\"" << endl;
+  file << "DimensionLabels {" << endl << "   \"Observable\"" << endl << "}" << endl;
+  file << "PDF1                          2212" << endl;
+  file << "PDF2                          2212" << endl;
+  const char* orders[] = {"LO", "NLO", "NNLO"};
+  for (int i(0); i < 3; i++) {
+    file << "NSubProcesses" << orders[i] << "    " << nSubprocesses << endl;
+    file << "IPDFdef3" << orders[i] << "         " << nSubprocesses << endl;
+  }
+  const std::vector<std::vector<std::pair<int, int> > > subprocesses = subprocessPartition(nSubprocesses);
+  for (int i(0); i < 3; i++) {
+    file << "PartonCombinations" << orders[i] << " {{" << endl;
+    for (size_t j(0); j < subprocesses.size(); j++) {
+      file << j;
+      for (size_t k(0); k < subprocesses[j].size(); k++)
+        file << " " << subprocesses[j][k].first << " " << subprocesses[j][k].second;
+      file << endl;
+    }
+    file << "}}" << endl;
+  }
+  return fileName.str();
+}
+
+// ************************ Benchmark runs ********************************
+
+static const std::string benchmarkAnalysis("/MCGRID_BENCHMARK");
+
+typedef enum { applBackend, fastnloBackend, nullBackend } backendType;
+static const std::string backendNames[] = {"appl", "fnlo", "null"};
+static const std::string archNames[] = {"high", "med", "low"};
+
+struct benchmarkOptions
+{
+  benchmarkOptions():
+    nEvents(50000),
+    nWarmupEvents(10000),
+    nGrids(1),
+    mix("nlo"),
+    isUsingScaleLogGrids(false) {}
+
+  uint64_t nEvents;
+  uint64_t nWarmupEvents;
+  int nGrids;
+  std::string mix;
+  bool isUsingScaleLogGrids;
+};
+
+struct benchmarkResult
+{
+  double seconds;
+  uint64_t nFills;
+  uint64_t nAllocations;
+};
+
+static Rivet::Histo1DPtr benchmarkHistogram(const int i)
+{
+  std::vector<double> edges;
+  for (int j(0); j <= 20; j++)
+    edges.push_back(j/20.0);
+  std::stringstream path;
+  path << benchmarkAnalysis << "/obs" << i;
+  return Rivet::Histo1DPtr(new YODA::Histo1D(edges, path.str()));
+}
+
+static gridPtr bookBenchmarkGrid(const backendType backend, const int arch,
+                                 const int nSubprocesses, const int i,
+                                 benchmarkOptions const& options)
+{
+  const Rivet::Histo1DPtr histo = benchmarkHistogram(i);
+  const int lo(2);
+  // The null backend is booked with the config of any available backend
+#if APPLGRID_ENABLED
+  const applGridArch applArchs[] = {highPrecAPPLgridArch, medPrecAPPLgridArch, lowPrecAPPLgridArch};
+  if (backend == applBackend || backend == nullBackend) {
+    const subprocessConfig subprocesses(writeAPPLgridSubprocesses(nSubprocesses), BEAM_PROTON, BEAM_PROTON);
+    const applGridConfig config(lo, subprocesses, applArchs[arch], 1e-5, 1.0, 1e1, 1e7,
+                                options.isUsingScaleLogGrids);
+    return bookGrid(histo, benchmarkAnalysis, config);
+  }
+#endif
+#if FASTNLO_ENABLED
+  const fastnloGridArch fastnloArchs[] = {highPrecFastNLOgridArch, medPrecFastNLOgridArch, lowPrecFastNLOgridArch};
+  if (backend == fastnloBackend || backend == nullBackend) {
+    const subprocessConfig subprocesses(writeFastNLOSubprocesses(nSubprocesses), BEAM_PROTON, BEAM_PROTON);
+    const fastnloConfig config(lo, subprocesses, fastnloArchs[arch], 13000.0,
+                               options.isUsingScaleLogGrids);
+    return bookGrid(histo, benchmarkAnalysis, config);
+  }
+#endif
+  cerr << "MCgrid::Error - The " << backendNames[backend] << " backend is not available";
+  cerr << " in this build of MCgrid." << endl;
+  exit(-1);
+}
+
+// The event is counted and filled as in the analyze() method of a Rivet
+// analysis, the first fill decodes its weights for all grids
+static void fillEvent(std::vector<gridPtr> const& grids, benchmarkEvent const& event)
+{
+  PDFHandler::HandleEvent(*event.event, benchmarkAnalysis);
+  for (size_t i(0); i < grids.size(); i++)
+    grids[i]->fill(event.coord, *event.event);
+}
+
+// Book the grids of a configuration, fill them with the given events and
+// export them, if requested. Only the fill loop is timed
+static benchmarkResult runGrids(const backendType backend, const int arch,
+                                const int nSubprocesses,
+                                std::vector<benchmarkEvent> const& events,
+                                const bool shouldExport,
+                                benchmarkOptions const& options)
+{
+  std::vector<gridPtr> grids;
+  for (int i(0); i < options.nGrids; i++) {
+    grids.push_back(bookBenchmarkGrid(backend, arch, nSubprocesses, i, options));
+    if (dynamic_cast<_grid*>(grids.back().get()) == NULL) {
+      cerr << "MCgrid::Error - Grids can not be benchmarked while MCGRID_DISABLED is set." << endl;
+      exit(-1);
+    }
+  }
+
+  benchmarkResult result;
+  const uint64_t allocationsBefore = nAllocations.load();
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (size_t i(0); i < events.size(); i++)
+    fillEvent(grids, events[i]);
+  const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+  result.nAllocations = nAllocations.load() - allocationsBefore;
+  result.seconds = std::chrono::duration<double>(end - start).count();
+  result.nFills = events.size() * grids.size();
+
+  if (shouldExport)
+    for (size_t i(0); i < grids.size(); i++)
+      grids[i]->exportgrid();
+
+  // Releasing the last analysis also writes the event counts of a warmup run
+  grids.clear();
+  PDFHandler::CheckOutAnalysis(benchmarkAnalysis);
+  return result;
+}
+
+static benchmarkResult runBenchmark(const backendType backend, const int arch,
+                                    const int nSubprocesses,
+                                    std::vector<benchmarkEvent> const& warmupEvents,
+                                    std::vector<benchmarkEvent> const& events,
+                                    benchmarkOptions const& options)
+{
+  // Each configuration gets its own phase space grids and event counts
+  std::stringstream outputPath;
+  outputPath << backendNames[backend] << "-" << archNames[arch] << "-" << nSubprocesses;
+  setenv("MCGRID_OUTPUT_PATH", outputPath.str().c_str(), 1);
+  if (backend == nullBackend)
+    setenv("MCGRID_NULL_BACKEND", "1", 1);
+  else
+    unsetenv("MCGRID_NULL_BACKEND");
+
+  if (backend != nullBackend)
+    runGrids(backend, arch, nSubprocesses, warmupEvents, true, options);
+  return runGrids(backend, arch, nSubprocesses, events, false, options);
+}
+
+// ************************ Command line **********************************
+
+static void printUsage()
+{
+  cerr << "Usage: mcgrid-benchmark [options]" << endl;
+  cerr << "  -n <events>          Number of timed events (default 50000)" << endl;
+  cerr << "  -w <events>          Number of warmup events (default 10000)" << endl;
+  cerr << "  -g <grids>           Number of grids filled per event (default 1)" << endl;
+  cerr << "  -s <n,...>           Numbers of subprocesses (default 1,7,121)" << endl;
+  cerr << "  -b <backends,...>    Any of appl, fnlo and null (default all available)" << endl;
+  cerr << "  -a <archs,...>       Any of high, med and low (default all)" << endl;
+  cerr << "  -m <lo|nlo|nlops>    Event mix of the SHERPA fillmode (default nlo)" << endl;
+  cerr << "  -l                   Use dedicated scale logarithm grids" << endl;
+  cerr << "  -d <directory>       Working directory for the grids (default a new" << endl;
+  cerr << "                       directory in /tmp)" << endl;
+}
+
+static std::vector<std::string> splitList(std::string const& list)
+{
+  std::vector<std::string> items;
+  std::stringstream stream(list);
+  std::string item;
+  while (std::getline(stream, item, ','))
+    if (item != "")
+      items.push_back(item);
+  return items;
+}
+
+static int indexOf(std::string const& name, const std::string names[], const int nNames)
+{
+  for (int i(0); i < nNames; i++)
+    if (names[i] == name)
+      return i;
+  cerr << "MCgrid::Error - Unknown benchmark option value " << name << endl;
+  exit(-1);
+}
+
+int main(int argc, char* argv[])
+{
+  benchmarkOptions options;
+  std::vector<std::string> subprocessList = splitList("1,7,121");
+  std::vector<std::string> backendList;
+#if APPLGRID_ENABLED
+  backendList.push_back("appl");
+#endif
+#if FASTNLO_ENABLED
+  backendList.push_back("fnlo");
+#endif
+  backendList.push_back("null");
+  std::vector<std::string> archList = splitList("high,med,low");
+  std::string directory;
+
+  for (int i=1; i<argc; i++) {
+    const std::string arg(argv[i]);
+    const bool hasValue(i+1 < argc);
+    if (arg == "-n" && hasValue) {
+      options.nEvents = strtoull(argv[++i], NULL, 10);
+    } else if (arg == "-w" && hasValue) {
+      options.nWarmupEvents = strtoull(argv[++i], NULL, 10);
+    } else if (arg == "-g" && hasValue) {
+      options.nGrids = atoi(argv[++i]);
+    } else if (arg == "-s" && hasValue) {
+      subprocessList = splitList(argv[++i]);
+    } else if (arg == "-b" && hasValue) {
+      backendList = splitList(argv[++i]);
+    } else if (arg == "-a" && hasValue) {
+      archList = splitList(argv[++i]);
+    } else if (arg == "-m" && hasValue) {
+      options.mix = argv[++i];
+    } else if (arg == "-l") {
+      options.isUsingScaleLogGrids = true;
+    } else if (arg == "-d" && hasValue) {
+      directory = argv[++i];
+    } else {
+      printUsage();
+      return (arg == "-h" || arg == "--help") ? 0 : -1;
+    }
+  }
+
+  if (options.nEvents == 0 || options.nGrids < 1
+      || (options.mix != "lo" && options.mix != "nlo" && options.mix != "nlops")) {
+    printUsage();
+    return -1;
+  }
+
+  // All grids, phase space files and subprocess definitions are written
+  // relative to the working directory
+  if (directory == "") {
+    char scratch[] = "/tmp/mcgrid-benchmark.XXXXXX";
+    if (mkdtemp(scratch) == NULL) {
+      cerr << "MCgrid::Error - Could not create a benchmark directory." << endl;
+      return -1;
+    }
+    directory = scratch;
+  }
+  if (chdir(directory.c_str()) != 0) {
+    cerr << "MCgrid::Error - Could not change to the benchmark directory " << directory << endl;
+    return -1;
+  }
+
+  // The same events are used for all configurations, they are built before
+  // any fill is timed
+  mockEventGenerator generator(options.mix);
+  std::vector<benchmarkEvent> warmupEvents, events;
+  int eventNumber(0);
+  for (uint64_t i(0); i < options.nWarmupEvents; i++)
+    warmupEvents.push_back(hepmcEvent(generator.next(), ++eventNumber));
+  for (uint64_t i(0); i < options.nEvents; i++)
+    events.push_back(hepmcEvent(generator.next(), ++eventNumber));
+
+  std::stringstream table;
+  table << std::left << std::setw(8) << "backend" << std::setw(6) << "arch";
+  table << std::right << std::setw(10) << "subprocs" << std::setw(14) << "fills/s";
+  table << std::setw(12) << "ns/fill" << std::setw(14) << "allocs/event" << endl;
+
+  for (size_t i(0); i < backendList.size(); i++) {
+    const backendType backend = backendType(indexOf(backendList[i], backendNames, 3));
+    // The architecture does not matter for the null backend
+    const size_t nArchs = (backend == nullBackend) ? 1 : archList.size();
+    for (size_t j(0); j < nArchs; j++) {
+      const int arch = indexOf(archList[j], archNames, 3);
+      for (size_t k(0); k < subprocessList.size(); k++) {
+        const int nSubprocesses = atoi(subprocessList[k].c_str());
+        if (nSubprocesses < 1 || nSubprocesses > 121) {
+          cerr << "MCgrid::Error - The number of subprocesses must be between 1 and 121." << endl;
+          return -1;
+        }
+        const benchmarkResult result = runBenchmark(backend, arch, nSubprocesses,
+                                                    warmupEvents, events, options);
+        table << std::left << std::setw(8) << backendNames[backend];
+        table << std::setw(6) << ((backend == nullBackend) ? "-" : archNames[arch]);
+        table << std::right << std::setw(10) << nSubprocesses;
+        table << std::setw(14) << std::fixed << std::setprecision(0) << result.nFills/result.seconds;
+        table << std::setw(12) << std::setprecision(1) << 1e9*result.seconds/result.nFills;
+        table << std::setw(14) << std::setprecision(2) << (double)result.nAllocations/events.size() << endl;
+      }
+    }
+  }
+
+  cout << endl << "MCgrid: Fill benchmark in the " << fillString[globalFillMode] << " fillmode";
+  if (globalFillMode == FILL_SHERPA)
+    cout << " (" << options.mix << " events)";
+  cout << ", " << options.nEvents << " events, " << options.nGrids << " grid(s) per event,";
+  cout << " working directory " << directory << endl << endl;
+  cout << table.str();
+  return 0;
+}
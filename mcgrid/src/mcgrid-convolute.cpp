@@ -0,0 +1,155 @@
+//
+//  mcgrid-convolute.cpp
+//  MCgrid 17/10/2026.
+//
+//  Convolutes MCgrid APPLgrids and fastNLO tables with an LHAPDF6 set and
+//  prints the predictions for the central scale and a scale variation, or
+//  for all members of the set.
+//  Usage: mcgrid-convolute [-p <pdf set>] [-m <member> | -e] [-o <loops>]
+//                          [-v <3|7|9>] [-x <scale factor>] [-j <threads>]
+//                          <grid> [<grid> ...]
+//
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+
+#include "mcgrid/mcgrid_convolution.hh"
+
+using std::cout;
+using std::cerr;
+using std::endl;
+using std::setw;
+
+static void printUsage()
+{
+  cerr << "Usage: mcgrid-convolute [-p <pdf set>] [-m <member> | -e] [-o <loops>]" << endl;
+  cerr << "                        [-v <3|7|9>] [-x <scale factor>] [-j <threads>]" << endl;
+  cerr << "                        <grid> [<grid> ...]" << endl;
+  cerr << "  Convolutes MCgrid APPLgrids (.root) or fastNLO tables (.tab) with member" << endl;
+  cerr << "  <member> (default 0) of the LHAPDF6 set <pdf set> (default CT10) and prints" << endl;
+  cerr << "  the predictions for the central scale and for the renormalisation and" << endl;
+  cerr << "  factorisation scales multiplied and divided by <scale factor> (default" << endl;
+  cerr << "  sqrt(2)). With -v 7 or -v 9, the envelope of a 7- or 9-point variation of" << endl;
+  cerr << "  both scales is printed instead (default factor 2). <loops> limits the" << endl;
+  cerr << "  perturbative order (0 is LO, 1 is NLO)." << endl;
+  cerr << "  With -e, the central scale predictions of all members of the set are" << endl;
+  cerr << "  printed instead, one row per member." << endl;
+}
+
+// Print the central scale predictions of all members, one row per member
+static void printMembers(MCgrid::gridConvolution& convolution,
+                         std::string const& grid,
+                         std::string const& pdfSet,
+                         const int nLoops)
+{
+  const std::vector<MCgrid::scaleFactors> central(1, MCgrid::scaleFactors(1.0, 1.0));
+
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  const std::vector< std::vector<double> > xsec = convolution.convoluteMembers(pdfSet, central, nLoops)[0];
+  const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  cout << endl << "Grid: " << grid << endl;
+  cout << "PDF: " << pdfSet << ", " << xsec.size() << " members" << endl;
+  cout << "Nbins: " << convolution.nBins() << endl;
+  cout << "Tabulated PDF nodes per member: " << convolution.nTabulatedNodes() << endl;
+  cout << "Convolution time: " << seconds << " s" << endl << endl;
+
+  cout << setw(7) << "Member";
+  for (size_t i(0); i<convolution.nBins(); i++)
+    cout << " " << setw(15) << convolution.binLow(i);
+  cout << endl;
+  for (size_t m(0); m<xsec.size(); m++) {
+    cout << setw(7) << m;
+    for (size_t i(0); i<xsec[m].size(); i++)
+      cout << " " << setw(15) << xsec[m][i];
+    cout << endl;
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  std::string pdfSet("CT10");
+  int member(0);
+  int nLoops(-1);
+  int nThreads(1);
+  double scaleFactor(0.0);
+  int nScalePoints(3);
+  bool allMembers(false);
+  std::vector<std::string> grids;
+  for (int i=1; i<argc; i++) {
+    const std::string arg(argv[i]);
+    if (arg == "-p" && i+1 < argc) {
+      pdfSet = argv[++i];
+    } else if (arg == "-m" && i+1 < argc) {
+      member = atoi(argv[++i]);
+    } else if (arg == "-e") {
+      allMembers = true;
+    } else if (arg == "-o" && i+1 < argc) {
+      nLoops = atoi(argv[++i]);
+    } else if (arg == "-v" && i+1 < argc) {
+      nScalePoints = atoi(argv[++i]);
+    } else if (arg == "-x" && i+1 < argc) {
+      scaleFactor = atof(argv[++i]);
+    } else if (arg == "-j" && i+1 < argc) {
+      nThreads = atoi(argv[++i]);
+    } else if (arg == "-h" || arg == "--help") {
+      printUsage();
+      return 0;
+    } else {
+      grids.push_back(arg);
+    }
+  }
+
+  if (scaleFactor == 0.0)
+    scaleFactor = (nScalePoints == 3) ? std::sqrt(2.0) : 2.0;
+  if (grids.empty() || nThreads < 1 || scaleFactor <= 0.0) {
+    printUsage();
+    return -1;
+  }
+
+  const std::vector<MCgrid::scaleFactors> scales = MCgrid::scaleVariations(nScalePoints, scaleFactor);
+
+  for (size_t g(0); g<grids.size(); g++) {
+    MCgrid::gridConvolution convolution(grids[g], nThreads);
+    if (allMembers) {
+      printMembers(convolution, grids[g], pdfSet, nLoops);
+      continue;
+    }
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    const std::vector< std::vector<double> > xsec = convolution.convolute(pdfSet, member, scales, nLoops);
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    cout << endl << "Grid: " << grids[g] << endl;
+    cout << "PDF: " << pdfSet << ", member " << member << endl;
+    cout << "Nbins: " << convolution.nBins() << endl;
+    cout << "Tabulated PDF nodes: " << convolution.nTabulatedNodes() << endl;
+    cout << "Convolution time: " << seconds << " s" << endl << endl;
+
+    // The 3-point variation is printed point by point, larger ones as envelope
+    std::vector<double> lower, upper;
+    if (nScalePoints == 3) {
+      lower = xsec[2];
+      upper = xsec[1];
+    } else {
+      MCgrid::scaleEnvelope(xsec, lower, upper);
+    }
+
+    cout << setw(10) << "BinLow" << " " << setw(10) << "BinHigh" << " " << setw(15) << "xsec" << " ";
+    if (nScalePoints == 3)
+      cout << setw(15) << "Scale*x" << " " << setw(15) << "Scale/x" << endl;
+    else
+      cout << setw(15) << "EnvelopeHigh" << " " << setw(15) << "EnvelopeLow" << endl;
+    for (size_t i(0); i<convolution.nBins(); i++) {
+      cout << setw(10) << convolution.binLow(i) << " " << setw(10) << convolution.binHigh(i) << " ";
+      cout << setw(15) << xsec[0][i] << " " << setw(15) << upper[i] << " " << setw(15) << lower[i] << endl;
+    }
+  }
+
+  return 0;
+}
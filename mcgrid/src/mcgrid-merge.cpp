@@ -0,0 +1,72 @@
+//
+//  mcgrid-merge.cpp
+//  MCgrid 17/10/2026.
+//
+//  Combines the grids, event counter or phase space extent files of
+//  independent MCgrid runs.
+//  Usage: mcgrid-merge [-j <threads>] [--equal-weights] <output> <input> [<input> ...]
+//
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+
+#include "mcgrid/mcgrid_merge.hh"
+
+using std::cerr;
+using std::endl;
+
+static void printUsage()
+{
+  cerr << "Usage: mcgrid-merge [-j <threads>] [--equal-weights] <output> <input> [<input> ...]" << endl;
+  cerr << "  Merges MCgrid APPLgrids (.root), fastNLO tables (.tab), event counter" << endl;
+  cerr << "  files (.evtcount) or warmup phase space extents (.extent) of independent" << endl;
+  cerr << "  runs into <output>." << endl;
+  cerr << "  --equal-weights  merge APPLgrids without run information (.runinfo) as" << endl;
+  cerr << "                   if all runs had the same number of events" << endl;
+}
+
+static bool hasExtension(std::string const& path, std::string const& extension)
+{
+  return path.size() > extension.size()
+      && path.compare(path.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+int main(int argc, char* argv[])
+{
+  int nThreads(1);
+  bool equalWeights(false);
+  std::vector<std::string> args;
+  for (int i=1; i<argc; i++) {
+    const std::string arg(argv[i]);
+    if (arg == "-j" && i+1 < argc) {
+      nThreads = atoi(argv[++i]);
+    } else if (arg == "--equal-weights") {
+      equalWeights = true;
+    } else if (arg == "-h" || arg == "--help") {
+      printUsage();
+      return 0;
+    } else {
+      args.push_back(arg);
+    }
+  }
+
+  if (args.size() < 2 || nThreads < 1) {
+    printUsage();
+    return -1;
+  }
+
+  const std::string output(args[0]);
+  const std::vector<std::string> inputs(args.begin() + 1, args.end());
+
+  if (hasExtension(output, ".evtcount")) {
+    MCgrid::mergeEventCounts(inputs, output);
+  } else if (hasExtension(output, ".extent")) {
+    MCgrid::mergePhasespaceExtents(inputs, output);
+  } else {
+    MCgrid::mergeGrids(inputs, output, nThreads, equalWeights);
+  }
+
+  return 0;
+}
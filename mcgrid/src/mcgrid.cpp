@@ -3,6 +3,9 @@
 //  MCgrid 21/07/2015.
 //
 
+#include <iostream>
+#include <cstdlib>
+
 #include "mcgrid.hh"
 
 #include "system.hh"
@@ -10,9 +13,16 @@
 namespace MCgrid
 {
   int numberOfActiveFlavors = 5;
+  std::atomic<bool> hasBookedGrids(false);
 
   void setNumberOfActiveFlavors(const int n)
   {
+    if (hasBookedGrids.load() && n != numberOfActiveFlavors) {
+      std::cerr << "MCgrid::Error - setNumberOfActiveFlavors(" << n << ") is called after grids have been booked ";
+      std::cerr << "with " << numberOfActiveFlavors << " active flavours." << std::endl;
+      std::cerr << "                Please set the number of active flavours before booking any grid." << std::endl;
+      exit(-1);
+    }
     numberOfActiveFlavors = n;
   }
 
@@ -7,6 +7,7 @@
 #define mcgrid_private_hh
 
 #include <string>
+#include <atomic>
 
 #include "config.h"
 
@@ -31,6 +32,10 @@ namespace MCgrid
   // the public mcgrid header to change this.
   extern int numberOfActiveFlavors;
 
+  // Set once the first grid is booked, after which numberOfActiveFlavors
+  // may no longer be changed
+  extern std::atomic<bool> hasBookedGrids;
+
   // The root mcgrid directories
   std::string MCgridPhasespacePath();  // defaults to `MCgridOutputPath()`
   std::string MCgridOutputPath();      // defaults to `./mcgrid`
@@ -15,6 +15,13 @@
 #include "mcgrid.hh"
 #include "conventions.hh"
 #include "system.hh"
+#include "fillInfoCache.hh"
+#include "threading.hh"
+#include "eventRecord.hh"
+#include "trace.hh"
+#include "exportQueue.hh"
+#include "checkpoint.hh"
+#include "kpProjection.hh"
 
 // Interface-specific includes
 #if APPLGRID_ENABLED
@@ -31,7 +38,8 @@ using Rivet::endl;
 namespace MCgrid
 {
   // Singleton management
-  PDFHandler *PDFHandler::handlerInstance = 0;
+  std::atomic<PDFHandler*> PDFHandler::handlerInstance(0);
+  std::mutex PDFHandler::instanceMutex;
 
   // basic hash
   static unsigned hash_str(const char* s)
@@ -49,6 +57,10 @@ namespace MCgrid
 
   mcgrid_base_pdf::~mcgrid_base_pdf()
   {
+    ReduceEventCounts();
+    delete threadEventCounts;
+    delete kpProjections;
+
     if (!initialised)
       Export();
 
@@ -61,16 +73,33 @@ namespace MCgrid
   }
 
 
+  kpProjectionTable const* mcgrid_base_pdf::KPProjections(const int nActiveFlavors)
+  {
+    if (kpProjections == NULL)
+      kpProjections = new kpProjectionTable(*this, nActiveFlavors);
+    if (kpProjections->numberOfActiveFlavors() != nActiveFlavors) {
+      cerr << "MCgrid::Error - The KP projections of " << name() << " have been compiled for ";
+      cerr << kpProjections->numberOfActiveFlavors() << " active flavours, not " << nActiveFlavors << "." << endl;
+      exit(-1);
+    }
+    return kpProjections;
+  }
+
   template<typename T>
   void mcgrid_base_pdf::InitialiseEventCounting(T *subprocesses)
   {
     nPairs = new int[NumberOfSubprocesses()];
     nSubEvents = new uint64_t[NumberOfSubprocesses()];
     nSubPairEvents = new uint64_t*[NumberOfSubprocesses()];
+    threadEventCounts = new perThread<std::vector<uint64_t> >();
+    pairOffsets.assign(NumberOfSubprocesses(), 0);
+    nTotalPairs = 0;
 
     for (int i=0; i<NumberOfSubprocesses(); i++)
     {
       nPairs[i] = (*subprocesses)[i].size();
+      pairOffsets[i] = nTotalPairs;
+      nTotalPairs += nPairs[i];
       
       nSubEvents[i] = 0;
       nSubPairEvents[i] = new uint64_t[nPairs[i]];
@@ -87,6 +116,8 @@ namespace MCgrid
   // Export evtcount file
   void mcgrid_base_pdf::Export() const
   {
+    traceSpan span("write", "write event counts", pdfname);
+
     // Create the directory if it doesnt already exist
     Rivet::stringstream filename;
     filename << MCgridPhasespacePath();
@@ -94,37 +125,81 @@ namespace MCgrid
     
     // Write event counter
     filename << "/" << pdfname << ".evtcount";
+    std::vector<uint64_t> counts(nTotalPairs);
+    for (int i=0; i<NumberOfSubprocesses(); i++)
+      for (int j=0; j<nPairs[i]; j++)
+        counts[pairOffsets[i] + j] = nSubPairEvents[i][j];
+    ExportEventCounts(filename.str(), counts);
+  }
+
+  void mcgrid_base_pdf::ExportEventCounts(std::string const& path, std::vector<uint64_t> const& counts) const
+  {
     std::ofstream file;
-    file.open(filename.str().c_str());
+    file.open(path.c_str());
     
     file << pdfname << endl;
     file << NumberOfSubprocesses() << endl;
     
     for (int i=0; i<NumberOfSubprocesses(); i++) {
+      uint64_t subEvents(0);
+      for (int j=0; j<nPairs[i]; j++)
+        subEvents += counts[pairOffsets[i] + j];
       file << "SubProc: "<< i;
       file << " Pairs: " << nPairs[i];
-      file << " SubEvents: " << nSubEvents[i] << endl;
+      file << " SubEvents: " << subEvents << endl;
     }
     
     for (int i=0; i<NumberOfSubprocesses(); i++) {
       file << "Subproc: " << i << "  ";
       for (int j=0; j<nPairs[i]; j++)
-        file <<nSubPairEvents[i][j] << "  ";
+        file << counts[pairOffsets[i] + j] << "  ";
       file << endl;
     }
   }
 
+  // The totals and the counts of all fill threads, which are not reduced
+  // as the fill threads keep counting
+  std::vector<uint64_t> mcgrid_base_pdf::EventCountSnapshot() const
+  {
+    std::vector<uint64_t> snapshot(nTotalPairs, 0);
+    for (int i=0; i<NumberOfSubprocesses(); i++)
+      for (int j=0; j<nPairs[i]; j++)
+        snapshot[pairOffsets[i] + j] = nSubPairEvents[i][j];
+
+    for (int slot=0; slot<maxFillThreads; slot++) {
+      std::vector<uint64_t>* counts = threadEventCounts->get(slot);
+      if (counts == NULL || counts->empty())
+        continue;
+      for (int k=0; k<nTotalPairs; k++)
+        snapshot[k] += (*counts)[k];
+    }
+    return snapshot;
+  }
+
+  void mcgrid_base_pdf::ResumeEventCounts(std::string const& path)
+  {
+    if (!ReadEventCounts(path)) {
+      cerr << "MCgrid::Error - Unable to read the checkpointed event counts " << path << endl;
+      exit(-1);
+    }
+  }
+
 
   // Read evtcount file
   bool mcgrid_base_pdf::Read()
   {
     Rivet::stringstream filename;
     filename << MCgridPhasespacePath() << "/" << pdfname << ".evtcount";
-    if (Rivet::fileexists(filename.str()))
+    return ReadEventCounts(filename.str());
+  }
+
+  bool mcgrid_base_pdf::ReadEventCounts(std::string const& path)
+  {
+    if (Rivet::fileexists(path))
     {
       // Read phase space file
       std::ifstream datastream;
-      datastream.open(filename.str().c_str());
+      datastream.open(path.c_str());
       
       int testint;
       std::string teststr;
@@ -134,7 +209,7 @@ namespace MCgrid
       
       if (testint != NumberOfSubprocesses())
       {
-        cerr << "MCGrid::mcgrid_pdf Error: Event counter information in "<< filename.str()<<" is inconsistent with PDF config file"<<endl;
+        cerr << "MCGrid::mcgrid_pdf Error: Event counter information in "<< path<<" is inconsistent with PDF config file"<<endl;
         cerr << "                          Please rerun the phase space optimisation."<<endl;
         exit(-1);
       }
@@ -144,7 +219,7 @@ namespace MCgrid
         datastream >> teststr >> testint >> teststr >> nPairs[i] >> teststr >> nSubEvents[i];
         if (testint != i )
         {
-          cerr << "MCGridmcgrid_pdf Error: Event counter information in "<< filename.str()<<" is incorrectly formatted"<<endl;
+          cerr << "MCGridmcgrid_pdf Error: Event counter information in "<< path<<" is incorrectly formatted"<<endl;
           cerr << "                        Please rerun the phase space optimisation."<<endl;
           exit(-1);
         }
@@ -158,7 +233,7 @@ namespace MCgrid
         
         if (testint != i )
         {
-          cerr << "MCGridmcgrid_pdf Error: Event counter information in "<< filename.str()<<" is incorrectly formatted"<<endl;
+          cerr << "MCGridmcgrid_pdf Error: Event counter information in "<< path<<" is incorrectly formatted"<<endl;
           cerr << "                        Please rerun the phase space optimisation."<<endl;
           exit(-1);
         }
@@ -170,27 +245,71 @@ namespace MCgrid
     return false;
   }
   
-  // Count event flavours to ensure correct statistics in the combination
+  // Count event flavours to ensure correct statistics in the combination.
+  // Each fill thread counts into its own array, see ReduceEventCounts
   void mcgrid_base_pdf::CountEvent(const int fl1, const int fl2)
   {
-    const int subproc = decideSubProcess(fl1,fl2);
-    const int subpair = decideSubPair(subproc, fl1, fl2);
-    
-    nSubEvents[subproc]++;
-    nSubPairEvents[subproc][subpair]++;
+    const subprocessLookup lookup = LookupSubProcess(fl1, fl2);
+
+    std::vector<uint64_t>& counts = threadEventCounts->local();
+    if (counts.empty())
+      counts.assign(nTotalPairs, 0);
+    counts[pairOffsets[lookup.subproc] + lookup.subpair]++;
   }
-  
-  // Returns multiplicative factor to convert Nt/Ni to Nt/Nsub
-  double mcgrid_base_pdf::EventRatio(const int fl1, const int fl2)
+
+  // Add the per-thread event counts to the totals in slot order
+  void mcgrid_base_pdf::ReduceEventCounts()
   {
-    if (!initialised)
-      return 1;
-    
-    const int subproc = decideSubProcess(fl1,fl2);
-    const int subpair = decideSubPair(subproc,fl1,fl2);
-   
-    // May be better to have a lookup table?
-    return ((double)nSubPairEvents[subproc][subpair])/((double)nSubEvents[subproc]);
+    if (threadEventCounts == NULL)
+      return;
+
+    for (int slot=0; slot<maxFillThreads; slot++) {
+      std::vector<uint64_t>* counts = threadEventCounts->get(slot);
+      if (counts == NULL || counts->empty())
+        continue;
+      for (int i=0; i<NumberOfSubprocesses(); i++) {
+        for (int j=0; j<nPairs[i]; j++) {
+          const uint64_t count = (*counts)[pairOffsets[i] + j];
+          nSubEvents[i] += count;
+          nSubPairEvents[i][j] += count;
+        }
+      }
+      counts->assign(nTotalPairs, 0);
+    }
+  }
+
+  // Classify all flavour pairs once, such that fills only need a table access
+  void mcgrid_base_pdf::InitialiseLookupTable()
+  {
+    for (int i1=0; i1<nLookupFlavours; i1++) {
+      for (int i2=0; i2<nLookupFlavours; i2++) {
+        const int fl1 = i1 - lookupFlavourOffset;
+        const int fl2 = i2 - lookupFlavourOffset;
+        subprocessLookup& entry = lookupTable[i1*nLookupFlavours + i2];
+        if (classifySubProcess(fl1, fl2) == -1) {
+          entry.subproc = -1;
+          entry.subpair = -1;
+          entry.eventRatio = 0.0;
+        } else {
+          entry = ComputeLookup(fl1, fl2);
+        }
+      }
+    }
+  }
+
+  // Classifies a flavour pair and returns the multiplicative factor to
+  // convert Nt/Ni to Nt/Nsub (exits if the pair can not be classified)
+  subprocessLookup mcgrid_base_pdf::ComputeLookup(const int fl1, const int fl2) const
+  {
+    subprocessLookup lookup;
+    lookup.subproc = decideSubProcess(fl1,fl2);
+    lookup.subpair = decideSubPair(lookup.subproc,fl1,fl2);
+    if (initialised) {
+      lookup.eventRatio = ((double)nSubPairEvents[lookup.subproc][lookup.subpair])/((double)nSubEvents[lookup.subproc]);
+    } else {
+      lookup.eventRatio = 1;
+    }
+    return lookup;
   }
 
   int mcgrid_base_pdf::validateSubProcessResult(const int subproc, const int iflav1, const int iflav2) const
@@ -229,6 +348,7 @@ namespace MCgrid
   {
   public:
     mcgrid_appl_pdf(mcgrid_appl_pdf_params const& params);
+    int classifySubProcess(const int iflav1, const int iflav2) const;
     int decideSubProcess(const int iflav1, const int iflav2) const;
     int decideSubPair(const int sub, const int iflav1, const int iflav2) const;
     int NumberOfSubprocesses() const { return Nproc(); }
@@ -244,12 +364,18 @@ namespace MCgrid
     beam2(params.beam2)
   {
     mcgrid_base_pdf::InitialiseEventCounting(this);
+    mcgrid_base_pdf::InitialiseLookupTable();
+  }
+
+  int mcgrid_appl_pdf::classifySubProcess(const int iflav1, const int iflav2) const
+  {
+    // Switch flavours if using antiproton beams
+    return lumi_pdf::decideSubProcess(beam1*iflav1, beam2*iflav2);
   }
   
   int mcgrid_appl_pdf::decideSubProcess(const int iflav1, const int iflav2) const
   {
-    // Switch flavours if using antiproton beams
-    const int subproc = lumi_pdf::decideSubProcess(beam1*iflav1, beam2*iflav2);
+    const int subproc = classifySubProcess(iflav1, iflav2);
     return mcgrid_base_pdf::validateSubProcessResult(subproc, beam1*iflav1, beam2*iflav2);
   }
   
@@ -275,7 +401,9 @@ namespace MCgrid
   {
   public:
     mcgrid_fastnlo_pdf(mcgrid_fnlo_pdf_params const&);
+    ~mcgrid_fastnlo_pdf();
     const std::vector<std::pair<int, int> >& operator[](int i) const;
+    int classifySubProcess(const int iflav1, const int iflav2) const;
     int decideSubProcess(const int iflav1, const int iflav2) const;
     int decideSubPair(const int sub, const int iflav1, const int iflav2) const;
     int NumberOfSubprocesses() const { return ftable->GetNSubprocesses(); }
@@ -284,6 +412,7 @@ namespace MCgrid
     void InitialiseReverseLookupTable();
 
     fastNLOCreate * const ftable;
+    const bool isOwningTable;
 
     // The lumi_pdf class of APPLgrid has this (used in decideSubProcess), but
     // it is missing in fastNLO, so we create it here ourselves
@@ -296,12 +425,20 @@ namespace MCgrid
 
   mcgrid_fastnlo_pdf::mcgrid_fastnlo_pdf(mcgrid_fnlo_pdf_params const& params):
     mcgrid_base_pdf(params, params.ftable->GetNSubprocesses()),
-    ftable(params.ftable)
+    ftable(params.ftable),
+    isOwningTable(params.isOwningTable)
   {
     mcgrid_base_pdf::InitialiseEventCounting(this);
     InitialiseReverseLookupTable();
+    mcgrid_base_pdf::InitialiseLookupTable();
   };
 
+  mcgrid_fastnlo_pdf::~mcgrid_fastnlo_pdf()
+  {
+    if (isOwningTable)
+      delete ftable;
+  }
+
   void mcgrid_fastnlo_pdf::InitialiseReverseLookupTable()
   {
     subprocessLookupTable = std::vector<std::vector<int> >(13, std::vector<int>(13, -1) );
@@ -313,10 +450,14 @@ namespace MCgrid
     }
   }
 
+  int mcgrid_fastnlo_pdf::classifySubProcess(const int iflav1, const int iflav2) const
+  {
+    return subprocessLookupTable[iflav1+6][iflav2+6];
+  }
+
   int mcgrid_fastnlo_pdf::decideSubProcess(const int iflav1, const int iflav2) const
   {
-    // Switch flavours if using antiproton beams
-    const int subproc = subprocessLookupTable[iflav1+6][iflav2+6];
+    const int subproc = classifySubProcess(iflav1, iflav2);
     return mcgrid_base_pdf::validateSubProcessResult(subproc, iflav1, iflav2);
   }
   
@@ -330,8 +471,28 @@ namespace MCgrid
 
 // **********************  PDFHandler **************************
 
+  PDFHandler::PDFHandler(std::string const& eventCounterAnalysis):
+    nEvents(0),
+    sumOfWeights(0.0),
+    infoCaches(new perThread<fillInfoCache>()),
+    recorder(NULL),
+    checkpoints(checkpointer::fromEnvironment()),
+    eventCounterAnalysis(eventCounterAnalysis)
+  {
+    const std::string recordPath = environmentVariableForKey("MCGRID_RECORD");
+    if (recordPath != "")
+      recorder = new eventRecorder(recordPath);
+    if (checkpoints != NULL) {
+      nEvents = checkpoints->resumedEvents();
+      sumOfWeights = checkpoints->resumedSumOfWeights();
+    }
+  }
+
   PDFHandler::~PDFHandler()
   {
+    // The checkpoint writer may still use the event counters
+    delete checkpoints;
+
     for (std::map<int,mcgrid_base_pdf*>::iterator iCount = pdfMap.begin(); iCount != pdfMap.end(); iCount++) {
 #if APPLGRID_ENABLED
       if (mcgrid_appl_pdf *pdf = dynamic_cast<mcgrid_appl_pdf*>((*iCount).second)) {
@@ -346,12 +507,28 @@ namespace MCgrid
       }
 #endif
     }
+    delete recorder;
+    delete infoCaches;
+
+    // The run ends when the last analysis checks out
+    flushTrace();
+  }
+
+  void PDFHandler::WaitForExports()
+  {
+    waitForExports();
+  }
+
+  fillInfoCache& PDFHandler::FillInfoCache()
+  {
+    return GetHandler()->infoCaches->local();
   }
 
   mcgrid_base_pdf* PDFHandler::BookPDF(mcgrid_base_pdf_params const& params, std::string const& analysis)
   {
     // Add the analysis to our set of analyses
     GetHandler(analysis)->analyses.insert(analysis);
+    traceSpan span("booking", "book subprocess pdf " + params.name);
 
     const int hashval = hash_str(params.name.c_str());
     
@@ -402,11 +579,21 @@ namespace MCgrid
     }
 #endif
     GetHandler(analysis)->pdfMap.insert(std::make_pair(hashval, pdf));
+    if (GetHandler(analysis)->checkpoints != NULL && !pdf->isInitialised())
+      GetHandler(analysis)->checkpoints->addEventCounter(pdf);
     cout << "MCgrid::PDFHandler::BookPDF Added subprocess PDF " << params.name;
     cout << ", hash: " << hashval << endl;
     return pdf;
   }
 
+  bool PDFHandler::IsBooked(std::string const& name)
+  {
+    if (handlerInstance == 0)
+      return false;
+    const int hashval = hash_str(name.c_str());
+    return handlerInstance.load()->pdfMap.find(hashval) != handlerInstance.load()->pdfMap.end();
+  }
+
   void PDFHandler::HandleEvent(Rivet::Event const& event, std::string const& analysis)
   {
     // Check if we are using the right analysis
@@ -418,10 +605,27 @@ namespace MCgrid
 
   void PDFHandler::HandleEvent(Rivet::Event const& event)
   {
+    FillInfoCache().nextEvent();
+    if (GetHandler()->recorder != NULL)
+      GetHandler()->recorder->recordCountedEvent(event);
+
+    HandleRecordedEvent(pdgToLHA(event.genEvent()->pdf_info()->id1()),
+                        pdgToLHA(event.genEvent()->pdf_info()->id2()),
+                        event.weight());
+  }
+
+  // A checkpoint is taken before the event is counted, and hence before any
+  // of its fills
+  void PDFHandler::HandleRecordedEvent(const int fl1, const int fl2, const double weight)
+  {
+    if (GetHandler()->checkpoints != NULL)
+      GetHandler()->checkpoints->handleEvent(GetHandler()->nEvents.load());
     GetHandler()->nEvents++;
+    double sum = GetHandler()->sumOfWeights.load();
+    while (!GetHandler()->sumOfWeights.compare_exchange_weak(sum, sum + weight));
     for (std::map<int,mcgrid_base_pdf*>::iterator iCount = GetHandler()->pdfMap.begin(); iCount != GetHandler()->pdfMap.end(); iCount++)
       if (!(*iCount).second->isInitialised())
-        (*iCount).second->CountEvent(pdgToLHA(event.genEvent()->pdf_info()->id1()),pdgToLHA(event.genEvent()->pdf_info()->id2()));
+        (*iCount).second->CountEvent(fl1, fl2);
   }
 
 }
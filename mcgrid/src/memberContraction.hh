@@ -0,0 +1,51 @@
+//
+//  memberContraction.hh
+//  MCgrid 17/10/2026.
+//
+
+#ifndef mcgrid_member_contraction_hh
+#define mcgrid_member_contraction_hh
+
+#include <vector>
+
+#include "mcgrid/mcgrid_convolution.hh"
+#include "pdfNodeTable.hh"
+
+namespace MCgrid {
+
+  /**
+   * MCgrid::memberContraction computes the predictions of a whole block of
+   * PDF members in one pass over the coefficients of a grid, instead of one
+   * convolution by the grid library per member. A grid backend provides it
+   * if it can read the coefficients of its grid.
+   **/
+  class memberContraction
+  {
+  public:
+    virtual ~memberContraction() {};
+
+    // Whether a scale choice can be contracted, otherwise the grid library
+    // has to convolute each member
+    virtual bool supports(scaleFactors const& scales, const int nLoops) const = 0;
+
+    // The (x, Q) and alpha_s nodes a block has to be tabulated on for the
+    // given scale choices, which share their factorisation scale factor
+    virtual void nodes(std::vector<scaleFactors> const& scales,
+                       std::vector<pdfNode>& xfxNodeList,
+                       std::vector<double>& alphasNodeList) const = 0;
+
+    virtual size_t nBins() const = 0;
+
+    // The predictions of all members of a block in one bin, indexed by scale
+    // choice and member. The scale choices share their factorisation scale
+    // factor, and the block has to be tabulated on their nodes. Bins can be
+    // contracted by several threads at once
+    virtual std::vector< std::vector<double> > contract(pdfMemberBlockTable const& block,
+                                                        std::vector<scaleFactors> const& scales,
+                                                        const int nLoops,
+                                                        const size_t bin) const = 0;
+  };
+
+}
+
+#endif
@@ -0,0 +1,430 @@
+//
+//  merge.cpp
+//  MCgrid 17/10/2026.
+//
+
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <algorithm>
+#include <stdint.h>
+
+// System
+#include "config.h"
+
+#include "mcgrid/mcgrid_merge.hh"
+#include "runInfo.hh"
+#include "threading.hh"
+#include "phasespaceExtent.hh"
+
+// Interface-specific includes
+#if APPLGRID_ENABLED
+#include "appl_grid/appl_grid.h"
+#endif
+#if FASTNLO_ENABLED
+#include "fastnlotk/fastNLOTable.h"
+#endif
+
+using std::cerr;
+using std::cout;
+using std::endl;
+
+namespace MCgrid
+{
+  // ************************ Utility Functions ****************************
+
+  static bool hasExtension(std::string const& path, std::string const& extension)
+  {
+    return path.size() > extension.size()
+        && path.compare(path.size() - extension.size(), extension.size(), extension) == 0;
+  }
+
+  /*
+   *  Sum the grids produced by a merger over the input files. Each thread sums
+   *  a contiguous range of inputs, loading one grid at a time, then the
+   *  partial sums are added pairwise. Grids are freed through the merger,
+   *  which serialises whatever the grid interface cannot do concurrently.
+   */
+  template<class merger>
+  typename merger::gridType* reduceGrids(std::vector<std::string> const& inputFiles,
+                                         const int nThreads,
+                                         merger const& m)
+  {
+    typedef typename merger::gridType gridType;
+
+    const int nRanges = std::max(1, std::min(nThreads, (int)inputFiles.size()));
+    std::vector<gridType*> partial(nRanges, (gridType*)NULL);
+
+    std::vector<std::thread> workers;
+    for (int r=0; r<nRanges; r++) {
+      workers.push_back(std::thread([&, r]() {
+        const size_t begin = (r * inputFiles.size()) / nRanges;
+        const size_t end = ((r + 1) * inputFiles.size()) / nRanges;
+        for (size_t i=begin; i<end; i++) {
+          gridType* grid = m.load(i);
+          if (partial[r] == NULL) {
+            partial[r] = grid;
+          } else {
+            m.add(*partial[r], *grid);
+            m.release(grid);
+          }
+        }
+      }));
+    }
+    for (size_t i(0); i<workers.size(); i++)
+      workers[i].join();
+
+    for (int stride=1; stride<nRanges; stride*=2) {
+      workers.clear();
+      for (int r=0; r+stride<nRanges; r+=2*stride) {
+        workers.push_back(std::thread([&, r, stride]() {
+          m.add(*partial[r], *partial[r + stride]);
+          m.release(partial[r + stride]);
+          partial[r + stride] = NULL;
+        }));
+      }
+      for (size_t i(0); i<workers.size(); i++)
+        workers[i].join();
+    }
+
+    return partial[0];
+  }
+
+  // Read the event counts of all inputs. Returns false if none are available
+  static bool readEventCounts(std::vector<std::string> const& inputFiles,
+                              std::vector<uint64_t>& nEvents)
+  {
+    nEvents.assign(inputFiles.size(), 0);
+    size_t nFound(0);
+    for (size_t i(0); i<inputFiles.size(); i++) {
+      runInfo info;
+      if (readRunInfo(inputFiles[i], info)) {
+        nEvents[i] = info.nEvents;
+        nFound++;
+      }
+    }
+
+    if (nFound != 0 && nFound != inputFiles.size()) {
+      cerr << "MCgrid::Error - Run information is only available for some of the grids to be merged." << endl;
+      cerr << "                Please make sure that each grid comes with its .runinfo file." << endl;
+      exit(-1);
+    }
+    return (nFound != 0);
+  }
+
+  // ************************ APPLgrid merging ****************************
+
+#if APPLGRID_ENABLED
+  class applMerger
+  {
+  public:
+    typedef appl::grid gridType;
+
+    applMerger(std::vector<std::string> const& _inputFiles,
+               std::vector<uint64_t> const& _nEvents,
+               const uint64_t _nEventsTotal):
+      inputFiles(_inputFiles),
+      nEvents(_nEvents),
+      nEventsTotal(_nEventsTotal)
+    {}
+
+    // Load a grid and weight it with its fraction of the total event count.
+    // Reading a grid and creating or deleting its ROOT histograms goes
+    // through ROOT's global object lists, which is why it holds
+    // gridFileMutex. The arithmetic only touches the coefficients and
+    // histograms of the grids involved, which belong to one thread.
+    appl::grid* load(const size_t i) const
+    {
+      appl::grid* grid;
+      {
+        std::lock_guard<std::mutex> lock(gridFileMutex());
+        grid = new appl::grid(inputFiles[i]);
+      }
+
+      double weight = (double)nEvents[i] / (double)nEventsTotal;
+      if (grid->run() != 0)
+        weight /= grid->run();
+      *grid *= weight;
+      grid->run() = 1;
+      return grid;
+    }
+
+    void add(appl::grid& target, appl::grid const& source) const
+    {
+      target += source;
+    }
+
+    void release(appl::grid* grid) const
+    {
+      std::lock_guard<std::mutex> lock(gridFileMutex());
+      delete grid;
+    }
+
+  private:
+    std::vector<std::string> const& inputFiles;
+    std::vector<uint64_t> const& nEvents;
+    const uint64_t nEventsTotal;
+  };
+
+  static void mergeAPPLgrids(std::vector<std::string> const& inputFiles,
+                             std::string const& outputFile,
+                             const int nThreads,
+                             const bool assumeEqualEventCounts)
+  {
+    std::vector<uint64_t> nEvents;
+    if (!readEventCounts(inputFiles, nEvents)) {
+      if (!assumeEqualEventCounts) {
+        cerr << "MCgrid::Error - No run information (.runinfo) found for the grids to be merged." << endl;
+        cerr << "                Grids of runs with equal event counts can be merged with --equal-weights." << endl;
+        exit(-1);
+      }
+      cout << "MCgrid: No run information found, assuming equal event counts for all grids." << endl;
+      nEvents.assign(inputFiles.size(), 1);
+    }
+
+    uint64_t nEventsTotal(0);
+    for (size_t i(0); i<nEvents.size(); i++)
+      nEventsTotal += nEvents[i];
+    if (nEventsTotal == 0) {
+      cerr << "MCgrid::Error - The grids to be merged have not been filled with any events." << endl;
+      exit(-1);
+    }
+
+    applMerger m(inputFiles, nEvents, nEventsTotal);
+    appl::grid* merged = reduceGrids(inputFiles, nThreads, m);
+
+    // The additions have also summed the unit normalisations
+    merged->run() = 1;
+    merged->setNormalised(false);
+    merged->Write(outputFile);
+    delete merged;
+
+    runInfo info;
+    info.nEvents = nEventsTotal;
+    exportRunInfo(outputFile, info);
+  }
+#endif
+
+  // ************************ fastNLO merging ****************************
+
+#if FASTNLO_ENABLED
+  /*
+   *  fastNLO tables are plain C++ objects read with std::ifstream, without
+   *  global state besides the verbosity of fastNLO's message output. Each
+   *  table is only used by the thread that loaded it, or by the pairwise
+   *  reduction after that thread has been joined, so no lock is needed.
+   */
+  class fastnloMerger
+  {
+  public:
+    typedef fastNLOTable gridType;
+
+    fastnloMerger(std::vector<std::string> const& _inputFiles):
+      inputFiles(_inputFiles)
+    {}
+
+    fastNLOTable* load(const size_t i) const
+    {
+      return new fastNLOTable(inputFiles[i]);
+    }
+
+    // AddTable weights the contributions by their event counts
+    void add(fastNLOTable& target, fastNLOTable const& source) const
+    {
+      target.AddTable(source);
+    }
+
+    void release(fastNLOTable* table) const
+    {
+      delete table;
+    }
+
+  private:
+    std::vector<std::string> const& inputFiles;
+  };
+
+  static void mergeFastNLOTables(std::vector<std::string> const& inputFiles,
+                                 std::string const& outputFile,
+                                 const int nThreads)
+  {
+    fastnloMerger m(inputFiles);
+    fastNLOTable* merged = reduceGrids(inputFiles, nThreads, m);
+    merged->SetFilename(outputFile);
+    merged->WriteTable();
+    delete merged;
+
+    std::vector<uint64_t> nEvents;
+    if (readEventCounts(inputFiles, nEvents)) {
+      runInfo info;
+      for (size_t i(0); i<nEvents.size(); i++)
+        info.nEvents += nEvents[i];
+      exportRunInfo(outputFile, info);
+    }
+  }
+#endif
+
+  // ************************ Public interface ****************************
+
+  void mergeGrids(std::vector<std::string> const& inputFiles,
+                  std::string const& outputFile,
+                  const int nThreads,
+                  const bool assumeEqualEventCounts)
+  {
+    if (inputFiles.empty()) {
+      cerr << "MCgrid::Error - No grids given to be merged." << endl;
+      exit(-1);
+    }
+
+    cout << "MCgrid: Merging " << inputFiles.size() << " grids into " << outputFile;
+    cout << " using " << std::max(1, nThreads) << " thread(s)" << endl;
+
+#if APPLGRID_ENABLED
+    if (hasExtension(outputFile, ".root")) {
+      mergeAPPLgrids(inputFiles, outputFile, nThreads, assumeEqualEventCounts);
+      cout << "MCgrid: Merge Complete" << endl;
+      return;
+    }
+#endif
+#if FASTNLO_ENABLED
+    if (hasExtension(outputFile, ".tab")) {
+      mergeFastNLOTables(inputFiles, outputFile, nThreads);
+      cout << "MCgrid: Merge Complete" << endl;
+      return;
+    }
+#endif
+
+    cerr << "MCgrid::Error - Unable to determine the grid interface for " << outputFile << "." << endl;
+    cerr << "                Is this version of MCgrid configured for use with this grid interface?" << endl;
+    exit(-1);
+  }
+
+  // ********************** Event counter merging **************************
+
+  // Contents of an .evtcount file, see mcgrid_base_pdf::Export
+  struct eventCounts
+  {
+    std::string pdfname;
+    std::vector<uint64_t> nSubEvents;
+    std::vector< std::vector<uint64_t> > nSubPairEvents;
+  };
+
+  static void readEventCountFile(std::string const& path, eventCounts& counts)
+  {
+    std::ifstream datastream(path.c_str());
+    if (!datastream.good()) {
+      cerr << "MCgrid::Error - Unable to read event counter file " << path << "." << endl;
+      exit(-1);
+    }
+
+    int nSubprocesses;
+    datastream >> counts.pdfname >> nSubprocesses;
+    if (datastream.fail() || nSubprocesses < 0) {
+      cerr << "MCgrid::Error - Event counter information in " << path << " is incorrectly formatted." << endl;
+      exit(-1);
+    }
+
+    std::string teststr;
+    int testint;
+    std::vector<int> nPairs(nSubprocesses, 0);
+    counts.nSubEvents.assign(nSubprocesses, 0);
+    for (int i=0; i<nSubprocesses; i++)
+      datastream >> teststr >> testint >> teststr >> nPairs[i] >> teststr >> counts.nSubEvents[i];
+
+    counts.nSubPairEvents.resize(nSubprocesses);
+    for (int i=0; i<nSubprocesses; i++) {
+      datastream >> teststr >> testint;
+      counts.nSubPairEvents[i].assign(nPairs[i], 0);
+      for (int j=0; j<nPairs[i]; j++)
+        datastream >> counts.nSubPairEvents[i][j];
+    }
+
+    if (datastream.fail()) {
+      cerr << "MCgrid::Error - Event counter information in " << path << " is incorrectly formatted." << endl;
+      exit(-1);
+    }
+  }
+
+  void mergeEventCounts(std::vector<std::string> const& inputFiles,
+                        std::string const& outputFile)
+  {
+    if (inputFiles.empty()) {
+      cerr << "MCgrid::Error - No event counter files given to be merged." << endl;
+      exit(-1);
+    }
+
+    eventCounts merged;
+    readEventCountFile(inputFiles[0], merged);
+
+    for (size_t k(1); k<inputFiles.size(); k++) {
+      eventCounts counts;
+      readEventCountFile(inputFiles[k], counts);
+
+      bool isConsistent = (counts.pdfname == merged.pdfname
+                           && counts.nSubEvents.size() == merged.nSubEvents.size());
+      for (size_t i(0); isConsistent && i<counts.nSubEvents.size(); i++)
+        isConsistent = (counts.nSubPairEvents[i].size() == merged.nSubPairEvents[i].size());
+      if (!isConsistent) {
+        cerr << "MCgrid::Error - Event counter information in " << inputFiles[k];
+        cerr << " is inconsistent with " << inputFiles[0] << "." << endl;
+        exit(-1);
+      }
+
+      for (size_t i(0); i<counts.nSubEvents.size(); i++) {
+        merged.nSubEvents[i] += counts.nSubEvents[i];
+        for (size_t j(0); j<counts.nSubPairEvents[i].size(); j++)
+          merged.nSubPairEvents[i][j] += counts.nSubPairEvents[i][j];
+      }
+    }
+
+    // Same format as mcgrid_base_pdf::Export
+    std::ofstream file(outputFile.c_str());
+    file << merged.pdfname << endl;
+    file << merged.nSubEvents.size() << endl;
+
+    for (size_t i(0); i<merged.nSubEvents.size(); i++) {
+      file << "SubProc: "<< i;
+      file << " Pairs: " << merged.nSubPairEvents[i].size();
+      file << " SubEvents: " << merged.nSubEvents[i] << endl;
+    }
+
+    for (size_t i(0); i<merged.nSubEvents.size(); i++) {
+      file << "Subproc: " << i << "  ";
+      for (size_t j(0); j<merged.nSubPairEvents[i].size(); j++)
+        file << merged.nSubPairEvents[i][j] << "  ";
+      file << endl;
+    }
+
+    cout << "MCgrid: Merged " << inputFiles.size() << " event counter files into " << outputFile << endl;
+  }
+
+  // ********************** Phase space extent merging ***********************
+
+  void mergePhasespaceExtents(std::vector<std::string> const& inputFiles,
+                              std::string const& outputFile)
+  {
+    if (inputFiles.empty()) {
+      cerr << "MCgrid::Error - No phase space extent files given to be merged." << endl;
+      exit(-1);
+    }
+
+    phasespaceExtent merged;
+    for (size_t k(0); k<inputFiles.size(); k++) {
+      phasespaceExtent extent;
+      if (!phasespaceExtent::read(inputFiles[k], extent)) {
+        cerr << "MCgrid::Error - Unable to read phase space extent file " << inputFiles[k] << "." << endl;
+        exit(-1);
+      }
+      if (k > 0 && extent.numberOfBins() != merged.numberOfBins()) {
+        cerr << "MCgrid::Error - Phase space extent information in " << inputFiles[k];
+        cerr << " is inconsistent with " << inputFiles[0] << "." << endl;
+        exit(-1);
+      }
+      merged.merge(extent);
+    }
+    merged.write(outputFile);
+
+    cout << "MCgrid: Merged " << inputFiles.size() << " phase space extent files into " << outputFile << endl;
+  }
+}
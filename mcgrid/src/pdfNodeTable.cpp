@@ -0,0 +1,217 @@
+//
+//  pdfNodeTable.cpp
+//  MCgrid 17/10/2026.
+//
+
+#include "pdfNodeTable.hh"
+#include "exportQueue.hh"
+
+#include <iostream>
+#include <cstdlib>
+#include <thread>
+#include <algorithm>
+
+#include "LHAPDF/LHAPDF.h"
+
+using std::cerr;
+using std::endl;
+
+namespace MCgrid {
+
+  // Each table has its own PDF objects, such that tables can be used by
+  // different threads at the same time
+  static LHAPDF::PDF* loadMember(std::string const& pdfSet, const int member)
+  {
+    LHAPDF::PDF* pdf = LHAPDF::mkPDF(pdfSet, member);
+    if (pdf == NULL) {
+      cerr << "MCgrid::Error - Unable to load member " << member << " of the PDF set " << pdfSet << "." << endl;
+      stopOnError("unable to load " + pdfSet);
+    }
+    return pdf;
+  }
+
+  // ************************** pdfNodeTable ******************************
+
+  pdfNodeTable::pdfNodeTable(std::string const& pdfSet, const int member):
+    pdf(loadMember(pdfSet, member))
+  { }
+
+  pdfNodeTable::~pdfNodeTable()
+  {
+    delete pdf;
+  }
+
+  const double* pdfNodeTable::xfx(const double x, const double Q)
+  {
+    const pdfNode key(x, Q);
+    std::unordered_map<pdfNode, std::vector<double>, pdfNodeHash>::iterator node = xfxNodes.find(key);
+    if (node == xfxNodes.end()) {
+      node = xfxNodes.insert(std::make_pair(key, std::vector<double>(nPartons))).first;
+      pdf->xfxQ2(x, Q*Q, node->second);
+    }
+    return &node->second[0];
+  }
+
+  double pdfNodeTable::alphas(const double Q)
+  {
+    std::unordered_map<double, double>::const_iterator node = alphasNodes.find(Q);
+    if (node != alphasNodes.end())
+      return node->second;
+    const double value = pdf->alphasQ(Q);
+    alphasNodes[Q] = value;
+    return value;
+  }
+
+  void pdfNodeTable::nodes(std::vector<pdfNode>& xfxNodeList, std::vector<double>& alphasNodeList) const
+  {
+    xfxNodeList.clear();
+    xfxNodeList.reserve(xfxNodes.size());
+    for (std::unordered_map<pdfNode, std::vector<double>, pdfNodeHash>::const_iterator node = xfxNodes.begin();
+         node != xfxNodes.end(); ++node)
+      xfxNodeList.push_back(node->first);
+
+    alphasNodeList.clear();
+    alphasNodeList.reserve(alphasNodes.size());
+    for (std::unordered_map<double, double>::const_iterator node = alphasNodes.begin();
+         node != alphasNodes.end(); ++node)
+      alphasNodeList.push_back(node->first);
+  }
+
+  const double* pdfNodeTable::tabulatedXfx(const double x, const double Q) const
+  {
+    std::unordered_map<pdfNode, std::vector<double>, pdfNodeHash>::const_iterator node = xfxNodes.find(pdfNode(x, Q));
+    return (node != xfxNodes.end()) ? &node->second[0] : NULL;
+  }
+
+  bool pdfNodeTable::tabulatedAlphas(const double Q, double& value) const
+  {
+    std::unordered_map<double, double>::const_iterator node = alphasNodes.find(Q);
+    if (node == alphasNodes.end())
+      return false;
+    value = node->second;
+    return true;
+  }
+
+  // ************************ pdfNodeTableView ****************************
+
+  pdfNodeTable& pdfNodeTableView::ownTable()
+  {
+    if (table == NULL)
+      table = createTable();
+    return *table;
+  }
+
+  const double* pdfNodeTableView::xfx(const double x, const double Q)
+  {
+    const double* values = shared.tabulatedXfx(x, Q);
+    return (values != NULL) ? values : ownTable().xfx(x, Q);
+  }
+
+  double pdfNodeTableView::alphas(const double Q)
+  {
+    double value;
+    return shared.tabulatedAlphas(Q, value) ? value : ownTable().alphas(Q);
+  }
+
+  // *********************** pdfMemberBlockTable **************************
+
+  /*
+   *  The members of the block are split into nThreads ranges, and each
+   *  thread passes once over all nodes, evaluating its members at each.
+   */
+  pdfMemberBlockTable::pdfMemberBlockTable(std::string const& pdfSet,
+                                           const int firstMember,
+                                           const int _nMembers,
+                                           std::vector<pdfNode> const& xfxNodeList,
+                                           std::vector<double> const& alphasNodeList,
+                                           const int nThreads):
+    nMembers(_nMembers),
+    xfxValues(xfxNodeList.size() * _nMembers * pdfNodes::nPartons),
+    alphasValues(alphasNodeList.size() * _nMembers)
+  {
+    for (int i(0); i<nMembers; i++) {
+      pdfs.push_back(loadMember(pdfSet, firstMember + i));
+      members.push_back(new memberNodes(*this, i, pdfs.back()));
+    }
+
+    for (size_t i(0); i<xfxNodeList.size(); i++)
+      xfxIndex[xfxNodeList[i]] = i;
+    for (size_t i(0); i<alphasNodeList.size(); i++)
+      alphasIndex[alphasNodeList[i]] = i;
+
+    const int nRanges = std::max(1, std::min(nThreads, nMembers));
+    std::vector<std::thread> workers;
+    for (int r=0; r<nRanges; r++) {
+      workers.push_back(std::thread([&, r]() {
+        const int begin = (r * nMembers) / nRanges;
+        const int end = ((r + 1) * nMembers) / nRanges;
+        std::vector<double> values(pdfNodes::nPartons);
+        for (size_t node(0); node<xfxNodeList.size(); node++) {
+          const double x = xfxNodeList[node].x;
+          const double Q2 = xfxNodeList[node].Q * xfxNodeList[node].Q;
+          for (int m=begin; m<end; m++) {
+            pdfs[m]->xfxQ2(x, Q2, values);
+            for (int parton(0); parton<pdfNodes::nPartons; parton++)
+              xfxValues[(node*pdfNodes::nPartons + parton)*nMembers + m] = values[parton];
+          }
+        }
+        for (size_t node(0); node<alphasNodeList.size(); node++)
+          for (int m=begin; m<end; m++)
+            alphasValues[node*nMembers + m] = pdfs[m]->alphasQ(alphasNodeList[node]);
+      }));
+    }
+    for (size_t i(0); i<workers.size(); i++)
+      workers[i].join();
+  }
+
+  pdfMemberBlockTable::~pdfMemberBlockTable()
+  {
+    for (size_t i(0); i<members.size(); i++) {
+      delete members[i];
+      delete pdfs[i];
+    }
+  }
+
+  int pdfMemberBlockTable::membersPerBlock(const size_t nNodes)
+  {
+    const size_t memberBytes = std::max((size_t)1, nNodes) * pdfNodes::nPartons * sizeof(double);
+    return (int)std::max((size_t)1, maxBytes / memberBytes);
+  }
+
+  const double* pdfMemberBlockTable::xfxBlock(const double x, const double Q) const
+  {
+    std::unordered_map<pdfNode, size_t, pdfNodeHash>::const_iterator node = xfxIndex.find(pdfNode(x, Q));
+    if (node == xfxIndex.end())
+      return NULL;
+    return &xfxValues[node->second*pdfNodes::nPartons*nMembers];
+  }
+
+  const double* pdfMemberBlockTable::alphasBlock(const double Q) const
+  {
+    std::unordered_map<double, size_t>::const_iterator node = alphasIndex.find(Q);
+    if (node == alphasIndex.end())
+      return NULL;
+    return &alphasValues[node->second*nMembers];
+  }
+
+  // The partons of a member are strided by the block size, so they are
+  // gathered into the buffer of the member
+  const double* pdfMemberBlockTable::memberNodes::xfx(const double x, const double Q)
+  {
+    const double* block = table.xfxBlock(x, Q);
+    if (block == NULL) {
+      pdf->xfxQ2(x, Q*Q, values);
+      return &values[0];
+    }
+    for (int parton(0); parton<nPartons; parton++)
+      values[parton] = block[parton*table.nMembers + member];
+    return &values[0];
+  }
+
+  double pdfMemberBlockTable::memberNodes::alphas(const double Q)
+  {
+    const double* block = table.alphasBlock(Q);
+    return (block != NULL) ? block[member] : pdf->alphasQ(Q);
+  }
+
+}
@@ -0,0 +1,193 @@
+//
+//  pdfNodeTable.hh
+//  MCgrid 17/10/2026.
+//
+
+#ifndef mcgrid_pdf_node_table_hh
+#define mcgrid_pdf_node_table_hh
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <stdint.h>
+#include <cstring>
+
+namespace LHAPDF {
+  class PDF;
+}
+
+namespace MCgrid {
+
+  // An (x, Q) node, identified by the exact bit patterns of its coordinates
+  struct pdfNode
+  {
+    pdfNode(const double _x, const double _Q): x(_x), Q(_Q) {};
+    bool operator==(pdfNode const& other) const
+    {
+      return std::memcmp(this, &other, sizeof(pdfNode)) == 0;
+    };
+    double x;
+    double Q;
+  };
+
+  struct pdfNodeHash
+  {
+    size_t operator()(pdfNode const& node) const
+    {
+      uint64_t x, Q;
+      std::memcpy(&x, &node.x, sizeof(double));
+      std::memcpy(&Q, &node.Q, sizeof(double));
+      return std::hash<uint64_t>()(x ^ (Q + 0x9e3779b97f4a7c15ULL + (x << 6) + (x >> 2)));
+    };
+  };
+
+  /**
+   * MCgrid::pdfNodes is the interface through which a convolution obtains
+   * x*f(x, Q) of all partons (-6 ... 6, in the LHAPDF/APPLgrid order with
+   * the gluon at index 6) and alpha_s(Q) of one PDF member
+   **/
+  class pdfNodes
+  {
+  public:
+    virtual ~pdfNodes() {};
+
+    static const int nPartons = 13;
+
+    virtual const double* xfx(const double x, const double Q) = 0;
+    virtual double alphas(const double Q) = 0;
+  };
+
+  /**
+   * MCgrid::pdfNodeTable tabulates one member of an LHAPDF6 set. Entries
+   * are evaluated on first request and kept, so the PDFs are evaluated once
+   * per node of the grid instead of once per node and convolution. A table
+   * is used by one thread only.
+   **/
+  class pdfNodeTable: public pdfNodes
+  {
+  public:
+    pdfNodeTable(std::string const& pdfSet, const int member);
+    ~pdfNodeTable();
+
+    const double* xfx(const double x, const double Q);
+    double alphas(const double Q);
+
+    // Number of (x, Q) nodes evaluated so far
+    size_t nNodes() const { return xfxNodes.size(); };
+
+    // The nodes evaluated so far
+    void nodes(std::vector<pdfNode>& xfxNodeList, std::vector<double>& alphasNodeList) const;
+
+    // Values of nodes evaluated so far, NULL or false if not evaluated yet
+    const double* tabulatedXfx(const double x, const double Q) const;
+    bool tabulatedAlphas(const double Q, double& value) const;
+
+  private:
+    pdfNodeTable(pdfNodeTable const&);
+    pdfNodeTable& operator=(pdfNodeTable const&);
+
+    LHAPDF::PDF* pdf;
+    std::unordered_map<pdfNode, std::vector<double>, pdfNodeHash> xfxNodes;
+    std::unordered_map<double, double> alphasNodes;
+  };
+
+  /**
+   * MCgrid::pdfNodeTableView reads from a pdfNodeTable that is no longer
+   * being filled, such that several threads can share it. Nodes missing from
+   * the shared table are evaluated by a table of the view, which is created
+   * on first use.
+   **/
+  class pdfNodeTableView: public pdfNodes
+  {
+  public:
+    pdfNodeTableView(pdfNodeTable const& _shared,
+                     std::function<pdfNodeTable*()> const& _createTable):
+      shared(_shared), createTable(_createTable), table(NULL) {};
+    ~pdfNodeTableView() { delete table; };
+
+    const double* xfx(const double x, const double Q);
+    double alphas(const double Q);
+
+  private:
+    pdfNodeTableView(pdfNodeTableView const&);
+    pdfNodeTableView& operator=(pdfNodeTableView const&);
+
+    pdfNodeTable& ownTable();
+
+    pdfNodeTable const& shared;
+    const std::function<pdfNodeTable*()> createTable;
+    pdfNodeTable* table;
+  };
+
+  /**
+   * MCgrid::pdfMemberBlockTable tabulates a block of consecutive members of
+   * an LHAPDF6 set on a given list of nodes, in one pass over the nodes. The
+   * values of a node are stored parton by parton, with the members of the
+   * block innermost, such that a contraction over the grid coefficients can
+   * run over all members at once. Nodes that are not in the list are
+   * evaluated directly by the member interface, without being kept.
+   **/
+  class pdfMemberBlockTable
+  {
+  public:
+    pdfMemberBlockTable(std::string const& pdfSet,
+                        const int firstMember,
+                        const int nMembers,
+                        std::vector<pdfNode> const& xfxNodeList,
+                        std::vector<double> const& alphasNodeList,
+                        const int nThreads);
+    ~pdfMemberBlockTable();
+
+    // Member `firstMember + i` of the block. Each member is used by one
+    // thread at a time.
+    pdfNodes& member(const int i) { return *members[i]; };
+
+    int size() const { return nMembers; };
+
+    // The values of all members at a node of the list, indexed by parton and
+    // member, or NULL if the node is not in the list
+    const double* xfxBlock(const double x, const double Q) const;
+
+    // alpha_s of all members at a node of the list, or NULL
+    const double* alphasBlock(const double Q) const;
+
+    // Bytes the PDF values of a block may take in memory
+    static const size_t maxBytes = size_t(1) << 28;
+
+    // Number of members of a block on the given number of nodes, such that
+    // the block stays below maxBytes
+    static int membersPerBlock(const size_t nNodes);
+
+  private:
+    pdfMemberBlockTable(pdfMemberBlockTable const&);
+    pdfMemberBlockTable& operator=(pdfMemberBlockTable const&);
+
+    class memberNodes: public pdfNodes
+    {
+    public:
+      memberNodes(pdfMemberBlockTable const& _table, const int _member, LHAPDF::PDF* _pdf):
+        table(_table), member(_member), pdf(_pdf), values(nPartons) {};
+
+      const double* xfx(const double x, const double Q);
+      double alphas(const double Q);
+
+    private:
+      pdfMemberBlockTable const& table;
+      const int member;
+      LHAPDF::PDF* const pdf;
+      std::vector<double> values;   //!< Nodes that are not tabulated
+    };
+
+    const int nMembers;
+    std::vector<LHAPDF::PDF*> pdfs;
+    std::vector<memberNodes*> members;
+    std::unordered_map<pdfNode, size_t, pdfNodeHash> xfxIndex;
+    std::unordered_map<double, size_t> alphasIndex;
+    std::vector<double> xfxValues;       //!< [node][parton][member]
+    std::vector<double> alphasValues;    //!< [node][member]
+  };
+
+}
+
+#endif
@@ -0,0 +1,124 @@
+//
+//  phasespaceExtent.cpp
+//  MCgrid 17/10/2026.
+//
+
+#include "phasespaceExtent.hh"
+#include "exportQueue.hh"
+
+#include <iostream>
+#include <fstream>
+#include <limits>
+#include <cstdlib>
+
+using std::cerr;
+using std::endl;
+
+namespace MCgrid {
+
+  phasespaceExtent::binExtent::binExtent():
+  nEntries(0),
+  x1min(std::numeric_limits<double>::max()), x1max(0),
+  x2min(std::numeric_limits<double>::max()), x2max(0),
+  q2min(std::numeric_limits<double>::max()), q2max(0)
+  { }
+
+  void phasespaceExtent::merge(phasespaceExtent const& other)
+  {
+    if (other.bins.size() > bins.size())
+      bins.resize(other.bins.size());
+
+    for (size_t i(0); i < other.bins.size(); i++) {
+      binExtent const& source = other.bins[i];
+      if (source.nEntries == 0)
+        continue;
+      binExtent& target = bins[i];
+      target.nEntries += source.nEntries;
+      if (source.x1min < target.x1min) target.x1min = source.x1min;
+      if (source.x1max > target.x1max) target.x1max = source.x1max;
+      if (source.x2min < target.x2min) target.x2min = source.x2min;
+      if (source.x2max > target.x2max) target.x2max = source.x2max;
+      if (source.q2min < target.q2min) target.q2min = source.q2min;
+      if (source.q2max > target.q2max) target.q2max = source.q2max;
+    }
+  }
+
+  std::vector<phasespaceExtent::cornerPoint> phasespaceExtent::cornerPoints(const size_t i) const
+  {
+    std::vector<cornerPoint> corners;
+    if (i >= bins.size() || bins[i].nEntries == 0)
+      return corners;
+
+    binExtent const& extent = bins[i];
+    const double x1[2] = {extent.x1min, extent.x1max};
+    const double x2[2] = {extent.x2min, extent.x2max};
+    const double q2[2] = {extent.q2min, extent.q2max};
+    for (int a=0; a<2; a++)
+      for (int b=0; b<2; b++)
+        for (int c=0; c<2; c++) {
+          cornerPoint corner = {x1[a], x2[b], q2[c]};
+          corners.push_back(corner);
+        }
+    return corners;
+  }
+
+  void phasespaceExtent::write(std::string const& path) const
+  {
+    std::ofstream file(path.c_str());
+    file.precision(17);
+    file << bins.size() << endl;
+    for (size_t i(0); i < bins.size(); i++) {
+      binExtent const& extent = bins[i];
+      file << "Bin: " << i << " Entries: " << extent.nEntries;
+      if (extent.nEntries > 0) {
+        file << " X1: " << extent.x1min << " " << extent.x1max;
+        file << " X2: " << extent.x2min << " " << extent.x2max;
+        file << " Q2: " << extent.q2min << " " << extent.q2max;
+      }
+      file << endl;
+    }
+    if (!file.good()) {
+      cerr << "MCgrid::Error - Unable to write phase space extent information to " << path << "." << endl;
+      stopOnError("unable to write " + path);
+    }
+  }
+
+  bool phasespaceExtent::read(std::string const& path, phasespaceExtent& extent)
+  {
+    std::ifstream datastream(path.c_str());
+    if (!datastream.good())
+      return false;
+
+    size_t nBins;
+    datastream >> nBins;
+    extent.bins.assign(nBins, binExtent());
+
+    std::string teststr;
+    size_t testint;
+    for (size_t i(0); i < nBins && datastream.good(); i++) {
+      binExtent& bin = extent.bins[i];
+      datastream >> teststr >> testint >> teststr >> bin.nEntries;
+      if (testint != i) {
+        cerr << "MCgrid::Error - Phase space extent information in " << path << " is incorrectly formatted." << endl;
+        exit(-1);
+      }
+      if (bin.nEntries > 0) {
+        datastream >> teststr >> bin.x1min >> bin.x1max;
+        datastream >> teststr >> bin.x2min >> bin.x2max;
+        datastream >> teststr >> bin.q2min >> bin.q2max;
+      }
+    }
+
+    if (datastream.fail()) {
+      cerr << "MCgrid::Error - Phase space extent information in " << path << " is incorrectly formatted." << endl;
+      exit(-1);
+    }
+    return true;
+  }
+
+  std::string phasespaceExtent::filePath(std::string const& phasespaceFilePath)
+  {
+    return phasespaceFilePath + ".extent";
+  }
+
+}
@@ -0,0 +1,77 @@
+//
+//  phasespaceExtent.hh
+//  MCgrid 17/10/2026.
+//
+
+#ifndef mcgrid_phasespace_extent_hh
+#define mcgrid_phasespace_extent_hh
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace MCgrid {
+
+  /**
+   * MCgrid::phasespaceExtent records the range of x1, x2 and Q^2 filled into
+   * each observable bin during a warmup run. Unlike an optimised phase space
+   * grid, the extents of several warmup runs can simply be merged by taking
+   * their union. Replaying the corner points of a merged extent into a fresh
+   * warmup grid reproduces the phase space of the combined warmup.
+   **/
+  class phasespaceExtent
+  {
+  public:
+    struct binExtent
+    {
+      binExtent();
+
+      uint64_t nEntries;
+      double x1min, x1max;
+      double x2min, x2max;
+      double q2min, q2max;
+    };
+
+    struct cornerPoint
+    {
+      double x1, x2, q2;
+    };
+
+    // Record a fill into the given bin
+    void add(const size_t bin, const double x1, const double x2, const double q2)
+    {
+      if (bin >= bins.size())
+        bins.resize(bin + 1);
+      binExtent& extent = bins[bin];
+      extent.nEntries++;
+      if (x1 < extent.x1min) extent.x1min = x1;
+      if (x1 > extent.x1max) extent.x1max = x1;
+      if (x2 < extent.x2min) extent.x2min = x2;
+      if (x2 > extent.x2max) extent.x2max = x2;
+      if (q2 < extent.q2min) extent.q2min = q2;
+      if (q2 > extent.q2max) extent.q2max = q2;
+    };
+
+    // Take the union with another extent
+    void merge(phasespaceExtent const&);
+
+    size_t numberOfBins() const { return bins.size(); };
+    binExtent const& bin(const size_t i) const { return bins[i]; };
+
+    // The (up to eight) corners of the recorded range of a bin, or none if
+    // the bin has not been filled
+    std::vector<cornerPoint> cornerPoints(const size_t bin) const;
+
+    void write(std::string const& path) const;
+    static bool read(std::string const& path, phasespaceExtent&);
+
+    // The extent file belonging to a phase space grid file
+    static std::string filePath(std::string const& phasespaceFilePath);
+
+  private:
+    std::vector<binExtent> bins;
+  };
+
+}
+
+#endif
@@ -0,0 +1,96 @@
+//
+//  replay.cpp
+//  MCgrid 17/10/2026.
+//
+
+#include <thread>
+
+// System
+#include "config.h"
+
+#include "mcgrid/mcgrid_record.hh"
+#include "mcgrid/mcgrid_pdf.hh"
+#include "mcgrid.hh"
+#include "grid.hh"
+#include "eventRecord.hh"
+
+using Rivet::cerr;
+using Rivet::cout;
+using Rivet::endl;
+
+namespace MCgrid
+{
+  // Replay every nThreads-th chunk, starting at the given one
+  static void replayChunks(eventRecordReader const& reader,
+                           std::vector<_grid*> const& targets,
+                           const int firstChunk,
+                           const int nThreads)
+  {
+    setFillThreadSlot(firstChunk);
+
+    std::vector<recordedEvent> events;
+    eventWeightCache weightCache;
+    for (size_t chunk = firstChunk; chunk < reader.numberOfChunks(); chunk += nThreads) {
+      reader.readChunk(chunk, events);
+      for (size_t i(0); i < events.size(); i++) {
+        recordedEvent const& event = events[i];
+        if ((bool)(event.flags & recordSherpa) != (globalFillMode == FILL_SHERPA)) {
+          cerr << "MCgrid::Error - The event record has been written with another fill mode ";
+          cerr << "than the current " << fillString[globalFillMode] << " fill mode." << endl;
+          exit(-1);
+        }
+
+        if (event.flags & recordCounted)
+          PDFHandler::HandleRecordedEvent(event.info.fl1, event.info.fl2, event.info.wgt);
+
+        // The fills of an event share the subprocess weights of its info
+        weightCache.clear();
+        for (size_t j(0); j < event.fills.size(); j++) {
+          _grid* target = targets[event.fills[j].first];
+          if (target == NULL)
+            continue;
+          if (globalFillMode == FILL_SHERPA) {
+            target->fillFromInfo(event.fills[j].second, event.info, &weightCache);
+          } else {
+            target->fillFromInfo(event.fills[j].second, static_cast<fillInfo const&>(event.info), &weightCache);
+          }
+        }
+      }
+    }
+  }
+
+  void replayRecord(std::string const& recordFile,
+                    std::map<std::string, gridPtr> const& grids,
+                    const int nThreads)
+  {
+    if (nThreads < 1 || nThreads > maxFillThreads) {
+      cerr << "MCgrid::Error - Unable to replay an event record with " << nThreads << " threads." << endl;
+      exit(-1);
+    }
+
+    eventRecordReader reader(recordFile);
+    cout << "MCgrid: Replaying " << reader.numberOfChunks() << " chunks of the event record ";
+    cout << recordFile << " using " << nThreads << " thread(s)" << endl;
+
+    // Map the grid keys of the record to the booked grids. Disabled grids
+    // (see MCGRID_DISABLED) are not filled
+    std::vector<std::string> const& names = reader.gridNames();
+    std::vector<_grid*> targets(names.size(), (_grid*)NULL);
+    for (size_t i(0); i < names.size(); i++) {
+      std::map<std::string, gridPtr>::const_iterator it = grids.find(names[i]);
+      if (it != grids.end()) {
+        targets[i] = dynamic_cast<_grid*>(it->second.get());
+      } else {
+        cout << "MCgrid: Skipping grid " << names[i] << " of the event record" << endl;
+      }
+    }
+
+    std::vector<std::thread> workers;
+    for (int t=0; t<nThreads; t++)
+      workers.push_back(std::thread(replayChunks, std::cref(reader), std::cref(targets), t, nThreads));
+    for (size_t i(0); i < workers.size(); i++)
+      workers[i].join();
+
+    cout << "MCgrid: Replay Complete" << endl;
+  }
+}
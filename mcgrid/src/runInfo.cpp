@@ -0,0 +1,49 @@
+//
+//  runInfo.cpp
+//  MCgrid 17/10/2026.
+//
+
+#include "runInfo.hh"
+#include "exportQueue.hh"
+
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+
+using std::cerr;
+using std::endl;
+
+namespace MCgrid {
+
+  std::string runInfoFilePath(std::string const& gridFilePath)
+  {
+    return gridFilePath + ".runinfo";
+  }
+
+  void exportRunInfo(std::string const& gridFilePath, runInfo const& info)
+  {
+    std::ofstream file(runInfoFilePath(gridFilePath).c_str());
+    file << "NEvents: " << info.nEvents << endl;
+    if (!file.good()) {
+      cerr << "MCgrid::Error - Unable to write run information to " << runInfoFilePath(gridFilePath) << "." << endl;
+      stopOnError("unable to write " + runInfoFilePath(gridFilePath));
+    }
+  }
+
+  bool readRunInfo(std::string const& gridFilePath, runInfo& info)
+  {
+    std::ifstream file(runInfoFilePath(gridFilePath).c_str());
+    if (!file.good())
+      return false;
+
+    std::string key;
+    file >> key >> info.nEvents;
+    if (file.fail() || key != "NEvents:") {
+      cerr << "MCgrid::Error - Run information in " << runInfoFilePath(gridFilePath);
+      cerr << " is incorrectly formatted." << endl;
+      exit(-1);
+    }
+    return true;
+  }
+
+}
@@ -0,0 +1,37 @@
+//
+//  runInfo.hh
+//  MCgrid 17/10/2026.
+//
+
+#ifndef mcgrid_run_info_hh
+#define mcgrid_run_info_hh
+
+#include <string>
+#include <stdint.h>
+
+namespace MCgrid {
+
+  /**
+   * MCgrid::runInfo holds the run statistics that are needed to combine a
+   * grid with the grids of other independent runs. It is written next to
+   * each exported grid as `<grid file>.runinfo`.
+   **/
+  struct runInfo
+  {
+    runInfo(): nEvents(0) {}
+
+    uint64_t nEvents;   //!< Number of events the grid has been filled with
+  };
+
+  std::string runInfoFilePath(std::string const& gridFilePath);
+
+  // Write the run statistics for the given grid file
+  void exportRunInfo(std::string const& gridFilePath, runInfo const&);
+
+  // Read the run statistics for the given grid file, returns false if there
+  // are none
+  bool readRunInfo(std::string const& gridFilePath, runInfo&);
+
+}
+
+#endif
@@ -10,8 +10,6 @@
 #include "grid.hh"
 #include "sherpaFillInfo.hh"
 
-#include <sstream>
-
 // Rivet includes
 #include "Rivet/Rivet.hh"
 #include "Rivet/Event.hh"
@@ -26,42 +24,6 @@ using Rivet::cerr;
 using Rivet::cout;
 using Rivet::endl;
 
-// ************ Projection functions for collinear counterterms ***********
-// These functions multiply each flavour contribution for the counterterms.
-// Variables proj and a should have LHA flavour index (-top), i.e -5 to 5
-
-// Identity projection
-static inline void pi( const int a, double* proj)
-{
-  for (int i=-5; i<=5; i++ )
-    proj[i] = ( (i==a) ? 1:0 );
-  return;
-}
-
-// Corresponds to building f_a^1 = f_a(x_a) (a=quark), \sum_q f_q(x_a) (a=gluon)
-static inline void p1( const int a, double* proj )
-{
-  if ( a == 0 )
-  {
-    // Do not accidentally introduce initial state quarks that are inactive
-    for (int i=-numberOfActiveFlavors; i<=numberOfActiveFlavors; i++)
-      proj[i] = ( (i==0) ? 0:1 );
-  } else
-  {
-    for (int i=-5; i<=5; i++ )
-      proj[i] = ( (i==a) ? 1:0 );
-  }
-  return;
-}
-
-// Corresponds to building f_a^3 = f_g(x_a),
-static inline void p2( const int a, double* proj )
-{
-  for (int i=-5; i<=5; i++ )
-    proj[i] = ( (i==0) ? 1:0 );
-  return;
-}
-
 // ************************ SHERPA Fill Method ****************************
 
 /*
@@ -71,7 +33,7 @@ static inline void p2( const int a, double* proj )
  *  in SHERPA.
  */
 
-void _grid::sherpaFill( double coord, sherpaFillInfo const & info)
+void _grid::sherpaFill(subprocessWeights& weights, eventWeights& fills, sherpaFillInfo const & info)
 {
   const double norm = pdf->EventRatio(info.fl1, info.fl2);
 
@@ -81,8 +43,8 @@ void _grid::sherpaFill( double coord, sherpaFillInfo const & info)
     // LO(PS)
 
     fillInfo subInfo(info);
-    subInfo.wgt = info.usr_wgt["Reweight_B"];
-    sherpaBLikeFill(coord, norm, subInfo, LO);
+    subInfo.wgt = info.B;
+    sherpaBLikeFill(weights, fills, norm, subInfo, LO);
 
   } else {
     // NLO(PS)
@@ -90,38 +52,38 @@ void _grid::sherpaFill( double coord, sherpaFillInfo const & info)
     // NLO(PS) Born
     if (type & ReweightTypeB) {
       fillInfo subInfo(info);
-      subInfo.wgt = info.usr_wgt["Reweight_B"];
-      sherpaBLikeFill(coord, norm, subInfo, LO);
+      subInfo.wgt = info.B;
+      sherpaBLikeFill(weights, fills, norm, subInfo, LO);
     }
 
     // NLO(PS) VI
     if (type & ReweightTypeVI) {
       fillInfo subInfo(info);
-      subInfo.wgt = info.usr_wgt["Reweight_VI"];
-      sherpaBLikeFill(coord, norm, subInfo, NLO);
+      subInfo.wgt = info.VI;
+      sherpaBLikeFill(weights, fills, norm, subInfo, NLO);
       if (isUsingScaleLogGrids) {
-        subInfo.wgt = info.usr_wgt["Reweight_VI_wren_0"];
-        sherpaBLikeFill(coord, norm, subInfo, RenormalisationSingleLog);
+        subInfo.wgt = info.VI_wren_0;
+        sherpaBLikeFill(weights, fills, norm, subInfo, RenormalisationSingleLog);
       }
     }
 
     // NLO(PS) KP
     if (type & ReweightTypeKP) {
-      sherpaKPFill(coord, norm, info, NLO);
-      if (isUsingScaleLogGrids) sherpaKPFill(coord, norm, info, FactorisationSingleLog);
+      sherpaKPFill(weights, fills, norm, info, NLO);
+      if (isUsingScaleLogGrids) sherpaKPFill(weights, fills, norm, info, FactorisationSingleLog);
     }
 
     // NLOPS DADS terms
     if (type & ReweightTypeDADS) {
       for (size_t i(0); i < info.DADS_fill_infos.size(); i++) {
-        sherpaBLikeFill(coord, norm, info.DADS_fill_infos[i], NLO);
+        sherpaBLikeFill(weights, fills, norm, info.DADS_fill_infos[i], NLO);
       }
     }
 
     // NLOPS H
     if (type & ReweightTypeH) {
       for (size_t i(0); i < info.RDA_fill_infos.size(); i++) {
-        sherpaBLikeFill(coord, norm, info.RDA_fill_infos[i], NLO);
+        sherpaBLikeFill(weights, fills, norm, info.RDA_fill_infos[i], NLO);
       }
     }
 
@@ -132,15 +94,59 @@ void _grid::sherpaFill( double coord, sherpaFillInfo const & info)
       // are therefore incorrect. However, the latter are not used, we only
       // have to fix the scale.
       fillInfo subInfo(info);
-      subInfo.wgt =   info.usr_wgt["Reweight_RS"];
-      subInfo.pdfQ2 = info.usr_wgt["MuR2"];
-      sherpaBLikeFill(coord, norm, subInfo, NLO);
+      subInfo.wgt =   info.RS;
+      subInfo.pdfQ2 = info.MuR2;
+      sherpaBLikeFill(weights, fills, norm, subInfo, NLO);
+    }
+
+  }
+}
+
+/*
+ *  grid::sherpaRecordExtent
+ *  Records the phase space points at which sherpaFill would fill the grid,
+ *  as needed for a warmup run.
+ */
+
+void _grid::sherpaRecordExtent(double coord, sherpaFillInfo const & info)
+{
+  const ReweightType type(info.reweight_type);
+
+  // LO(PS), NLO(PS) Born and VI
+  if (type == ReweightTypeLO || (type & ReweightTypeB) || (type & ReweightTypeVI))
+    recordExtent(info.x1, info.x2, info.pdfQ2, coord);
+  if (type == ReweightTypeLO)
+    return;
+
+  // NLO(PS) KP, including the fills at x/x'
+  if (type & ReweightTypeKP) {
+    recordExtent(info.x1, info.x2, info.pdfQ2, coord);
+    recordExtent(info.x1/info.KP_x1p, info.x2, info.pdfQ2, coord);
+    recordExtent(info.x1, info.x2/info.KP_x2p, info.pdfQ2, coord);
+  }
+
+  // NLOPS DADS terms
+  if (type & ReweightTypeDADS) {
+    for (size_t i(0); i < info.DADS_fill_infos.size(); i++) {
+      fillInfo const& subInfo = info.DADS_fill_infos[i];
+      recordExtent(subInfo.x1, subInfo.x2, subInfo.pdfQ2, coord);
     }
+  }
 
+  // NLOPS H
+  if (type & ReweightTypeH) {
+    for (size_t i(0); i < info.RDA_fill_infos.size(); i++) {
+      fillInfo const& subInfo = info.RDA_fill_infos[i];
+      recordExtent(subInfo.x1, subInfo.x2, subInfo.pdfQ2, coord);
+    }
   }
+
+  // NLO RS, filled at the corrected scale
+  if (type & ReweightTypeRS)
+    recordExtent(info.x1, info.x2, info.MuR2, coord);
 }
 
-void _grid::sherpaBLikeFill(double coord, double norm, fillInfo const& info, termType type)
+void _grid::sherpaBLikeFill(subprocessWeights& weights, eventWeights& fills, double norm, fillInfo const& info, termType type)
 {
   const int ptord = perturbativeOrderForTermType(type);
   assert(ptord == 0 || ptord == 1); // Only NLO is supported
@@ -148,36 +154,28 @@ void _grid::sherpaBLikeFill(double coord, double norm, fillInfo const& info, ter
   const double asfac = pow(info.alphas * alphaSPrefactor, leadingOrder + ptord);
   const double meweight = norm * info.wgt / asfac;
 
-  zeroWeights();
-  fillWeight(info.fl1, info.fl2, meweight, false);
-  fillUnderlyingGrid(info.x1, info.x2, info.pdfQ2, coord, type);
+  zeroWeights(weights);
+  fillWeight(weights, info.fl1, info.fl2, meweight, false);
+  fills.add(weights, info.x1, info.x2, info.pdfQ2, type);
 }
 
-void _grid::sherpaKPFill(double coord, double norm, sherpaFillInfo const& info, termType type)
+void _grid::sherpaKPFill(subprocessWeights& weights, eventWeights& fills, double norm, sherpaFillInfo const& info, termType type)
 {
-  zeroWeights();
+  zeroWeights(weights);
   const int ptord = perturbativeOrderForTermType(type);
   assert(ptord == 1); // KP terms only are defined at this order
 
   const double asfac = pow(info.alphas * alphaSPrefactor, leadingOrder + ptord);
 
   // Read x-prime values
-  const double x1p = info.usr_wgt["Reweight_KP_x1p"];
-  const double x2p = info.usr_wgt["Reweight_KP_x2p"];
+  const double x1p = info.KP_x1p;
+  const double x2p = info.KP_x2p;
 
   // Prepare weights
+  const double *wfac = (type == FactorisationSingleLog) ? info.KP_wfac + 8 : info.KP_wfac;
   double w[8];
-  for (int i=0; i<8; i++) {
-    int key_index;
-    if (type == FactorisationSingleLog) {
-      key_index = i + 8;
-    } else {
-      key_index = i;
-    }
-    std::ostringstream key;
-    key << "Reweight_KP_wfac_" << key_index;
-    w[i] = norm * info.usr_wgt[key.str()] / asfac;
-  }
+  for (int i=0; i<8; i++)
+    w[i] = norm * wfac[i] / asfac;
 
   // Factors of xprime
   w[1]/=x1p;
@@ -187,29 +185,29 @@ void _grid::sherpaKPFill(double coord, double norm, sherpaFillInfo const& info,
 
   // First fill - untransformed x values
   // f_a^1 w_1 F_b(x_b) + f_a(x_a) w_5 F_b^1
-  projectWeights(info.fl1, info.fl2, w[0], p1, pi, false);
-  projectWeights(info.fl1, info.fl2, w[4], pi, p1, false);
+  projectWeights(weights, info.fl1, info.fl2, w[0], quarkSumProjector, identityProjector);
+  projectWeights(weights, info.fl1, info.fl2, w[4], identityProjector, quarkSumProjector);
 
   // f_a^3 w_3 F_b(x_b) + f_a(x_a)w_7 F_b^3
-  projectWeights(info.fl1, info.fl2, w[2], p2, pi, false);
-  projectWeights(info.fl1, info.fl2, w[6], pi, p2, false);
+  projectWeights(weights, info.fl1, info.fl2, w[2], gluonProjector, identityProjector);
+  projectWeights(weights, info.fl1, info.fl2, w[6], identityProjector, gluonProjector);
 
-  fillUnderlyingGrid(info.x1, info.x2, info.pdfQ2, coord, type);
+  fills.add(weights, info.x1, info.x2, info.pdfQ2, type);
 
   // Prepare for x1p fill
-  zeroWeights();
+  zeroWeights(weights);
 
   // f_a^2 w_2 F_b(x_b) + f_a^4 w_4 F_b(x_b)
-  projectWeights(info.fl1, info.fl2, w[1], p1, pi, false);
-  projectWeights(info.fl1, info.fl2, w[3], p2, pi, false);
-  fillUnderlyingGrid(info.x1/x1p, info.x2, info.pdfQ2, coord, type);
+  projectWeights(weights, info.fl1, info.fl2, w[1], quarkSumProjector, identityProjector);
+  projectWeights(weights, info.fl1, info.fl2, w[3], gluonProjector, identityProjector);
+  fills.add(weights, info.x1/x1p, info.x2, info.pdfQ2, type);
   
 
   // Prepare for x2p fill
-  zeroWeights();
+  zeroWeights(weights);
 
   // f_a(x_a) w_6 F_b^2 + f_a(x_a) w_8 F_b^4
-  projectWeights(info.fl1, info.fl2, w[5], pi, p1, false);
-  projectWeights(info.fl1, info.fl2, w[7], pi, p2, false);
-  fillUnderlyingGrid(info.x1, info.x2/x2p, info.pdfQ2, coord, type);    
+  projectWeights(weights, info.fl1, info.fl2, w[5], identityProjector, quarkSumProjector);
+  projectWeights(weights, info.fl1, info.fl2, w[7], identityProjector, gluonProjector);
+  fills.add(weights, info.x1, info.x2/x2p, info.pdfQ2, type);    
 }
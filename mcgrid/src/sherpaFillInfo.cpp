@@ -4,75 +4,152 @@
 //
 
 #include "sherpaFillInfo.hh"
+#include "sherpaWeightLayout.hh"
+#include "conventions.hh"
 
 #include "Rivet/Rivet.hh"
 #include <HepMC/WeightContainer.h>
 
 namespace MCgrid {
 
-  sherpaFillInfo::sherpaFillInfo(Rivet::Event const& event):
+  sherpaFillInfo::sherpaFillInfo(Rivet::Event const& event, sherpaWeightLayout & layout,
+                                 const bool requireScaleLogWeights):
   fillInfo(event),
-  usr_wgt(event.genEvent()->weights()),
-  reweight_type((ReweightType)usr_wgt["Reweight_Type"]),
-  DADS_fill_infos(DADSInfos(usr_wgt, pdfQ2, alphas)),
-  RDA_fill_infos(RDAInfos(usr_wgt, fl1, fl2, x1, x2))
-  { }
-
-  std::vector<fillInfo> sherpaFillInfo::DADSInfos(HepMC::WeightContainer const & usr_wgt,
-                                                 const double pdfQ2, const double alphas)
+  B(0.0),
+  VI(0.0),
+  VI_wren_0(0.0),
+  RS(0.0),
+  MuR2(0.0),
+  KP_x1p(0.0),
+  KP_x2p(0.0),
+  hasScaleLogWeights(false)
   {
-    std::vector<fillInfo> subInfos;
-    const std::string sub_info_tag("DADS");
-
-    for (size_t i(0); i < numberOfTerms(usr_wgt, sub_info_tag); i++) {
-      std::string key_prefix = keyPrefixForEntryWithIndex(i, sub_info_tag);
-      if (hasNonZeroWeightEntryForKeyPrefix(usr_wgt, key_prefix)) {
-        fillInfo info(usr_wgt, key_prefix, pdfQ2, alphas);
-        subInfos.push_back(info);
+    HepMC::WeightContainer const & usr_wgt = event.genEvent()->weights();
+    layout.update(usr_wgt);
+
+    reweight_type = (ReweightType)layout.value(usr_wgt, sherpaWeightLayout::ReweightTypeKey);
+
+    if (reweight_type == ReweightTypeLO || (reweight_type & ReweightTypeB)) {
+      B = layout.value(usr_wgt, sherpaWeightLayout::BKey);
+    }
+
+    if (reweight_type & ReweightTypeVI) {
+      VI = layout.value(usr_wgt, sherpaWeightLayout::VIKey);
+      VI_wren_0 = layout.optionalValue(usr_wgt, sherpaWeightLayout::VIwren0Key);
+    }
+
+    for (int i=0; i<16; i++)
+      KP_wfac[i] = 0.0;
+    if (reweight_type & ReweightTypeKP) {
+      KP_x1p = layout.value(usr_wgt, sherpaWeightLayout::KPx1pKey);
+      KP_x2p = layout.value(usr_wgt, sherpaWeightLayout::KPx2pKey);
+      for (int i=0; i<8; i++) {
+        const sherpaWeightLayout::fixedKey key = (sherpaWeightLayout::fixedKey)(sherpaWeightLayout::KPwfac0Key + i);
+        KP_wfac[i] = layout.value(usr_wgt, key);
       }
+      for (int i=8; i<16; i++) {
+        const sherpaWeightLayout::fixedKey key = (sherpaWeightLayout::fixedKey)(sherpaWeightLayout::KPwfac0Key + i);
+        KP_wfac[i] = layout.optionalValue(usr_wgt, key);
+      }
+    }
+
+    if (reweight_type & ReweightTypeRS) {
+      RS = layout.value(usr_wgt, sherpaWeightLayout::RSKey);
+      MuR2 = layout.value(usr_wgt, sherpaWeightLayout::MuR2Key);
     }
 
-    return subInfos;
+    readDADSInfos(usr_wgt, layout);
+    readRDAInfos(usr_wgt, layout);
+
+    if (requireScaleLogWeights)
+      readScaleLogWeights(usr_wgt, layout);
+    else
+      hasScaleLogWeights = scaleLogWeightsPresent(layout);
   }
 
-  std::vector<fillInfo> sherpaFillInfo::RDAInfos(HepMC::WeightContainer const & usr_wgt,
-                                                 int fl1, int fl2, double x1, double x2)
+  sherpaFillInfo::sherpaFillInfo():
+  fillInfo(0.0, 0, 0, 0.0, 0.0, 0.0, 0.0),
+  reweight_type(ReweightTypeLO),
+  B(0.0),
+  VI(0.0),
+  VI_wren_0(0.0),
+  RS(0.0),
+  MuR2(0.0),
+  KP_x1p(0.0),
+  KP_x2p(0.0),
+  hasScaleLogWeights(false)
   {
-    std::vector<fillInfo> subInfos;
-    const std::string sub_info_tag("RDA");
-
-    for (size_t i(0); i < numberOfTerms(usr_wgt, sub_info_tag); i++) {
-      std::string key_prefix = keyPrefixForEntryWithIndex(i, sub_info_tag);
-      if (hasNonZeroWeightEntryForKeyPrefix(usr_wgt, key_prefix)) {
-        fillInfo info(usr_wgt, key_prefix, fl1, fl2, x1, x2);
-        subInfos.push_back(info);
+    for (int i=0; i<16; i++)
+      KP_wfac[i] = 0.0;
+  }
+
+  // Grids with dedicated scale logarithm grids fill these weights on their
+  // own, so a missing one must not be read as 0
+  void sherpaFillInfo::readScaleLogWeights(HepMC::WeightContainer const & usr_wgt,
+                                           sherpaWeightLayout const & layout)
+  {
+    if (reweight_type & ReweightTypeVI)
+      VI_wren_0 = layout.value(usr_wgt, sherpaWeightLayout::VIwren0Key);
+
+    if (reweight_type & ReweightTypeKP) {
+      for (int i=8; i<16; i++) {
+        const sherpaWeightLayout::fixedKey key = (sherpaWeightLayout::fixedKey)(sherpaWeightLayout::KPwfac0Key + i);
+        KP_wfac[i] = layout.value(usr_wgt, key);
       }
     }
-
-    return subInfos;
+    hasScaleLogWeights = true;
   }
 
-  size_t sherpaFillInfo::numberOfTerms(HepMC::WeightContainer const & usr_wgt, std::string const & sub_info_tag)
+  // The optional reads above have then read the actual weights
+  bool sherpaFillInfo::scaleLogWeightsPresent(sherpaWeightLayout const & layout) const
   {
-    std::ostringstream key;
-    key << "Reweight_" << sub_info_tag << "_N";
-    if (!usr_wgt.has_key(key.str())) {
-      return 0;
+    if ((reweight_type & ReweightTypeVI) && !layout.isPresent(sherpaWeightLayout::VIwren0Key))
+      return false;
+
+    if (reweight_type & ReweightTypeKP) {
+      for (int i=8; i<16; i++) {
+        const sherpaWeightLayout::fixedKey key = (sherpaWeightLayout::fixedKey)(sherpaWeightLayout::KPwfac0Key + i);
+        if (!layout.isPresent(key))
+          return false;
+      }
     }
-    return (size_t)usr_wgt[key.str()];
+    return true;
   }
 
-  std::string sherpaFillInfo::keyPrefixForEntryWithIndex(size_t index, std::string const & sub_info_tag)
+  void sherpaFillInfo::readDADSInfos(HepMC::WeightContainer const & usr_wgt,
+                                     sherpaWeightLayout const & layout)
   {
-    std::ostringstream key;
-    key << "Reweight_" << sub_info_tag << "_" << index << "_";
-    return key.str();
+    for (size_t i(0); i < layout.numberOfDADSTerms(); i++) {
+      const double wgt = layout.DADSValue(usr_wgt, i, sherpaWeightLayout::DADSWeight);
+      if (wgt != 0.0) {
+        fillInfo info(wgt,
+                      pdgToLHA(layout.DADSValue(usr_wgt, i, sherpaWeightLayout::DADSfl1)),
+                      pdgToLHA(layout.DADSValue(usr_wgt, i, sherpaWeightLayout::DADSfl2)),
+                      layout.DADSValue(usr_wgt, i, sherpaWeightLayout::DADSx1),
+                      layout.DADSValue(usr_wgt, i, sherpaWeightLayout::DADSx2),
+                      pdfQ2,
+                      alphas);
+        DADS_fill_infos.push_back(info);
+      }
+    }
   }
 
-  bool sherpaFillInfo::hasNonZeroWeightEntryForKeyPrefix(HepMC::WeightContainer const & usr_wgt, std::string const & key_prefix)
+  void sherpaFillInfo::readRDAInfos(HepMC::WeightContainer const & usr_wgt,
+                                    sherpaWeightLayout const & layout)
   {
-    std::string weightKey(key_prefix + "Weight");
-    return (usr_wgt.has_key(weightKey) && usr_wgt[weightKey] != 0.0);
+    for (size_t i(0); i < layout.numberOfRDATerms(); i++) {
+      const double wgt = layout.RDAValue(usr_wgt, i, sherpaWeightLayout::RDAWeight);
+      if (wgt != 0.0) {
+        fillInfo info(wgt,
+                      fl1,
+                      fl2,
+                      x1,
+                      x2,
+                      layout.RDAValue(usr_wgt, i, sherpaWeightLayout::RDAMuF12),
+                      layout.RDAValue(usr_wgt, i, sherpaWeightLayout::RDAAlphaS));
+        RDA_fill_infos.push_back(info);
+      }
+    }
   }
 
 }
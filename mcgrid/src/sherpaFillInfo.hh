@@ -11,8 +11,12 @@
 #include <vector>
 #include <string>
 
+namespace HepMC{ class WeightContainer; }
+
 namespace MCgrid {
 
+  class sherpaWeightLayout;
+
   // This follows the Sherpa convention
   typedef enum {                        // Present in:
     ReweightTypeLO            = 0,      // LO(PS)
@@ -28,22 +32,42 @@ namespace MCgrid {
   class sherpaFillInfo : public fillInfo
   {
   public:
-    sherpaFillInfo(Rivet::Event const&);
+    // Decode the user weights of the event, using (and updating) the given
+    // weight layout to avoid named lookups. The scale logarithm weights
+    // (Reweight_VI_wren_0 and Reweight_KP_wfac_8-15) are only required if
+    // requireScaleLogWeights is set, and read as 0 if missing otherwise
+    sherpaFillInfo(Rivet::Event const&, sherpaWeightLayout &, const bool requireScaleLogWeights);
+
+    // Empty fill info, to be read from an event record
+    sherpaFillInfo();
+
+    ReweightType reweight_type;
+
+    // User weights, only read if present according to the reweight type
+    double B;           //!< Reweight_B
+    double VI;          //!< Reweight_VI
+    double VI_wren_0;   //!< Reweight_VI_wren_0
+    double RS;          //!< Reweight_RS
+    double MuR2;        //!< MuR2
+    double KP_x1p;      //!< Reweight_KP_x1p
+    double KP_x2p;      //!< Reweight_KP_x2p
+    double KP_wfac[16]; //!< Reweight_KP_wfac_<i>, 8-15 are the factorisation scale log terms
+
+    std::vector<fillInfo> DADS_fill_infos;
+    std::vector<fillInfo> RDA_fill_infos;
+
+    // Whether all scale logarithm weights of the reweight type are present
+    // in the event, and have been read
+    bool hasScaleLogWeights;
 
-    const HepMC::WeightContainer & usr_wgt;
-    const ReweightType reweight_type;
-    const std::vector<fillInfo> DADS_fill_infos;
-    const std::vector<fillInfo> RDA_fill_infos;
+    // Read the scale logarithm weights again, requiring them to be present
+    void readScaleLogWeights(HepMC::WeightContainer const &, sherpaWeightLayout const &);
 
   private:
-    // Helper methods to construc sub fill infos (DADS/RDA) from user weights
-    static std::vector<fillInfo> DADSInfos(HepMC::WeightContainer const &,
-                                           const double pdfQ2, const double alphas);
-    static std::vector<fillInfo> RDAInfos(HepMC::WeightContainer const &,
-                                          int fl1, int fl2, double x1, double x2);
-    static size_t numberOfTerms(HepMC::WeightContainer const &, std::string const &);
-    static std::string keyPrefixForEntryWithIndex(size_t, std::string const &);
-    static bool hasNonZeroWeightEntryForKeyPrefix(HepMC::WeightContainer const &, std::string const &);
+    bool scaleLogWeightsPresent(sherpaWeightLayout const &) const;
+    // Helper methods to construct sub fill infos (DADS/RDA) from user weights
+    void readDADSInfos(HepMC::WeightContainer const &, sherpaWeightLayout const &);
+    void readRDAInfos(HepMC::WeightContainer const &, sherpaWeightLayout const &);
   };
 
 }
@@ -0,0 +1,183 @@
+//
+//  sherpaWeightLayout.cpp
+//  MCgrid 17/10/2026.
+//
+
+#include "sherpaWeightLayout.hh"
+
+#include <map>
+#include <sstream>
+#include <iostream>
+#include <cstdlib>
+
+#include <HepMC/WeightContainer.h>
+
+namespace MCgrid {
+
+  const size_t sherpaWeightLayout::npos = (size_t)-1;
+
+  static const char * const DADSFieldNames[sherpaWeightLayout::nDADSFields] = {
+    "Weight", "fl1", "fl2", "x1", "x2"
+  };
+
+  static const char * const RDAFieldNames[sherpaWeightLayout::nRDAFields] = {
+    "Weight", "MuF12", "AlphaS"
+  };
+
+  sherpaWeightLayout::sherpaWeightLayout():
+  resolved(false),
+  nWeights(0),
+  reweightType(0)
+  {
+    for (int i=0; i<nFixedKeys; i++)
+      fixedIndices[i] = npos;
+  }
+
+  void sherpaWeightLayout::update(HepMC::WeightContainer const & usr_wgt)
+  {
+    if (!matches(usr_wgt))
+      resolve(usr_wgt);
+  }
+
+  double sherpaWeightLayout::value(HepMC::WeightContainer const & usr_wgt, fixedKey key) const
+  {
+    if (fixedIndices[key] == npos)
+      missingWeight(fixedKeyName(key));
+    return usr_wgt[fixedIndices[key]];
+  }
+
+  double sherpaWeightLayout::optionalValue(HepMC::WeightContainer const & usr_wgt, fixedKey key) const
+  {
+    return valueAtIndex(usr_wgt, fixedIndices[key]);
+  }
+
+  // The sub-entries of all terms below Reweight_DADS_N and Reweight_RDA_N are
+  // written by SHERPA, a missing field means a broken weight container
+  double sherpaWeightLayout::DADSValue(HepMC::WeightContainer const & usr_wgt, size_t term, DADSField field) const
+  {
+    const size_t index = DADSIndices[term * nDADSFields + field];
+    if (index == npos)
+      missingWeight(subEntryKeyName("DADS", term, DADSFieldNames[field]));
+    return usr_wgt[index];
+  }
+
+  double sherpaWeightLayout::RDAValue(HepMC::WeightContainer const & usr_wgt, size_t term, RDAField field) const
+  {
+    const size_t index = RDAIndices[term * nRDAFields + field];
+    if (index == npos)
+      missingWeight(subEntryKeyName("RDA", term, RDAFieldNames[field]));
+    return usr_wgt[index];
+  }
+
+  double sherpaWeightLayout::valueAtIndex(HepMC::WeightContainer const & usr_wgt, size_t index) const
+  {
+    return (index == npos) ? 0.0 : usr_wgt[index];
+  }
+
+  void sherpaWeightLayout::missingWeight(std::string const & name)
+  {
+    std::cerr << "MCgrid::Error - The SHERPA user weight " << name << " is missing in the event." << std::endl;
+    std::cerr << "                Please check the reweighting options of the SHERPA run." << std::endl;
+    exit(-1);
+  }
+
+  // The layout of a SHERPA weight container is determined by its size, its
+  // reweight type and its number of DADS and RDA terms, as long as the
+  // weights are written in the same order. This is checked for the reweight
+  // type, whose index all other checks rely on
+  bool sherpaWeightLayout::matches(HepMC::WeightContainer const & usr_wgt) const
+  {
+    if (!resolved || usr_wgt.size() != nWeights)
+      return false;
+
+    if (!isAtResolvedIndex(usr_wgt, ReweightTypeKey, reweightTypeKeyName()))
+      return false;
+
+    if (optionalValue(usr_wgt, ReweightTypeKey) != reweightType)
+      return false;
+
+    if ((size_t)optionalValue(usr_wgt, DADSNKey) != numberOfDADSTerms())
+      return false;
+
+    return ((size_t)optionalValue(usr_wgt, RDANKey) == numberOfRDATerms());
+  }
+
+  // The named lookup returns a reference into the container, which is the
+  // weight at the resolved index if the name still maps to it
+  bool sherpaWeightLayout::isAtResolvedIndex(HepMC::WeightContainer const & usr_wgt, fixedKey key,
+                                             std::string const & name) const
+  {
+    if (fixedIndices[key] == npos)
+      return !usr_wgt.has_key(name);
+    return usr_wgt.has_key(name) && &usr_wgt[name] == &usr_wgt[fixedIndices[key]];
+  }
+
+  void sherpaWeightLayout::resolve(HepMC::WeightContainer const & usr_wgt)
+  {
+    std::map<std::string, size_t> indices;
+    for (HepMC::WeightContainer::const_map_iterator it = usr_wgt.map_begin(); it != usr_wgt.map_end(); it++)
+      indices.insert(std::make_pair(it->first, (size_t)it->second));
+
+    for (int i=0; i<nFixedKeys; i++) {
+      std::map<std::string, size_t>::const_iterator it = indices.find(fixedKeyName(i));
+      fixedIndices[i] = (it == indices.end()) ? npos : it->second;
+    }
+
+    const size_t nDADS = (size_t)optionalValue(usr_wgt, DADSNKey);
+    DADSIndices.assign(nDADS * nDADSFields, npos);
+    for (size_t term(0); term < nDADS; term++) {
+      for (int field=0; field<nDADSFields; field++) {
+        std::map<std::string, size_t>::const_iterator it = indices.find(subEntryKeyName("DADS", term, DADSFieldNames[field]));
+        if (it != indices.end())
+          DADSIndices[term * nDADSFields + field] = it->second;
+      }
+    }
+
+    const size_t nRDA = (size_t)optionalValue(usr_wgt, RDANKey);
+    RDAIndices.assign(nRDA * nRDAFields, npos);
+    for (size_t term(0); term < nRDA; term++) {
+      for (int field=0; field<nRDAFields; field++) {
+        std::map<std::string, size_t>::const_iterator it = indices.find(subEntryKeyName("RDA", term, RDAFieldNames[field]));
+        if (it != indices.end())
+          RDAIndices[term * nRDAFields + field] = it->second;
+      }
+    }
+
+    nWeights = usr_wgt.size();
+    reweightType = optionalValue(usr_wgt, ReweightTypeKey);
+    resolved = true;
+  }
+
+  std::string sherpaWeightLayout::fixedKeyName(const int key)
+  {
+    switch (key) {
+      case ReweightTypeKey: return "Reweight_Type";
+      case BKey:            return "Reweight_B";
+      case VIKey:           return "Reweight_VI";
+      case VIwren0Key:      return "Reweight_VI_wren_0";
+      case RSKey:           return "Reweight_RS";
+      case MuR2Key:         return "MuR2";
+      case KPx1pKey:        return "Reweight_KP_x1p";
+      case KPx2pKey:        return "Reweight_KP_x2p";
+      case DADSNKey:        return "Reweight_DADS_N";
+      case RDANKey:         return "Reweight_RDA_N";
+    }
+    std::ostringstream name;
+    name << "Reweight_KP_wfac_" << key - KPwfac0Key;
+    return name.str();
+  }
+
+  std::string const& sherpaWeightLayout::reweightTypeKeyName()
+  {
+    static const std::string name(fixedKeyName(ReweightTypeKey));
+    return name;
+  }
+
+  std::string sherpaWeightLayout::subEntryKeyName(std::string const & tag, size_t term, std::string const & field)
+  {
+    std::ostringstream name;
+    name << "Reweight_" << tag << "_" << term << "_" << field;
+    return name.str();
+  }
+
+}
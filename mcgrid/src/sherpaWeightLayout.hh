@@ -0,0 +1,96 @@
+//
+//  sherpaWeightLayout.hh
+//  MCgrid 17/10/2026.
+//
+
+#ifndef mcgrid_sherpa_weight_layout_hh
+#define mcgrid_sherpa_weight_layout_hh
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+namespace HepMC{ class WeightContainer; }
+
+namespace MCgrid {
+
+  /**
+   * MCgrid::sherpaWeightLayout maps the named SHERPA user weights needed by
+   * the SHERPA fillmode to their index in the HepMC weight container. The
+   * names are resolved once, and later events are read by index as long as
+   * their weight layout matches. If an event comes with a different layout
+   * (different size, reweight type or number of DADS/RDA terms), its names
+   * are resolved again.
+   **/
+  class sherpaWeightLayout
+  {
+  public:
+    // Named weights with a fixed key
+    typedef enum {
+      ReweightTypeKey,
+      BKey,
+      VIKey,
+      VIwren0Key,
+      RSKey,
+      MuR2Key,
+      KPx1pKey,
+      KPx2pKey,
+      KPwfac0Key,
+      DADSNKey = KPwfac0Key + 16,
+      RDANKey,
+      nFixedKeys
+    } fixedKey;
+
+    // Fields of a DADS sub-entry (Reweight_DADS_<i>_<field>)
+    typedef enum { DADSWeight, DADSfl1, DADSfl2, DADSx1, DADSx2, nDADSFields } DADSField;
+
+    // Fields of a RDA sub-entry (Reweight_RDA_<i>_<field>)
+    typedef enum { RDAWeight, RDAMuF12, RDAAlphaS, nRDAFields } RDAField;
+
+    sherpaWeightLayout();
+
+    // Make sure that the layout matches the given container
+    void update(HepMC::WeightContainer const &);
+
+    // Read a weight that must be present in the container, the run stops if
+    // it is missing
+    double value(HepMC::WeightContainer const &, fixedKey) const;
+
+    // Whether a weight is present in the container
+    bool isPresent(fixedKey key) const { return fixedIndices[key] != npos; };
+
+    // Read a weight that might be missing in the container (returns 0 then),
+    // which are only Reweight_VI_wren_0 and Reweight_KP_wfac_8 ... 15
+    double optionalValue(HepMC::WeightContainer const &, fixedKey) const;
+
+    // Read a field of a DADS/RDA sub-entry, the run stops if it is missing
+    double DADSValue(HepMC::WeightContainer const &, size_t term, DADSField) const;
+    double RDAValue(HepMC::WeightContainer const &, size_t term, RDAField) const;
+
+    size_t numberOfDADSTerms() const { return DADSIndices.size() / nDADSFields; };
+    size_t numberOfRDATerms() const { return RDAIndices.size() / nRDAFields; };
+
+  private:
+    bool matches(HepMC::WeightContainer const &) const;
+    bool isAtResolvedIndex(HepMC::WeightContainer const &, fixedKey, std::string const & name) const;
+    void resolve(HepMC::WeightContainer const &);
+    double valueAtIndex(HepMC::WeightContainer const &, size_t) const;
+    static void missingWeight(std::string const & name);
+
+    static std::string fixedKeyName(const int key);
+    static std::string const& reweightTypeKeyName();  //!< Without building the name per event
+    static std::string subEntryKeyName(std::string const & tag, size_t term, std::string const & field);
+
+    static const size_t npos;
+
+    bool resolved;                     //!< Whether a layout has been resolved yet
+    size_t nWeights;                   //!< Size of the container the layout has been resolved for
+    double reweightType;               //!< Reweight type the layout has been resolved for
+    size_t fixedIndices[nFixedKeys];   //!< Container indices of the fixed keys (or npos)
+    std::vector<size_t> DADSIndices;   //!< Container indices of the DADS fields, term-major
+    std::vector<size_t> RDAIndices;    //!< Container indices of the RDA fields, term-major
+  };
+
+}
+
+#endif
@@ -0,0 +1,65 @@
+//
+//  subprocessWeights.hh
+//  MCgrid 17/10/2026.
+//
+
+#ifndef mcgrid_subprocess_weights_hh
+#define mcgrid_subprocess_weights_hh
+
+#include <vector>
+#include <cstddef>
+
+namespace MCgrid {
+
+  /**
+   * MCgrid::subprocessWeights accumulates the weights per subprocess for a
+   * single fill of the underlying grid. Besides the dense weight array (as
+   * needed by appl::grid::fill_grid) it records which subprocesses have been
+   * touched, such that clearing costs O(touched) and fastNLO fills can skip
+   * all untouched subprocesses.
+   **/
+  class subprocessWeights
+  {
+  public:
+    subprocessWeights() {};
+
+    void resize(const int nSubProc)
+    {
+      dense.assign(nSubProc, 0.0);
+      isTouched.assign(nSubProc, false);
+      touched.clear();
+    };
+
+    inline void add(const int subproc, const double w)
+    {
+      if (!isTouched[subproc]) {
+        isTouched[subproc] = true;
+        touched.push_back(subproc);
+      }
+      dense[subproc] += w;
+    };
+
+    // Zero all touched weights
+    inline void clear()
+    {
+      for (size_t i(0); i < touched.size(); i++) {
+        dense[touched[i]] = 0.0;
+        isTouched[touched[i]] = false;
+      }
+      touched.clear();
+    };
+
+    int size() const { return dense.size(); };
+    double operator[](const int subproc) const { return dense[subproc]; };
+    const double* data() const { return &dense[0]; };
+    std::vector<int> const& touchedSubprocesses() const { return touched; };
+
+  private:
+    std::vector<double> dense;     //!< Weight per subprocess
+    std::vector<bool> isTouched;   //!< Whether a subprocess is listed in touched
+    std::vector<int> touched;      //!< Subprocesses written to since the last clear
+  };
+
+}
+
+#endif
@@ -0,0 +1,56 @@
+//
+//  threading.cpp
+//  MCgrid 17/10/2026.
+//
+
+#include "threading.hh"
+
+#include "mcgrid/mcgrid.hh"
+
+using Rivet::cerr;
+using Rivet::endl;
+
+namespace MCgrid {
+
+  static std::atomic<int> nextFillThreadSlot(0);
+  static thread_local int currentFillThreadSlot = -1;
+  static std::atomic<bool> isSlotAssigned[maxFillThreads];
+  static std::atomic<int> nAssignedSlots(0);
+
+  int fillThreadSlot()
+  {
+    if (currentFillThreadSlot == -1)
+      setFillThreadSlot(nextFillThreadSlot++);
+    return currentFillThreadSlot;
+  }
+
+  int numberOfFillThreadSlots()
+  {
+    return nAssignedSlots.load();
+  }
+
+  std::mutex& gridFileMutex()
+  {
+    static std::mutex mutex;
+    return mutex;
+  }
+
+  std::mutex& gridBookingMutex()
+  {
+    static std::mutex mutex;
+    return mutex;
+  }
+
+  void setFillThreadSlot(const int slot)
+  {
+    if (slot < 0 || slot >= maxFillThreads) {
+      cerr << "MCgrid::Error - Fill thread slot " << slot << " is out of range, at most ";
+      cerr << maxFillThreads << " threads can fill grids concurrently." << endl;
+      exit(-1);
+    }
+    currentFillThreadSlot = slot;
+    if (!isSlotAssigned[slot].exchange(true))
+      nAssignedSlots++;
+  }
+
+}
@@ -0,0 +1,87 @@
+//
+//  threading.hh
+//  MCgrid 17/10/2026.
+//
+
+#ifndef mcgrid_threading_hh
+#define mcgrid_threading_hh
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+
+namespace MCgrid {
+
+  // Maximum number of threads that may fill grids concurrently
+  const int maxFillThreads = 256;
+
+  // Slot index of the calling thread. Slots are assigned in the order in
+  // which threads first fill, unless setFillThreadSlot has been called.
+  int fillThreadSlot();
+
+  // Number of distinct slots assigned to threads so far
+  int numberOfFillThreadSlots();
+
+  // ROOT is not thread safe, APPLgrid files are only read or written by
+  // threads holding this mutex
+  std::mutex& gridFileMutex();
+
+  // Grids may be booked while other threads fill, see BinnedGrid. Booking
+  // and the creation of fastNLO tables, which read fastNLO's global
+  // steering, hold this mutex
+  std::mutex& gridBookingMutex();
+
+  /**
+   * MCgrid::perThread holds one lazily created instance of T per fill thread
+   * slot. Access to the instance of the own slot is lock-free. Reductions
+   * iterate over the slots in ascending order after the fill threads are
+   * done, so their result only depends on which events each slot filled,
+   * not on the thread scheduling.
+   **/
+  template<class T>
+  class perThread
+  {
+  public:
+    perThread()
+    {
+      for (int i=0; i<maxFillThreads; i++)
+        items[i].store(NULL);
+    };
+
+    ~perThread()
+    {
+      for (int i=0; i<maxFillThreads; i++)
+        delete items[i].load();
+    };
+
+    // The instance of the calling thread, default constructed on first use
+    T& local()
+    {
+      const int slot = fillThreadSlot();
+      T* item = items[slot].load(std::memory_order_acquire);
+      if (item == NULL) {
+        item = new T();
+        items[slot].store(item, std::memory_order_release);
+      }
+      return *item;
+    };
+
+    // The instance of a given slot, or NULL if that slot has not been used
+    T* get(const int slot) const { return items[slot].load(std::memory_order_acquire); };
+
+    // Take ownership of an instance for a given slot
+    void set(const int slot, T* item) { items[slot].store(item, std::memory_order_release); };
+
+    // Release the instance of a given slot without deleting it
+    T* release(const int slot) { return items[slot].exchange(NULL); };
+
+  private:
+    perThread(perThread const&);
+    perThread& operator=(perThread const&);
+
+    std::atomic<T*> items[maxFillThreads];
+  };
+
+}
+
+#endif
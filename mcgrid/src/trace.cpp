@@ -0,0 +1,215 @@
+//
+//  trace.cpp
+//  MCgrid 17/10/2026.
+//
+
+#include "trace.hh"
+
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <unistd.h>
+
+#include "system.hh"
+#include "threading.hh"
+
+namespace MCgrid {
+
+  namespace {
+
+    struct traceEntry
+    {
+      std::string category;
+      std::string name;
+      std::string args;     //!< JSON object members, without braces
+      uint64_t start;
+      uint64_t duration;
+      int thread;
+    };
+
+    // Fills of one thread aggregated into a slice of the timeline
+    struct fillSlice
+    {
+      fillSlice(): start(0), end(0), nFills(0), fillNs(0), thread(0) {};
+      uint64_t start;
+      uint64_t end;
+      uint64_t nFills;
+      uint64_t fillNs;      //!< Time spent filling within the slice
+      int thread;
+    };
+
+    // Small sequential ids for the threads in the timeline
+    int traceThreadId()
+    {
+      static std::atomic<int> nThreads(0);
+      static thread_local int id = nThreads++;
+      return id;
+    }
+
+    std::string escaped(std::string const& value)
+    {
+      std::string result;
+      for (size_t i(0); i < value.size(); i++) {
+        if (value[i] == '"' || value[i] == '\\')
+          result += '\\';
+        result += value[i];
+      }
+      return result;
+    }
+
+    class traceRecorder
+    {
+    public:
+      traceRecorder(std::string const& path):
+        path(path),
+        origin(profileTime()) {};
+
+      void add(traceEntry const& entry)
+      {
+        std::lock_guard<std::mutex> lock(entriesMutex);
+        entries.push_back(entry);
+      }
+
+      void addSlice(fillSlice const& slice)
+      {
+        std::stringstream args;
+        args << "\"fills\": " << slice.nFills << ", \"fillSeconds\": " << slice.fillNs*1e-9;
+        traceEntry entry;
+        entry.category = "fill";
+        entry.name = "fill";
+        entry.args = args.str();
+        entry.start = slice.start;
+        entry.duration = slice.end - slice.start;
+        entry.thread = slice.thread;
+        add(entry);
+      }
+
+      // The complete trace is rewritten, such that the file is always valid
+      void write()
+      {
+        for (int slot=0; slot<maxFillThreads; slot++) {
+          fillSlice* slice = slices.get(slot);
+          if (slice != NULL && slice->nFills > 0) {
+            addSlice(*slice);
+            *slice = fillSlice();
+          }
+        }
+
+        std::lock_guard<std::mutex> lock(entriesMutex);
+        std::ofstream file(path.c_str());
+        const int pid = getpid();
+        file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [" << std::endl;
+        file << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": " << pid;
+        file << ", \"args\": {\"name\": \"MCgrid\"}}";
+        file.precision(3);
+        file << std::fixed;
+        for (size_t i(0); i < entries.size(); i++) {
+          traceEntry const& entry = entries[i];
+          file << "," << std::endl;
+          file << "{\"name\": \"" << escaped(entry.name) << "\", ";
+          file << "\"cat\": \"" << entry.category << "\", \"ph\": \"X\", ";
+          file << "\"ts\": " << (entry.start - origin)*1e-3 << ", ";
+          file << "\"dur\": " << entry.duration*1e-3 << ", ";
+          file << "\"pid\": " << pid << ", \"tid\": " << entry.thread;
+          if (entry.args != "")
+            file << ", \"args\": {" << entry.args << "}";
+          file << "}";
+        }
+        file << std::endl << "]}" << std::endl;
+      }
+
+      perThread<fillSlice> slices;
+
+    private:
+      const std::string path;
+      const uint64_t origin;
+      std::mutex entriesMutex;
+      std::vector<traceEntry> entries;
+    };
+
+    void flushTraceAtExit()
+    {
+      flushTrace();
+    }
+
+    traceRecorder* createRecorder()
+    {
+      const std::string path = environmentVariableForKey("MCGRID_TRACE");
+      if (path == "")
+        return NULL;
+      atexit(flushTraceAtExit);
+      return new traceRecorder(path);
+    }
+
+    // The recorder lives until the end of the process, such that spans of
+    // grids that are destroyed late are still recorded
+    traceRecorder* recorder()
+    {
+      static traceRecorder* const instance = createRecorder();
+      return instance;
+    }
+
+  }
+
+  bool isTracing()
+  {
+    return recorder() != NULL;
+  }
+
+  void traceFill(const uint64_t start, const uint64_t end)
+  {
+    traceRecorder* traces = recorder();
+    if (traces == NULL)
+      return;
+
+    fillSlice& slice = traces->slices.local();
+    if (slice.nFills == 0) {
+      slice.start = start;
+      slice.thread = traceThreadId();
+    }
+    slice.end = end;
+    slice.nFills++;
+    slice.fillNs += end - start;
+    if (slice.nFills == fillsPerTraceSlice) {
+      traces->addSlice(slice);
+      slice = fillSlice();
+    }
+  }
+
+  void flushTrace()
+  {
+    traceRecorder* traces = recorder();
+    if (traces != NULL)
+      traces->write();
+  }
+
+  traceSpan::traceSpan(std::string const& category,
+                       std::string const& name,
+                       std::string const& gridName):
+    active(isTracing()),
+    category(category),
+    name(name),
+    gridName(gridName),
+    start(active ? profileTime() : 0)
+  { }
+
+  traceSpan::~traceSpan()
+  {
+    if (!active)
+      return;
+
+    traceEntry entry;
+    entry.category = category;
+    entry.name = name;
+    if (gridName != "")
+      entry.args = "\"grid\": \"" + escaped(gridName) + "\"";
+    entry.start = start;
+    entry.duration = profileTime() - start;
+    entry.thread = traceThreadId();
+    recorder()->add(entry);
+  }
+
+}
@@ -0,0 +1,82 @@
+//
+//  trace.hh
+//  MCgrid 17/10/2026.
+//
+
+#ifndef mcgrid_trace_hh
+#define mcgrid_trace_hh
+
+#include <string>
+#include <stdint.h>
+
+#include "fillProfile.hh"
+
+namespace MCgrid {
+
+  /*
+   *  Setting MCGRID_TRACE to a file path makes MCgrid write a timeline of
+   *  the booking, phase space loading, filling and export of all grids in
+   *  the Trace Event Format, which can be loaded into chrome://tracing or
+   *  Perfetto. Fills are not traced one by one, but aggregated into slices
+   *  of fillsPerTraceSlice fills per thread. The trace is written when the
+   *  last analysis checks out of the PDFHandler, or at exit.
+   */
+
+  // Whether MCGRID_TRACE is set
+  bool isTracing();
+
+  // Number of fills aggregated into one slice of the timeline
+  const uint64_t fillsPerTraceSlice = 10000;
+
+  // Add a fill of the calling thread to its current fill slice
+  void traceFill(const uint64_t start, const uint64_t end);
+
+  // Write the trace collected so far (also called at exit)
+  void flushTrace();
+
+  /**
+   * MCgrid::traceSpan adds a span to the timeline from its construction
+   * until it goes out of scope. It does nothing if tracing is disabled.
+   **/
+  class traceSpan
+  {
+  public:
+    traceSpan(std::string const& category,
+              std::string const& name,
+              std::string const& gridName = "");
+    ~traceSpan();
+
+  private:
+    traceSpan(traceSpan const&);
+    traceSpan& operator=(traceSpan const&);
+
+    const bool active;
+    const std::string category;
+    const std::string name;
+    const std::string gridName;
+    const uint64_t start;
+  };
+
+  /**
+   * MCgrid::traceFillScope adds the time until it goes out of scope to the
+   * fill slice of the calling thread, if enabled
+   **/
+  class traceFillScope
+  {
+  public:
+    traceFillScope(const bool enabled):
+      start(enabled ? profileTime() : 0) {};
+
+    ~traceFillScope()
+    {
+      if (start != 0)
+        traceFill(start, profileTime());
+    };
+
+  private:
+    const uint64_t start;
+  };
+
+}
+
+#endif